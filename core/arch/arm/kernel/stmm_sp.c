@@ -700,6 +700,7 @@ static TEE_Result sec_storage_obj_write(unsigned long storage_id, char *obj_id,
 	struct stmm_ctx *spc = NULL;
 	TEE_Result res = TEE_SUCCESS;
 	struct tee_pobj *po = NULL;
+	bool in_trans = false;
 
 	fops = tee_svc_storage_file_ops(storage_id);
 	if (!fops)
@@ -722,6 +723,8 @@ static TEE_Result sec_storage_obj_write(unsigned long storage_id, char *obj_id,
 	if (res != TEE_SUCCESS)
 		return res;
 
+	/* A new object is created and then written, store both at once */
+	in_trans = tee_svc_storage_begin_transaction(fops);
 	res = po->fops->open(po, NULL, &fh);
 	if (res == TEE_ERROR_ITEM_NOT_FOUND)
 		res = po->fops->create(po, false, NULL, 0, NULL, 0, NULL, 0,
@@ -730,6 +733,7 @@ static TEE_Result sec_storage_obj_write(unsigned long storage_id, char *obj_id,
 		res = po->fops->write(fh, offset, data, len);
 		po->fops->close(&fh);
 	}
+	res = tee_svc_storage_commit_transaction(fops, in_trans, res);
 
 	tee_pobj_release(po);
 
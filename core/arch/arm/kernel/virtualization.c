@@ -415,6 +415,15 @@ void virt_unset_guest(void)
 		panic();
 }
 
+uint16_t virt_get_current_guest_id(void)
+{
+	struct guest_partition *prtn = get_current_prtn();
+
+	if (!prtn)
+		return 0;
+	return prtn->id;
+}
+
 void virt_on_stdcall(void)
 {
 	struct guest_partition *prtn = get_current_prtn();
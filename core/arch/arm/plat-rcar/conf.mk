@@ -59,13 +59,43 @@ CFG_OTP_SUPPORT ?= y
 CFG_DYNAMIC_TA_AUTH_BY_HWENGINE ?= y
 core-platform-cflags += -DCFG_OTP_SUPPORT
 core-platform-cflags += -Icore/lib
+# Run small operations on the SW engine, calibrate at boot if enabled
+CFG_CRYPTO_HW_DISPATCH ?= y
+CFG_CRYPTO_HW_DISPATCH_CALIBRATE ?= n
+# Queue the symmetric operations of the Secure IP engine
+CFG_CRYPTO_HW_QUEUE ?= y
+# Serve small random number requests from per-core pools
+CFG_CRYPTO_HW_RNG_POOL ?= y
+# Allocate the hash, cipher and MAC contexts from fixed-size slabs
+CFG_CRYPTO_HW_CTX_SLAB ?= y
+CFG_CRYPTO_HW_CTX_SLAB_NUM ?= 16
+# Run the CTR of large AES-GCM payloads on the engine, GHASH on the CPU
+CFG_CRYPTO_HW_GCM ?= $(CFG_CRYPTO_CTR)
+CFG_CRYPTO_HW_GCM_MIN_LEN ?= 4096
 else
 CFG_OTP_SUPPORT := n
+CFG_CRYPTO_HW_DISPATCH := n
+CFG_CRYPTO_HW_DISPATCH_CALIBRATE := n
+CFG_CRYPTO_HW_QUEUE := n
+CFG_CRYPTO_HW_RNG_POOL := n
+CFG_CRYPTO_HW_CTX_SLAB := n
+CFG_CRYPTO_HW_GCM := n
 endif
 
 CFG_DYNAMIC_TA_AUTH_BY_HWENGINE ?= n
 ifeq ($(CFG_DYNAMIC_TA_AUTH_BY_HWENGINE),y)
 core-platform-cflags += -DRCAR_DYNAMIC_TA_AUTH_BY_HWENGINE
+# Verification slots of TAs signed for different load addresses
+CFG_RCAR_TA_VERIFICATION_SLOTS ?= 1
+# Keep verified TA images in TA RAM so that repeated loads skip the MaskROM
+# verification (the size is taken from the TA RAM). Looking up the cache
+# before the whole TA is loaded needs partial OPTEE_RPC_CMD_LOAD_TA requests
+# in tee-supplicant, without them a hit saves only the verification.
+CFG_RCAR_TA_CACHE ?= n
+CFG_RCAR_TA_CACHE_ENTRIES ?= 8
+CFG_RCAR_TA_CACHE_SIZE ?= 0x400000
+else
+CFG_RCAR_TA_CACHE := n
 endif
 
 # default setting for Secure Storage
@@ -73,6 +103,22 @@ CFG_REE_FS ?= n
 CFG_STANDALONE_FS ?= y
 STANDALONE_FS_SECTOR_ADDR ?= 0x300000
 STANDALONE_FS_SECTOR_NUM ?= 4
+# Append new record versions instead of rewriting the sector on each update
+CFG_STANDALONE_FS_APPEND ?= n
+# Encrypt the record data in 4KiB chunks so that reads decrypt only the
+# chunks they touch. The records of older builds are converted on update,
+# the conversion is one-way: builds without the chunk format cannot read
+# the converted records anymore, so enable it only for a storage that is
+# never used by an older build again.
+CFG_STANDALONE_FS_CHUNKED_DATA ?= n
+# RAM backed flash device for measurement without the flash (not persistent,
+# the image is taken from the TA RAM)
+CFG_RCAR_FLASH_SIM ?= n
+CFG_RCAR_FLASH_SIM_ADDR ?= $(STANDALONE_FS_SECTOR_ADDR)
+CFG_RCAR_FLASH_SIM_SECTOR_NUM ?= $(STANDALONE_FS_SECTOR_NUM)
+# Latency of a sector erase and of a 256 byte page program
+CFG_RCAR_FLASH_SIM_ERASE_US ?= 0
+CFG_RCAR_FLASH_SIM_PROGRAM_US ?= 0
 # ---
 
 ifeq ($(CFG_STANDALONE_FS),y)
@@ -98,6 +144,11 @@ ifneq ($(RCAR_DEBUG_LOG),0)
 core-platform-cflags += -DRCAR_DEBUG_LOG
 endif
 
+# Binary trace mode. The core traces are recorded in the Logging RAM with the
+# format string location and the raw arguments, and rendered on the host by
+# scripts/rcar_trace_decode.py. They are not sent to the Linux terminal.
+CFG_RCAR_TRACE_BINARY ?= n
+
 # Compiler switch - Test Debug log(Test verification log)
 RCAR_TEST_LOG ?= n
 ifeq ($(RCAR_TEST_LOG),y)
@@ -120,4 +171,8 @@ CFG_RCAR_MUTEX_DELAY ?= 1
 core-platform-cflags += -DCFG_RCAR_MUTEX_DELAY=$(CFG_RCAR_MUTEX_DELAY)
 CFG_CORE_RESERVED_SHM ?= n
 PLATFORM_FLAVOR ?= salvator_h3
+# A cached TA image or the simulated flash would be in the TA RAM of the
+# guest that allocated it
+CFG_RCAR_TA_CACHE := n
+CFG_RCAR_FLASH_SIM := n
 endif
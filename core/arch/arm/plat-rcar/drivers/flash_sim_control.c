@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2021, Renesas Electronics Corporation
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <trace.h>
+#include <kernel/delay.h>
+#include <mm/core_memprot.h>
+#include <mm/tee_mm.h>
+#include <drivers/qspi_hyper_flash.h>
+#include "qspi_hyper_flash_common.h"
+#include "flash_sim_control.h"
+
+#if ((CFG_RCAR_FLASH_SIM_ADDR % SECTOR_SIZE) != 0)
+#error CFG_RCAR_FLASH_SIM_ADDR is not a multiple of SECTOR_SIZE.
+#endif
+
+static uint32_t flash_sim_erase_sector(uint32_t sector_addr);
+static uint32_t flash_sim_set_ext_addr_read_mode(uint32_t read_ext_top_addr);
+static uint32_t flash_sim_read(uint32_t r_flash_addr, uint8_t *buf,
+			size_t rsize);
+static uint32_t flash_sim_write(uint32_t buf_addr,
+			uint32_t flash_addr, uint32_t wsize);
+static uint8_t *flash_sim_get_area(uint32_t flash_addr, uint32_t size);
+
+/* RAM image of the simulated flash device, taken from the TA RAM */
+static uint8_t *flash_sim_area __nex_bss;
+static struct flash_sim_stats flash_sim_stats __nex_bss;
+
+uint32_t flash_sim_init(struct flash_control_operations *ops)
+{
+	uint32_t ret = FL_DRV_OK;
+	tee_mm_entry_t *mm;
+
+	/* The image is kept until reset, as the contents of a device */
+	if (flash_sim_area == NULL) {
+		mm = tee_mm_alloc(&tee_mm_sec_ddr, FLASH_SIM_SIZE);
+		if (mm != NULL) {
+			flash_sim_area = phys_to_virt(tee_mm_get_smem(mm),
+				MEM_AREA_TA_RAM);
+			if (flash_sim_area == NULL) {
+				tee_mm_free(mm);
+			}
+		}
+		if (flash_sim_area != NULL) {
+			(void)memset(flash_sim_area, FLASH_SIM_ERASED_DATA,
+				FLASH_SIM_SIZE);
+		} else {
+			EMSG("No TA RAM for the simulated flash. size=0x%x",
+				FLASH_SIM_SIZE);
+			ret = FL_DRV_ERR_OUT_OF_MEMORY;
+		}
+	}
+
+	if (ret == FL_DRV_OK) {
+		flash_sim_clear_stats();
+
+		ops->erase = flash_sim_erase_sector;
+		ops->set_ext_addr_read_mode = flash_sim_set_ext_addr_read_mode;
+		ops->read = flash_sim_read;
+		ops->write = flash_sim_write;
+		ops->read_unit = 1U;
+		ops->device_size = FLASH_SIM_TOP_ADDR + FLASH_SIM_SIZE;
+
+		IMSG("Simulated flash: addr=0x%x size=0x%x erase=%uus program=%uus",
+			FLASH_SIM_TOP_ADDR, FLASH_SIM_SIZE,
+			(uint32_t)CFG_RCAR_FLASH_SIM_ERASE_US,
+			(uint32_t)CFG_RCAR_FLASH_SIM_PROGRAM_US);
+	}
+
+	return ret;
+}
+
+void flash_sim_get_stats(struct flash_sim_stats *stats)
+{
+	(void)memcpy(stats, &flash_sim_stats, sizeof(struct flash_sim_stats));
+}
+
+void flash_sim_clear_stats(void)
+{
+	(void)memset(&flash_sim_stats, 0, sizeof(struct flash_sim_stats));
+}
+
+static uint32_t flash_sim_erase_sector(uint32_t sector_addr)
+{
+	uint32_t ret = FL_DRV_OK;
+	uint8_t *area;
+
+	area = flash_sim_get_area(sector_addr, SECTOR_SIZE);
+	if (area != NULL) {
+		(void)memset(area, FLASH_SIM_ERASED_DATA, SECTOR_SIZE);
+		udelay(CFG_RCAR_FLASH_SIM_ERASE_US);
+		flash_sim_stats.erase_count++;
+	} else {
+		ret = FL_DRV_ERR_SECTOR_ADDR;
+	}
+
+	return ret;
+}
+
+static uint32_t flash_sim_set_ext_addr_read_mode(
+			uint32_t read_ext_top_addr __unused)
+{
+	/* The whole device is mapped, there is no window to switch */
+	flash_sim_stats.window_count++;
+
+	return FL_DRV_OK;
+}
+
+static uint32_t flash_sim_read(uint32_t r_flash_addr, uint8_t *buf,
+			size_t rsize)
+{
+	uint32_t ret = FL_DRV_OK;
+	const uint8_t *area;
+
+	area = flash_sim_get_area(r_flash_addr, rsize);
+	if (area != NULL) {
+		(void)memcpy(buf, area, rsize);
+		flash_sim_stats.read_bytes += rsize;
+		flash_sim_stats.read_count++;
+	} else {
+		ret = FL_DRV_ERR_OUT_OF_RANGE;
+	}
+
+	return ret;
+}
+
+static uint32_t flash_sim_write(uint32_t buf_addr,
+			uint32_t flash_addr, uint32_t wsize)
+{
+	uint32_t ret = FL_DRV_OK;
+	uint32_t i;
+	uint32_t page_num;
+	uint8_t *area;
+	const uint8_t *p_buf;
+	volatile uintptr_t v_buf_addr = buf_addr;
+
+	area = flash_sim_get_area(flash_addr, wsize);
+	if (area != NULL) {
+		p_buf = (const uint8_t *)v_buf_addr;
+		/* Programming can only clear bits, as the real device */
+		for (i = 0U; i < wsize; i++) {
+			area[i] &= p_buf[i];
+		}
+
+		/* Same write buffer units as the HyperFlash driver */
+		page_num = ((flash_addr + wsize + WRITE_BUFF_SIZE - 1U) /
+			WRITE_BUFF_SIZE) - (flash_addr / WRITE_BUFF_SIZE);
+		udelay(page_num * CFG_RCAR_FLASH_SIM_PROGRAM_US);
+		flash_sim_stats.write_bytes += wsize;
+		flash_sim_stats.write_count++;
+	} else {
+		ret = FL_DRV_ERR_OUT_OF_RANGE;
+	}
+
+	return ret;
+}
+
+static uint8_t *flash_sim_get_area(uint32_t flash_addr, uint32_t size)
+{
+	uint8_t *area = NULL;
+
+	if ((flash_addr >= FLASH_SIM_TOP_ADDR) &&
+	    (size <= FLASH_SIM_SIZE) &&
+	    ((flash_addr - FLASH_SIM_TOP_ADDR) <= (FLASH_SIM_SIZE - size))) {
+		area = &flash_sim_area[flash_addr - FLASH_SIM_TOP_ADDR];
+	} else {
+		EMSG("Out of the simulated flash. flash_addr=%x, size=%u",
+			flash_addr, size);
+	}
+
+	return area;
+}
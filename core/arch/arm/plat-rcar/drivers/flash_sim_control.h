@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Copyright (c) 2021, Renesas Electronics Corporation
+ */
+
+#ifndef FLASH_SIM_CONTROL_H
+#define FLASH_SIM_CONTROL_H
+
+#include "qspi_hyper_flash_common.h"
+
+/*
+ * Constant definition
+ */
+
+#define FLASH_SIM_TOP_ADDR	((uint32_t)CFG_RCAR_FLASH_SIM_ADDR)
+#define FLASH_SIM_SIZE		((uint32_t)CFG_RCAR_FLASH_SIM_SECTOR_NUM * \
+				SECTOR_SIZE)
+#define FLASH_SIM_ERASED_DATA	0xFFU
+
+/*
+ * Struct definition
+ */
+
+struct flash_sim_stats {
+	uint64_t read_bytes;
+	uint64_t write_bytes;
+	uint32_t read_count;
+	uint32_t write_count;
+	uint32_t erase_count;
+	uint32_t window_count;		/* external address window switches */
+};
+
+uint32_t flash_sim_init(struct flash_control_operations *ops);
+void flash_sim_get_stats(struct flash_sim_stats *stats);
+void flash_sim_clear_stats(void);
+
+#endif /* FLASH_SIM_CONTROL_H */
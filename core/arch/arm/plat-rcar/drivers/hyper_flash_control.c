@@ -12,8 +12,9 @@
 #include "rcar_common.h"
 
 static uint32_t hyper_flash_erase_sector(uint32_t sector_addr);
-static uint32_t hyper_flash_set_ext_addr_read_mode(uint32_t read_ext_top_addr,
-			uint32_t r_flash_addr, uint8_t *buf, size_t rsize);
+static uint32_t hyper_flash_set_ext_addr_read_mode(uint32_t read_ext_top_addr);
+static uint32_t hyper_flash_read_main(uint32_t r_flash_addr, uint8_t *buf,
+			size_t rsize);
 static uint32_t hyper_flash_write_main(uint32_t buf_addr,
 					uint32_t flash_addr, uint32_t wsize);
 static void hyper_flash_set_control_ops(struct flash_control_operations *ops);
@@ -102,23 +103,19 @@ static uint32_t hyper_flash_erase_sector(uint32_t sector_addr)
 
 	if (ret == FL_DRV_OK) {
 		/* BIT7: Device Ready Bit (0=Busy, 1=Ready) */
-		ret = common_wait(hyper_flash_read_device_status, &status,
-					HF_ERASE_TIMEOUT, HF_ERASE_WAIT);
+		ret = common_wait_ready(hyper_flash_read_device_status,
+					&status, HF_ERASE_TIMEOUT,
+					HF_ERASE_WAIT, HF_ERASE_SPIN);
 	}
 
 	return ret;
 }
 
-static uint32_t hyper_flash_set_ext_addr_read_mode(uint32_t read_ext_top_addr,
-			uint32_t r_flash_addr, uint8_t *buf, size_t rsize)
+static uint32_t hyper_flash_set_ext_addr_read_mode(uint32_t read_ext_top_addr)
 {
 /*
  *Read (External Address Space Read Mode)
  */
-	uint32_t readFlAddr;
-	uint32_t readData[2];
-	uint32_t ret = FL_DRV_OK;
-
 	uint32_t DREAR_value;
 
 	io_write32((vaddr_t)RPC_PHYCNT, (0x80070263U | phycnt_reg));
@@ -145,16 +142,31 @@ static uint32_t hyper_flash_set_ext_addr_read_mode(uint32_t read_ext_top_addr,
 	 * bit0  INT   = 0 : Interrupt Status
 	 */
 
+	return FL_DRV_OK;
+}
+
+static uint32_t hyper_flash_read_main(uint32_t r_flash_addr, uint8_t *buf,
+			size_t rsize)
+{
+	uint32_t readFlAddr;
+	uint32_t readData[2];
+	uint32_t byte_count = FLASH_DATA_READ_BYTE_COUNT_8;
+	uint32_t ret = FL_DRV_OK;
+
 	/* Output read data */
 	for (readFlAddr = r_flash_addr;
-		readFlAddr < (r_flash_addr+rsize);
-		readFlAddr += FLASH_DATA_READ_BYTE_COUNT_8) {
+		(readFlAddr < (r_flash_addr+rsize)) && (ret == FL_DRV_OK);
+		readFlAddr += byte_count) {
 
+		/* A tail of 4 bytes is not read with a 8 bytes transfer */
+		if (((r_flash_addr + rsize) - readFlAddr) <
+		    FLASH_DATA_READ_BYTE_COUNT_8) {
+			byte_count = FLASH_DATA_READ_BYTE_COUNT_4;
+		}
 		ret = hyper_flash_read_register_data(readFlAddr,
-						readData,
-						FLASH_DATA_READ_BYTE_COUNT_8);
-		(void)memcpy(buf, readData, FLASH_DATA_READ_BYTE_COUNT_8);
-		buf += FLASH_DATA_READ_BYTE_COUNT_8;
+						readData, byte_count);
+		(void)memcpy(buf, readData, byte_count);
+		buf += byte_count;
 	}
 
 	return ret;
@@ -228,7 +240,10 @@ static void hyper_flash_set_control_ops(struct flash_control_operations *ops)
 {
 	ops->erase = hyper_flash_erase_sector;
 	ops->set_ext_addr_read_mode = hyper_flash_set_ext_addr_read_mode;
+	ops->read = hyper_flash_read_main;
 	ops->write = hyper_flash_write_main;
+	ops->read_unit = FLASH_DATA_READ_BYTE_COUNT_4;
+	ops->device_size = HYPER_FLASH_DEVICE_SIZE;
 }
 
 static uint32_t hyper_flash_set_command(uint32_t manual_set_addr,
@@ -476,8 +491,9 @@ static uint32_t hyper_flash_request_write_buffer(uint32_t flash_addr,
 
 	if (ret == FL_DRV_OK) {
 		/* BIT7: Device Ready Bit (0=Busy, 1=Ready) */
-		ret = common_wait(hyper_flash_read_device_status, &status,
-					HF_WRITE_TIMEOUT, HF_WRITE_WAIT);
+		ret = common_wait_ready(hyper_flash_read_device_status,
+					&status, HF_WRITE_TIMEOUT,
+					HF_WRITE_WAIT, HF_WRITE_SPIN);
 	}
 
 	return ret;
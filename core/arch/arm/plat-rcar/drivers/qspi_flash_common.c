@@ -64,8 +64,9 @@ uint32_t qspi_common_erase_control(uint32_t sector_addr)
 	}
 
 	if (ret == FL_DRV_OK) {
-		ret = common_wait(qspi_common_read_device_status, &read_status,
-					QSPI_ERASE_TIMEOUT, QSPI_ERASE_WAIT);
+		ret = common_wait_ready(qspi_common_read_device_status,
+					&read_status, QSPI_ERASE_TIMEOUT,
+					QSPI_ERASE_WAIT, QSPI_ERASE_SPIN);
 	}
 
 	return ret;
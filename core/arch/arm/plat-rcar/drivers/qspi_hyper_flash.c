@@ -13,17 +13,25 @@
 #include "qspi_hyper_flash_common.h"
 #include "qspi_flash_common.h"
 #include "hyper_flash_control.h"
+#ifdef CFG_RCAR_FLASH_SIM
+#include "flash_sim_control.h"
+#endif
 #include "rcar_suspend_to_ram.h"
 #include "rcar_common.h"
 
 uint32_t rpc_clock_mode __nex_data = RPC_CLK_80M;
 uint32_t phycnt_reg __nex_bss;
+/* External address window programmed in the RPC */
+static uint32_t read_ext_top_addr __nex_data = EXT_TOP_ADDR_INVALID;
 
 static void qspi_hyper_flash_backup_cb(enum suspend_to_ram_state state,
 				uint32_t cpu_id);
 static uint32_t erase_flash_unsupported(uint32_t sector_addr);
-static uint32_t ext_addr_read_mode_flash_unsupported(uint32_t read_ext_top_addr,
-			uint32_t flash_addr, uint8_t *buf, size_t rsize);
+static uint32_t ext_addr_read_mode_flash_unsupported(uint32_t read_ext_top_addr);
+static uint32_t read_flash_unsupported(uint32_t flash_addr, uint8_t *buf,
+			size_t rsize);
+static uint32_t read_flash_window(uint32_t flash_addr, uint8_t *buf,
+			size_t rsize);
 static uint32_t write_flash_unsupported(uint32_t buf_addr,
 					uint32_t flash_addr, uint32_t wsize);
 static uint32_t init_rpc_reg_depends_soc(void);
@@ -32,13 +40,17 @@ static uint32_t init_rpc(void);
 static struct flash_control_operations flash_control_ops __nex_data = {
 	.erase = erase_flash_unsupported,
 	.set_ext_addr_read_mode = ext_addr_read_mode_flash_unsupported,
+	.read = read_flash_unsupported,
 	.write = write_flash_unsupported,
+	.read_unit = FLASH_DATA_READ_BYTE_COUNT_8,
+	.device_size = 0U,
 };
 
 static void qspi_hyper_flash_backup_cb(enum suspend_to_ram_state state,
 				uint32_t cpu_id __unused)
 {
 	if (state == SUS2RAM_STATE_RESUME) {
+		read_ext_top_addr = EXT_TOP_ADDR_INVALID;
 		(void)init_rpc();
 	}
 }
@@ -49,6 +61,10 @@ uint32_t qspi_hyper_flash_init(void)
 {
 	uint32_t ret;
 
+#ifdef CFG_RCAR_FLASH_SIM
+	/* RAM backed device, the RPC is not used */
+	ret = flash_sim_init(&flash_control_ops);
+#else
 	ret = init_rpc_reg_depends_soc();
 
 	if (ret == FL_DRV_OK) {
@@ -62,6 +78,7 @@ uint32_t qspi_hyper_flash_init(void)
 	if (ret != FL_DRV_OK) {
 		ret = qspi_common_init(&flash_control_ops);
 	}
+#endif
 
 	return ret;
 }
@@ -83,6 +100,8 @@ uint32_t qspi_hyper_flash_erase(uint32_t sector_addr)
 	if (ret == FL_DRV_OK) {
 		/* erase the according to device id */
 		ret = flash_control_ops.erase(sector_addr);
+		/* The RPC is switched to the manual mode */
+		read_ext_top_addr = EXT_TOP_ADDR_INVALID;
 	}
 
 	DMSG("ret=%d", ret);
@@ -94,7 +113,6 @@ uint32_t qspi_hyper_flash_read(uint32_t flash_addr, uint8_t *buf, size_t rsize)
 {
 	uint32_t ret = FL_DRV_OK;
 	uint32_t check_sector_size;
-	uint32_t ext_top_addr;
 	uint32_t quotient;
 
 	volatile uintptr_t v_flash_addr = (SPI_IOADDRESS_TOP + flash_addr);
@@ -157,16 +175,102 @@ uint32_t qspi_hyper_flash_read(uint32_t flash_addr, uint8_t *buf, size_t rsize)
 	}
 
 	if (ret == FL_DRV_OK) {
-		/* Switch to the external address read mode */
-		ext_top_addr = (flash_addr & EXT_ADDR_MASK);
-		ret = flash_control_ops.set_ext_addr_read_mode(ext_top_addr,
-						flash_addr, buf, rsize);
+		ret = read_flash_window(flash_addr, buf, rsize);
+	}
+
+	DMSG("ret=%d", ret);
+
+	return ret;
+
+}
+
+uint32_t qspi_hyper_flash_read_stream(uint32_t flash_addr, uint8_t *buf,
+				size_t rsize)
+{
+	uint32_t ret = FL_DRV_OK;
+	uint32_t read_addr;
+	uint32_t head_size;
+	uint32_t window_end;
+	uint32_t unit = flash_control_ops.read_unit;
+	size_t read_size;
+	uint8_t unit_buf[FLASH_DATA_READ_BYTE_COUNT_8];
+
+	DMSG("flash_addr=%x, buf=%p, rsize=%zu", flash_addr, buf, rsize);
+
+	if (buf == NULL) {
+		ret = FL_DRV_ERR_BUF_INCORRECT;
+		EMSG("buf is incorrect.");
+	}
+	if (ret == FL_DRV_OK) {
+		if ((rsize > (size_t)flash_control_ops.device_size) ||
+		    (flash_addr > (flash_control_ops.device_size -
+				(uint32_t)rsize))) {
+			ret = FL_DRV_ERR_OUT_OF_RANGE;
+			EMSG("Out of the device. flash_addr=%x, rsize=%zu",
+				flash_addr, rsize);
+		}
+	}
+
+	/*
+	 * The device is read in units of its smallest transfer. Unaligned
+	 * edges go through a unit buffer, the rest is read directly in the
+	 * buffer up to the end of each 64MB external address window.
+	 */
+	while ((ret == FL_DRV_OK) && (rsize > 0U)) {
+		head_size = flash_addr % unit;
+		if ((head_size != 0U) || (rsize < unit)) {
+			read_addr = flash_addr - head_size;
+			read_size = unit - head_size;
+			if (read_size > rsize) {
+				read_size = rsize;
+			}
+			ret = read_flash_window(read_addr, unit_buf, unit);
+			if (ret == FL_DRV_OK) {
+				(void)memcpy(buf, &unit_buf[head_size],
+					read_size);
+			}
+		} else {
+			window_end = (flash_addr & EXT_ADDR_MASK) +
+					EXT_ADD_BORDER_SIZE_64MB;
+			read_size = rsize - (rsize % unit);
+			if ((window_end != 0U) &&
+			    (read_size > (window_end - flash_addr))) {
+				read_size = window_end - flash_addr;
+			}
+			ret = read_flash_window(flash_addr, buf, read_size);
+		}
+		flash_addr += read_size;
+		buf += read_size;
+		rsize -= read_size;
 	}
 
 	DMSG("ret=%d", ret);
 
 	return ret;
+}
+
+static uint32_t read_flash_window(uint32_t flash_addr, uint8_t *buf,
+			size_t rsize)
+{
+	uint32_t ret = FL_DRV_OK;
+	uint32_t ext_top_addr;
+
+	/* Switch to the external address read mode when the window moves */
+	ext_top_addr = (flash_addr & EXT_ADDR_MASK);
+	if (ext_top_addr != read_ext_top_addr) {
+		ret = flash_control_ops.set_ext_addr_read_mode(ext_top_addr);
+		if (ret == FL_DRV_OK) {
+			read_ext_top_addr = ext_top_addr;
+		} else {
+			read_ext_top_addr = EXT_TOP_ADDR_INVALID;
+		}
+	}
+
+	if (ret == FL_DRV_OK) {
+		ret = flash_control_ops.read(flash_addr, buf, rsize);
+	}
 
+	return ret;
 }
 
 uint32_t qspi_hyper_flash_write(uint32_t flash_addr, const uint8_t *buf,
@@ -204,6 +308,8 @@ uint32_t qspi_hyper_flash_write(uint32_t flash_addr, const uint8_t *buf,
 		/* To write the according to device id */
 		ret = flash_control_ops.write((uintptr_t)buf,
 							flash_addr, wsize);
+		/* The RPC is switched to the manual mode */
+		read_ext_top_addr = EXT_TOP_ADDR_INVALID;
 	}
 
 	DMSG("ret=%d", ret);
@@ -219,14 +325,19 @@ static uint32_t erase_flash_unsupported(uint32_t sector_addr __maybe_unused)
 }
 
 static uint32_t ext_addr_read_mode_flash_unsupported(
-			uint32_t read_ext_top_addr __maybe_unused,
-			uint32_t flash_addr __maybe_unused,
-			uint8_t *buf __maybe_unused,
-			size_t rsize __maybe_unused)
+			uint32_t read_ext_top_addr __maybe_unused)
 {
 	EMSG(
 	"Not execute ext_addr_read_mode. Unsupport device. read_ext_addr=%x",
 							read_ext_top_addr);
+	return FL_DRV_ERR_UNSUPPORT_DEV;
+}
+
+static uint32_t read_flash_unsupported(uint32_t flash_addr __maybe_unused,
+			uint8_t *buf __maybe_unused,
+			size_t rsize __maybe_unused)
+{
+	EMSG("Not execute read. Unsupport device.");
 	EMSG("flash_addr=%x , buf=%p, rsize=%zu", flash_addr, buf, rsize);
 	return FL_DRV_ERR_UNSUPPORT_DEV;
 }
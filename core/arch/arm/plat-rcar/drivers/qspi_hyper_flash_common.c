@@ -7,7 +7,9 @@
 #include <kernel/tee_time.h>
 #include <kernel/delay.h>
 #include <kernel/thread.h>
+#include <optee_rpc_cmd.h>
 #include <tee/tee_svc.h>
+#include <utee_defines.h>
 #include <drivers/qspi_hyper_flash.h>
 #include <trace.h>
 #include "qspi_hyper_flash_common.h"
@@ -74,6 +76,78 @@ uint32_t common_wait(uint32_t (*read_status)(uint32_t *), uint32_t *data,
 	return ret;
 }
 
+/*
+ * Waits for the completion of an erase or a program. The device is polled
+ * for @spin us, then the thread is suspended through RPC between polls so
+ * that the CPU is available to the normal world during long operations.
+ * The suspend time starts at COMMON_WAIT_SLEEP_MIN and doubles up to @wait.
+ */
+uint32_t common_wait_ready(uint32_t (*read_status)(uint32_t *),
+			uint32_t *data, uint32_t timeout, uint32_t wait,
+			uint32_t spin)
+{
+	uint32_t ret = FL_DRV_OK;
+	TEE_Result res;
+	TEE_Time base;
+	TEE_Time current_time;
+	TEE_Time elapsed;
+	uint32_t result;
+	uint32_t spin_time = 0U;
+	uint32_t sleep_time = COMMON_WAIT_SLEEP_MIN;
+	struct thread_param params;
+
+	res = tee_time_get_sys_time(&base);
+	if (res != TEE_SUCCESS) {
+		ret = FL_DRV_ERR_GET_SYS_TIME;
+		EMSG("get_sys_time:base res=%x", res);
+	} else {
+		result = read_status(data);
+
+		while ((result == FL_DEVICE_BUSY) && (spin_time < spin)) {
+			udelay(COMMON_WAIT_POLL_US);
+			spin_time += COMMON_WAIT_POLL_US;
+			result = read_status(data);
+		}
+
+		while ((ret == FL_DRV_OK) && (result == FL_DEVICE_BUSY)) {
+			params = THREAD_PARAM_VALUE(IN, sleep_time, 0, 0);
+			res = thread_rpc_cmd(OPTEE_RPC_CMD_SUSPEND, 1, &params);
+			if (res == TEE_SUCCESS) {
+				res = tee_time_get_sys_time(&current_time);
+			}
+
+			if (res == TEE_ERROR_OUT_OF_MEMORY) {
+				ret = FL_DRV_ERR_OUT_OF_MEMORY;
+			} else if (res != TEE_SUCCESS) {
+				ret = FL_DRV_ERR_GET_SYS_TIME;
+			} else {
+				result = read_status(data);
+				TEE_TIME_SUB(current_time, base, elapsed);
+				if ((result == FL_DEVICE_BUSY) &&
+				    (((elapsed.seconds * TEE_TIME_MILLIS_BASE) +
+				      elapsed.millis) >= timeout)) {
+					ret = FL_DRV_ERR_TIMEOUT;
+				}
+			}
+
+			if (ret != FL_DRV_OK) {
+				EMSG("wait error res=%x ret=%d", res, ret);
+			}
+
+			sleep_time *= 2U;
+			if (sleep_time > wait) {
+				sleep_time = wait;
+			}
+		}
+
+		if ((ret == FL_DRV_OK) && (result == FL_DEVICE_ERR)) {
+			ret = FL_DRV_ERR_STATUS_INCORRECT;
+		}
+	}
+
+	return ret;
+}
+
 uint32_t set_rpc_clock_mode(uint32_t mode)
 {
 	uint32_t ret = FL_DRV_OK;
@@ -74,6 +74,10 @@
 #define QSPI_ONBOARD 0x00182001U
 /* HyperFlash : S26KS512S */
 #define HYPER_FLASH 0x007E0001U
+
+/* device size */
+#define QSPI_ONBOARD_DEVICE_SIZE	0x01000000U	/* 128Mbit */
+#define HYPER_FLASH_DEVICE_SIZE		0x04000000U	/* 512Mbit */
 /* Unsupport device */
 #define DEVICE_UNKNOWN 0xFFFFFFFFU
 
@@ -94,6 +98,17 @@
 #define QSPI_READ_WAIT		10U
 #define QSPI_WRITE_WAIT		10U
 
+/* Busy polling time before the CPU is given back (us) */
+#define HF_ERASE_SPIN		0U
+#define HF_WRITE_SPIN		500U
+#define QSPI_ERASE_SPIN		0U
+#define QSPI_WRITE_SPIN		500U
+
+/* Polling interval within the busy polling time (us) */
+#define COMMON_WAIT_POLL_US	10U
+/* First suspend time once the CPU is given back (ms) */
+#define COMMON_WAIT_SLEEP_MIN	1U
+
 #define FL_DEVICE_BUSY		0U
 #define FL_DEVICE_READY		1U
 #define FL_DEVICE_ERR		2U
@@ -144,6 +159,9 @@
 #define ERASE_SIZE_64KB		0x00010000U
 #define EXT_ADD_BORDER_SIZE_64MB 0x04000000U
 
+/* No external address window is programmed (not a masked address) */
+#define EXT_TOP_ADDR_INVALID	0x00000001U
+
 /* read_sector_size_bit on/off flag */
 #define READ_SECTOR_SIZE_BIT_OFF	0U
 #define READ_SECTOR_SIZE_BIT_ON		1U
@@ -175,15 +193,20 @@ extern uint32_t phycnt_reg;
 
 struct flash_control_operations {
 	uint32_t (*erase)(uint32_t sector_addr);
-	uint32_t (*set_ext_addr_read_mode)(uint32_t read_ext_top_addr,
-			uint32_t r_flash_addr, uint8_t *buf, size_t rsize);
+	uint32_t (*set_ext_addr_read_mode)(uint32_t read_ext_top_addr);
+	uint32_t (*read)(uint32_t r_flash_addr, uint8_t *buf, size_t rsize);
 	uint32_t (*write)(uint32_t buf_addr,
 				uint32_t flash_addr, uint32_t wsize);
+	uint32_t read_unit;	/* byte size of the smallest read transfer */
+	uint32_t device_size;	/* byte size of the device */
 };
 
 uint32_t common_wait_spi_transfer(uint32_t *dataL);
 uint32_t common_wait(uint32_t (*read_status)(uint32_t *), uint32_t *data,
 					uint32_t timeout, uint32_t wait);
+uint32_t common_wait_ready(uint32_t (*read_status)(uint32_t *),
+			uint32_t *data, uint32_t timeout, uint32_t wait,
+			uint32_t spin);
 uint32_t set_rpc_clock_mode(uint32_t mode);
 
 #endif /* QSPI_HYPER_FLASH_COMMON_H */
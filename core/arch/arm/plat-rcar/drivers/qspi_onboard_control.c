@@ -14,8 +14,9 @@
 #include "qspi_onboard_control.h"
 
 static uint32_t qspi_onboard_erase_main(uint32_t sector_addr);
-static uint32_t qspi_onboard_set_ext_addr_read_mode(uint32_t read_ext_top_addr,
-			uint32_t r_flash_addr, uint8_t *buf, size_t rsize);
+static uint32_t qspi_onboard_set_ext_addr_read_mode(uint32_t read_ext_top_addr);
+static uint32_t qspi_onboard_read_main(uint32_t r_flash_addr, uint8_t *buf,
+			size_t rsize);
 static uint32_t qspi_onboard_write_main(uint32_t buf_addr,
 					uint32_t flash_addr, uint32_t wsize);
 static uint32_t qspi_onboard_set_sector_erase_size(uint32_t sector_size_bit);
@@ -45,17 +46,13 @@ static uint32_t qspi_onboard_erase_main(uint32_t sector_addr)
 	return ret;
 }
 
-static uint32_t qspi_onboard_set_ext_addr_read_mode(uint32_t read_ext_top_addr,
-			uint32_t r_flash_addr, uint8_t *buf, size_t rsize)
+static uint32_t qspi_onboard_set_ext_addr_read_mode(uint32_t read_ext_top_addr)
 {
 /*
  * for OnBoard QspiFlash(S25FS128S)
  * FAST_READ 0Bh (CR2V[7]=0) is followed by a 3-byte address
  */
-	uint32_t readFlAddr;
-	uint32_t readData;
 	uint32_t DREAR_value;
-	uint32_t ret = FL_DRV_OK;
 
 	io_write32((vaddr_t)RPC_PHYCNT, (0x80030260U | phycnt_reg));
 	io_write32((vaddr_t)RPC_CMNCR, 0x01FF7300U);
@@ -104,9 +101,19 @@ static uint32_t qspi_onboard_set_ext_addr_read_mode(uint32_t read_ext_top_addr,
 	 * bit0 DRDRE  = 0 : DATA SDR transfer
 	 */
 
+	return FL_DRV_OK;
+}
+
+static uint32_t qspi_onboard_read_main(uint32_t r_flash_addr, uint8_t *buf,
+			size_t rsize)
+{
+	uint32_t readFlAddr;
+	uint32_t readData;
+	uint32_t ret = FL_DRV_OK;
+
 	/* Output read data */
 	for (readFlAddr = r_flash_addr;
-		readFlAddr < (r_flash_addr+rsize);
+		(readFlAddr < (r_flash_addr+rsize)) && (ret == FL_DRV_OK);
 		readFlAddr += FLASH_DATA_READ_BYTE_COUNT_4) {
 
 		ret = qspi_onboard_read_flash_data4Byte(readFlAddr, &readData);
@@ -175,7 +182,10 @@ void qspi_onboard_set_control_ops(struct flash_control_operations *ops)
 {
 	ops->erase = qspi_onboard_erase_main;
 	ops->set_ext_addr_read_mode = qspi_onboard_set_ext_addr_read_mode;
+	ops->read = qspi_onboard_read_main;
 	ops->write = qspi_onboard_write_main;
+	ops->read_unit = FLASH_DATA_READ_BYTE_COUNT_4;
+	ops->device_size = QSPI_ONBOARD_DEVICE_SIZE;
 }
 
 static uint32_t qspi_onboard_set_sector_erase_size(uint32_t sector_size_bit)
@@ -366,8 +376,9 @@ static uint32_t qspi_onboard_request_write_buffer(uint32_t flash_addr,
 	}
 
 	if (ret == FL_DRV_OK) {
-		ret = common_wait(qspi_common_read_device_status, &read_status,
-					QSPI_WRITE_TIMEOUT, QSPI_WRITE_WAIT);
+		ret = common_wait_ready(qspi_common_read_device_status,
+					&read_status, QSPI_WRITE_TIMEOUT,
+					QSPI_WRITE_WAIT, QSPI_WRITE_SPIN);
 	}
 
 	return ret;
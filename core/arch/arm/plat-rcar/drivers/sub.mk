@@ -6,3 +6,4 @@ srcs-$(CFG_HYPER_FLASH) += qspi_hyper_flash.c
 srcs-$(CFG_HYPER_FLASH) += hyper_flash_control.c
 srcs-$(CFG_HYPER_FLASH) += qspi_flash_common.c
 srcs-$(CFG_HYPER_FLASH) += qspi_onboard_control.c
+srcs-$(CFG_RCAR_FLASH_SIM) += flash_sim_control.c
@@ -34,6 +34,8 @@ uint32_t qspi_hyper_flash_init(void);
 uint32_t qspi_hyper_flash_erase(uint32_t sector_addr);
 uint32_t qspi_hyper_flash_read(uint32_t flash_addr, uint8_t *buf,
 				size_t rsize);
+uint32_t qspi_hyper_flash_read_stream(uint32_t flash_addr, uint8_t *buf,
+				size_t rsize);
 uint32_t qspi_hyper_flash_write(uint32_t flash_addr, const uint8_t *buf,
 				size_t wsize);
 
@@ -3,6 +3,7 @@
  * Copyright (c) 2015-2020, Renesas Electronics Corporation
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <platform_config.h>
 #include <kernel/misc.h>
@@ -11,6 +12,8 @@
 #include <kernel/tz_proc_def.h>
 #include <kernel/linker.h>
 #include <kernel/spinlock.h>
+#include <atomic.h>
+#include <arm.h>
 #include <optee_msg.h>
 #include <mm/core_mmu.h>
 #include <initcall.h>
@@ -20,8 +23,19 @@
 #include "rcar_common.h"
 #include "rcar_version.h"
 
+/* Declaration of internal function */
+static void log_ring_copy_in(struct log_cpu_ring_t *ring, uint32_t pos,
+		const int8_t *src, size_t len);
+static void log_ring_copy_out(const struct log_cpu_ring_t *ring,
+		uint32_t pos, int8_t *dst, size_t len);
+static struct log_cpu_ring_t *log_ring_oldest(void);
+static void log_ring_drain(void);
+static void log_ring_report_lost(void);
+static bool log_ring_pending(void);
+
 struct log_buf_header_t *log_secram_header __nex_data;
 static int8_t *log_nonsec_ptr __nex_bss;
+static struct log_cpu_ring_t log_cpu_ring[CFG_TEE_CORE_NB_CORE] __nex_bss;
 uint32_t log_spin_lock __nex_bss;
 int32_t is_normal_world_initialized __nex_bss;
 const int8_t version_of_renesas[] __attribute__((__section__(".version"))) =
@@ -110,6 +124,239 @@ void log_buf_write(const struct msg_block_t *msg_block, int32_t msg_block_num)
 	}
 }
 
+static void log_ring_copy_in(struct log_cpu_ring_t *ring, uint32_t pos,
+		const int8_t *src, size_t len)
+{
+	uint32_t offs = pos & LOG_CPU_RING_MASK;
+	size_t first = MIN(len, (size_t)LOG_CPU_RING_SIZE - offs);
+
+	(void)memcpy(&ring->buf[offs], src, first);
+	if (first < len) {
+		(void)memcpy(&ring->buf[0], &src[first], len - first);
+	}
+}
+
+static void log_ring_copy_out(const struct log_cpu_ring_t *ring,
+		uint32_t pos, int8_t *dst, size_t len)
+{
+	uint32_t offs = pos & LOG_CPU_RING_MASK;
+	size_t first = MIN(len, (size_t)LOG_CPU_RING_SIZE - offs);
+
+	(void)memcpy(dst, &ring->buf[offs], first);
+	if (first < len) {
+		(void)memcpy(&dst[first], &ring->buf[0], len - first);
+	}
+}
+
+/*
+ * Write a record to the ring of @cpu_id. Called on @cpu_id with all
+ * exceptions masked, so the ring has a single writer. The record is
+ * dropped if the ring is full.
+ */
+void log_ring_write(uint32_t cpu_id, uint64_t stamp,
+		const struct msg_block_t *msg_block, int32_t msg_block_num)
+{
+	struct log_cpu_ring_t *ring;
+	struct log_rec_hdr_t hdr = {0U, 0U, 0U};
+	size_t rec_size = 0U;
+	size_t wsize;
+	uint32_t pos;
+	uint32_t used;
+	int32_t i;
+
+	if (cpu_id < (uint32_t)CFG_TEE_CORE_NB_CORE) {
+		ring = &log_cpu_ring[cpu_id];
+
+		for (i = 0; i < msg_block_num; i++) {
+			rec_size += msg_block[i].size;
+		}
+		rec_size = MIN(rec_size,
+			(size_t)LOG_CPU_RING_SIZE - sizeof(hdr));
+
+		/* Reserve */
+		pos = ring->reserve;
+		used = pos - atomic_load_u32(&ring->tail);
+		if ((used + sizeof(hdr) + rec_size) > LOG_CPU_RING_SIZE) {
+			atomic_store_u32(&ring->lost, ring->lost + 1U);
+		} else {
+			ring->reserve = pos +
+				(uint32_t)(sizeof(hdr) + rec_size);
+
+			hdr.stamp = stamp;
+			hdr.size = (uint32_t)rec_size;
+			log_ring_copy_in(ring, pos, (const int8_t *)&hdr,
+				sizeof(hdr));
+			pos += (uint32_t)sizeof(hdr);
+			for (i = 0; (i < msg_block_num) && (rec_size > 0U);
+			     i++) {
+				wsize = MIN(msg_block[i].size, rec_size);
+				log_ring_copy_in(ring, pos, msg_block[i].addr,
+					wsize);
+				pos += (uint32_t)wsize;
+				rec_size -= wsize;
+			}
+
+			/* Commit, the record is written before it is seen */
+			dsb_ish();
+			atomic_store_u32(&ring->commit, ring->reserve);
+		}
+	}
+}
+
+/* Ring with the oldest committed record, NULL if all rings are empty */
+static struct log_cpu_ring_t *log_ring_oldest(void)
+{
+	struct log_cpu_ring_t *oldest = NULL;
+	struct log_rec_hdr_t hdr;
+	uint64_t oldest_stamp = 0U;
+	uint32_t i;
+
+	for (i = 0U; i < (uint32_t)CFG_TEE_CORE_NB_CORE; i++) {
+		if (atomic_load_u32(&log_cpu_ring[i].commit) !=
+		    log_cpu_ring[i].tail) {
+			dsb_ish();
+			log_ring_copy_out(&log_cpu_ring[i],
+				log_cpu_ring[i].tail, (int8_t *)&hdr,
+				sizeof(hdr));
+			if ((oldest == NULL) || (hdr.stamp < oldest_stamp)) {
+				oldest = &log_cpu_ring[i];
+				oldest_stamp = hdr.stamp;
+			}
+		}
+	}
+
+	return oldest;
+}
+
+/*
+ * Merge the committed records of all rings into the Logging RAM in time
+ * order. Called with log_spin_lock held.
+ */
+static void log_ring_drain(void)
+{
+	struct log_cpu_ring_t *ring;
+	struct log_rec_hdr_t hdr;
+	struct msg_block_t msg_block[2];
+	uint32_t pos;
+	uint32_t offs;
+	size_t first;
+
+	ring = log_ring_oldest();
+	while (ring != NULL) {
+		log_ring_copy_out(ring, ring->tail, (int8_t *)&hdr,
+			sizeof(hdr));
+		pos = ring->tail + (uint32_t)sizeof(hdr);
+		offs = pos & LOG_CPU_RING_MASK;
+		first = MIN((size_t)hdr.size,
+			(size_t)LOG_CPU_RING_SIZE - offs);
+
+		/* The record may wrap around the end of the ring */
+		msg_block[0].addr = &ring->buf[offs];
+		msg_block[0].size = first;
+		msg_block[1].addr = &ring->buf[0];
+		msg_block[1].size = (size_t)hdr.size - first;
+		log_buf_write(msg_block, 2);
+
+		/* The record is read before its space is reused */
+		dsb_ish();
+		atomic_store_u32(&ring->tail, pos + hdr.size);
+
+		ring = log_ring_oldest();
+	}
+
+	log_ring_report_lost();
+}
+
+/*
+ * Write a marker with the number of records dropped on each ring since
+ * the last report. Called with log_spin_lock held.
+ */
+static void log_ring_report_lost(void)
+{
+	int8_t lost_buf[LOG_LOST_BUF_MAX_SIZE];
+	struct msg_block_t msg_block[2];
+#ifdef CFG_RCAR_TRACE_BINARY
+	struct log_bin_rec_t rec;
+#endif
+	uint32_t lost;
+	int32_t res;
+	uint32_t i;
+
+	for (i = 0U; i < (uint32_t)CFG_TEE_CORE_NB_CORE; i++) {
+		lost = atomic_load_u32(&log_cpu_ring[i].lost);
+		res = 0;
+		if (lost != log_cpu_ring[i].lost_reported) {
+			res = snprintf((char *)lost_buf, sizeof(lost_buf),
+				"[%u] %u messages lost\n", i,
+				lost - log_cpu_ring[i].lost_reported);
+			log_cpu_ring[i].lost_reported = lost;
+		}
+		if (0 < res) {
+			msg_block[1].addr = lost_buf;
+			msg_block[1].size = MIN((size_t)res,
+				sizeof(lost_buf) - 1U);
+#ifdef CFG_RCAR_TRACE_BINARY
+			/* A text record, as written by log_bin_write_text() */
+			(void)memset(&rec, 0, sizeof(rec));
+			rec.magic = (uint16_t)LOG_BIN_MAGIC;
+			rec.size = (uint16_t)(sizeof(rec) + msg_block[1].size);
+			rec.core = (uint8_t)i;
+			rec.level = (uint8_t)LOG_BIN_LEVEL_NONE;
+			rec.fmt = LOG_BIN_NONE;
+			rec.func = LOG_BIN_NONE;
+			rec.cntpct = barrier_read_cntpct();
+			msg_block[0].addr = (const int8_t *)&rec;
+			msg_block[0].size = sizeof(rec);
+#else
+			msg_block[0].addr = lost_buf;
+			msg_block[0].size = 0U;
+#endif
+			log_buf_write(msg_block, 2);
+		}
+	}
+}
+
+static bool log_ring_pending(void)
+{
+	bool pending = false;
+	uint32_t i;
+
+	for (i = 0U; i < (uint32_t)CFG_TEE_CORE_NB_CORE; i++) {
+		if (atomic_load_u32(&log_cpu_ring[i].commit) !=
+		    atomic_load_u32(&log_cpu_ring[i].tail)) {
+			pending = true;
+			break;
+		}
+	}
+
+	return pending;
+}
+
+/*
+ * Merge the rings into the Logging RAM unless another CPU is doing it.
+ * That CPU then also merges the records committed before this call, as
+ * it checks the rings again after releasing log_spin_lock.
+ */
+void log_ring_flush(void)
+{
+	uint32_t exceptions;
+	bool retry = true;
+
+	exceptions = thread_mask_exceptions(THREAD_EXCP_FOREIGN_INTR);
+	while (retry) {
+		retry = false;
+		/* Order the commit or the unlock before the next check */
+		dsb_ish();
+		if (cpu_spin_trylock(&log_spin_lock)) {
+			log_ring_drain();
+			cpu_spin_unlock(&log_spin_lock);
+			dsb_ish();
+			retry = log_ring_pending();
+		}
+	}
+	thread_unmask_exceptions(exceptions);
+}
+
 #ifdef RCAR_DEBUG_LOG
 void log_debug_send(const struct msg_block_t *msg_block, int32_t msg_block_num)
 {
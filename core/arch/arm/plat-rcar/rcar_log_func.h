@@ -20,10 +20,23 @@
 #define LOG_AREA_MAX_SIZE	(LOG_RAM_MAX_SIZE - \
 				(LOG_RAM_HEADER_SIZE + LOG_RAM_RESERVE_SIZE))
 #define LOG_TIME_BUF_MAX_SIZE	(31)
+#define LOG_LOST_BUF_MAX_SIZE	(48)
 #define LOG_NS_CPU_AREA_SIZE	(1024U)
-#define LOG_SEC_PREFIX		"SLOG"
+#ifdef CFG_RCAR_TRACE_BINARY
+#define LOG_SEC_PREFIX		"BLOG"	/* records of struct log_bin_rec_t */
+#else
+#define LOG_SEC_PREFIX		"SLOG"	/* text lines */
+#endif
 #define LOG_SEC_PREFIX_LEN	(4)
 #define LOG_SEND_MAX_SIZE	(256U)
+#define LOG_CPU_RING_SIZE	(4096U)	/* power of 2 */
+#define LOG_CPU_RING_MASK	(LOG_CPU_RING_SIZE - 1U)
+
+#define LOG_BIN_MAGIC		(0xB10FU)
+#define LOG_BIN_NONE		(0xFFFFFFFFU)	/* no format, text record */
+#define LOG_BIN_LEVEL_NONE	(0xFFU)		/* not tagged with a level */
+#define LOG_BIN_ARGS_MAX_SIZE	(128U)
+#define LOG_BIN_STR_MAX_LEN	(64U)
 
 #define SECRAM_MSG_BLK_NUM	(2)
 #define SECRAM_IDX_TIME		(0)
@@ -56,6 +69,47 @@ struct msg_block_t {
 	size_t size;
 };
 
+/*
+ * Per-CPU log ring. The CPU reserves space at @reserve, copies a record
+ * and commits it by moving @commit up to @reserve. The records up to
+ * @commit are merged into the Logging RAM by the holder of log_spin_lock,
+ * which moves @tail. The indexes run free and are masked on access.
+ */
+struct log_cpu_ring_t {
+	uint32_t reserve;
+	uint32_t commit;
+	uint32_t tail;
+	uint32_t lost;		/* records dropped on a full ring */
+	uint32_t lost_reported;	/* @lost when last reported by the merger */
+	int8_t buf[LOG_CPU_RING_SIZE];
+};
+
+/*
+ * Binary trace record, followed by the raw arguments of the format string
+ * in the order they are converted:
+ *  - integers and pointers with the size of their C type,
+ *  - %s as a length byte and up to LOG_BIN_STR_MAX_LEN characters,
+ *  - %pUl as the 16 bytes of the UUID.
+ * @fmt and @func are offsets from __text_start of tee.elf. A text record
+ * has @fmt set to LOG_BIN_NONE and is followed by the text.
+ */
+struct log_bin_rec_t {
+	uint16_t magic;
+	uint16_t size;		/* bytes including this header */
+	uint8_t core;
+	uint8_t level;
+	uint16_t line;
+	uint32_t fmt;
+	uint32_t func;
+	uint64_t cntpct;
+} __packed;
+
+struct log_rec_hdr_t {
+	uint64_t stamp;		/* CNTPCT when the record was written */
+	uint32_t size;		/* bytes following the header */
+	uint32_t reserve;
+};
+
 /*
  * Global variable declaration
  */
@@ -69,6 +123,13 @@ extern int32_t is_normal_world_initialized;
  */
 void log_buf_init(void);
 void log_buf_write(const struct msg_block_t *msg_block, int32_t msg_block_num);
+void log_ring_write(uint32_t cpu_id, uint64_t stamp,
+		const struct msg_block_t *msg_block, int32_t msg_block_num);
+void log_ring_flush(void);
+#ifdef CFG_RCAR_TRACE_BINARY
+void log_bin_write_text(uint32_t cpu_id, uint64_t stamp,
+		const struct msg_block_t *msg_block, int32_t msg_block_num);
+#endif /* CFG_RCAR_TRACE_BINARY */
 #ifdef RCAR_DEBUG_LOG
 void log_debug_send(const struct msg_block_t *msg_block, int32_t msg_block_num);
 #endif /* RCAR_DEBUG_LOG */
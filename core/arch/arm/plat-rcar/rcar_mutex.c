@@ -53,3 +53,45 @@ void rcar_nex_mutex_unlock(struct mutex *m)
 	mutex_unlock(m);
 #endif
 }
+
+void rcar_nex_mutex_read_lock(struct mutex *m)
+{
+#ifdef CFG_VIRTUALIZATION
+	bool can_lock;
+	TEE_Result res = TEE_SUCCESS;
+	struct thread_param params = THREAD_PARAM_VALUE(IN,
+					CFG_RCAR_MUTEX_DELAY, 0, 0);
+
+	can_lock = mutex_read_trylock(m);
+
+	while (!can_lock) {
+		res = thread_rpc_cmd(OPTEE_RPC_CMD_SUSPEND, 1, &params);
+
+		if (res != TEE_SUCCESS) {
+			panic("rcar_nex_mutex_read_lock failed");
+		}
+		can_lock = mutex_read_trylock(m);
+	}
+#else
+	mutex_read_lock(m);
+#endif
+}
+
+void rcar_nex_mutex_read_unlock(struct mutex *m)
+{
+#ifdef CFG_VIRTUALIZATION
+	uint32_t old_itr_status;
+
+	old_itr_status = cpu_spin_lock_xsave(&m->spin_lock);
+
+	if (m->state <= 0){
+		panic("rcar_nex_mutex_read_unlock failed");
+	}
+
+	m->state--;
+
+	cpu_spin_unlock_xrestore(&m->spin_lock, old_itr_status);
+#else
+	mutex_read_unlock(m);
+#endif
+}
@@ -8,5 +8,7 @@
 
 void rcar_nex_mutex_lock(struct mutex *m);
 void rcar_nex_mutex_unlock(struct mutex *m);
+void rcar_nex_mutex_read_lock(struct mutex *m);
+void rcar_nex_mutex_read_unlock(struct mutex *m);
 
 #endif /* RCAR_MUTEX_H */
@@ -3,10 +3,16 @@
  * Copyright (c) 2015-2020, Renesas Electronics Corporation
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include <io.h>
 #include <trace.h>
+#include <util.h>
+#include <crypto/crypto.h>
 #include <kernel/mutex.h>
+#include <kernel/panic.h>
+#include <kernel/thread.h>
+#include <optee_rpc_cmd.h>
 
 #include "rcar_common.h"
 #include "rcar_maskrom.h"
@@ -19,11 +25,22 @@
 #define TA_NONCACHE_STACK_AREA_SIZE	(4096U)
 #define TA_NONCACHE_STACK_ADDR		(TA_VERIFICATION_BASE + \
 					TA_VERIFICATION_SIZE)
-#define TA_CONTENT_CERT_ADDR		(TA_NONCACHE_STACK_ADDR - \
-					TA_NONCACHE_STACK_AREA_SIZE - \
+#define TA_SLOT_NUM			((uint32_t)CFG_RCAR_TA_VERIFICATION_SLOTS)
+#define TA_SLOT_ALIGN			(4096U)
+#define TA_SLOT_SIZE			ROUNDDOWN((TA_VERIFICATION_SIZE - \
+					TA_NONCACHE_STACK_AREA_SIZE) / \
+					TA_SLOT_NUM, TA_SLOT_ALIGN)
+#define TA_SLOT_BASE(slot)		(TA_VERIFICATION_BASE + \
+					((slot) * TA_SLOT_SIZE))
+#define TA_CONTENT_CERT_OFS		(TA_SLOT_SIZE - \
 					TA_CONTENT_CERT_AREA_SIZE)
-#define TA_KEY_CERT_ADDR		(TA_CONTENT_CERT_ADDR - \
+#define TA_KEY_CERT_OFS			(TA_CONTENT_CERT_OFS - \
 					TA_KEY_CERT_AREA_SIZE)
+#if ((TA_VERIFICATION_SIZE - TA_NONCACHE_STACK_AREA_SIZE) / \
+	CFG_RCAR_TA_VERIFICATION_SLOTS) < (TA_SLOT_ALIGN + \
+	TA_KEY_CERT_AREA_SIZE + TA_CONTENT_CERT_AREA_SIZE)
+#error "Too many TA verification slots"
+#endif
 #define CERT_SIGNATURE_SIZE		(256U)
 #define CERT_STORE_ADDR_SIZE		(8U)
 #define CERT_REC_LEN_SIZE		(4U)
@@ -35,6 +52,7 @@
 #define CERT_IDX_VER			(1)
 #define CERT_IDX_SIZE			(2)
 #define CERT_IDX_FLAG			(3)
+#define CERT_HEADER_SIZE		((CERT_IDX_FLAG + 1U) * 4U)
 #define RST_MODEMR			(p2v_ioadr(RST_BASE) + 0x0060U)
 #define MFIS_SOFTMDR			(p2v_ioadr(MFIS_BASE) + 0x0600U)
 #define LCS_CM				(0x0U)
@@ -45,19 +63,38 @@
 #define SECURE_BOOT_MODE		(0U)
 #define NORMAL_BOOT_MODE		(1U)
 #define CERT_IDX_MEM_LOAD_ADDR	(84U)
-#define TA_OBJ_SIZE				((TA_KEY_CERT_ADDR - \
-					TA_VERIFICATION_BASE) / CERT_BLOCK_SIZE)
+#define TA_OBJ_SIZE			(TA_KEY_CERT_OFS / CERT_BLOCK_SIZE)
 
 /* Declaration of internal function */
 static uint32_t get_key_cert_size(const uint32_t *cert_header);
 static uint32_t get_content_cert_size(const uint32_t *cert_header);
 static uint32_t get_object_size(const uint32_t *content_cert);
 static uint32_t get_auth_mode(void);
-static uint32_t call_maskrom_api(void);
+static uint32_t call_maskrom_api(void *slot_base);
 static uint64_t check_object_addr(const uint32_t *cert_header);
+static uint32_t get_slot(uint64_t object_addr);
+static void acquire_slot(uint32_t slot);
+static void release_slot(uint32_t slot);
+static TEE_Result get_cert_digest(const uint8_t *key_cert,
+				uint32_t key_cert_size,
+				const uint8_t *content_cert,
+				uint32_t content_cert_size, uint8_t *digest);
 
 static struct mutex g_rom_api_mutex __nex_data = MUTEX_INITIALIZER;
 
+/*
+ * The verification area is split into slots. The MaskROM verifies the
+ * object at the load address signed in the content certificate, so each
+ * TA is verified in the slot starting at its load address. A slot is
+ * owned from the copy of the TA until rcar_auth_ta_release(), and only
+ * the MaskROM call itself is serialized between the slots.
+ */
+static struct mutex g_slot_mutex __nex_data = MUTEX_INITIALIZER;
+#ifndef CFG_VIRTUALIZATION
+static struct condvar g_slot_cv __nex_data = CONDVAR_INITIALIZER;
+#endif
+static bool g_slot_busy[CFG_RCAR_TA_VERIFICATION_SLOTS] __nex_bss;
+
 static uint32_t get_key_cert_size(const uint32_t *cert_header)
 {
 	uint32_t cert_size = 0U;
@@ -192,11 +229,13 @@ static uint32_t get_auth_mode(void)
 }
 
 /* This function operates in a non-cached stack. */
-static uint32_t call_maskrom_api(void)
+static uint32_t call_maskrom_api(void *slot_base)
 {
 	uint32_t ret;
-	uint32_t *key_cert = (uint32_t *)TA_KEY_CERT_ADDR;
-	uint32_t *content_cert = (uint32_t *)TA_CONTENT_CERT_ADDR;
+	uint32_t *key_cert = (uint32_t *)((uint8_t *)slot_base +
+			TA_KEY_CERT_OFS);
+	uint32_t *content_cert = (uint32_t *)((uint8_t *)slot_base +
+			TA_CONTENT_CERT_OFS);
 	uint32_t hwlock;
 
 	hw_engine_lock(&hwlock, HWENG_SECURE_CORE);
@@ -208,8 +247,90 @@ static uint32_t call_maskrom_api(void)
 	return ret;
 }
 
+/* Slot whose object area starts at the load address, TA_SLOT_NUM if none */
+static uint32_t get_slot(uint64_t object_addr)
+{
+	uint32_t slot = TA_SLOT_NUM;
+	uint64_t ofs;
+
+	if (object_addr >= TA_VERIFICATION_BASE) {
+		ofs = object_addr - TA_VERIFICATION_BASE;
+		if (((ofs % TA_SLOT_SIZE) == 0U) &&
+			((ofs / TA_SLOT_SIZE) < TA_SLOT_NUM)) {
+			slot = (uint32_t)(ofs / TA_SLOT_SIZE);
+		}
+	}
+
+	return slot;
+}
+
+static void acquire_slot(uint32_t slot)
+{
+#ifdef CFG_VIRTUALIZATION
+	TEE_Result res;
+	struct thread_param params = THREAD_PARAM_VALUE(IN,
+					CFG_RCAR_MUTEX_DELAY, 0, 0);
+#endif
+
+	rcar_nex_mutex_lock(&g_slot_mutex);
+	while (g_slot_busy[slot]) {
+#ifdef CFG_VIRTUALIZATION
+		/* The owner may run in another guest, so poll */
+		rcar_nex_mutex_unlock(&g_slot_mutex);
+		res = thread_rpc_cmd(OPTEE_RPC_CMD_SUSPEND, 1, &params);
+		if (res != TEE_SUCCESS) {
+			panic("acquire_slot failed");
+		}
+		rcar_nex_mutex_lock(&g_slot_mutex);
+#else
+		condvar_wait(&g_slot_cv, &g_slot_mutex);
+#endif
+	}
+	g_slot_busy[slot] = true;
+	rcar_nex_mutex_unlock(&g_slot_mutex);
+}
+
+static void release_slot(uint32_t slot)
+{
+	rcar_nex_mutex_lock(&g_slot_mutex);
+	g_slot_busy[slot] = false;
+#ifndef CFG_VIRTUALIZATION
+	condvar_broadcast(&g_slot_cv);
+#endif
+	rcar_nex_mutex_unlock(&g_slot_mutex);
+}
+
+/* Digest of the key and content certificates */
+static TEE_Result get_cert_digest(const uint8_t *key_cert,
+				uint32_t key_cert_size,
+				const uint8_t *content_cert,
+				uint32_t content_cert_size, uint8_t *digest)
+{
+	TEE_Result res;
+	void *ctx = NULL;
+
+	res = crypto_hash_alloc_ctx(&ctx, TEE_ALG_SHA256);
+	if (res == TEE_SUCCESS) {
+		res = crypto_hash_init(ctx);
+	}
+	if (res == TEE_SUCCESS) {
+		res = crypto_hash_update(ctx, key_cert, key_cert_size);
+	}
+	if (res == TEE_SUCCESS) {
+		res = crypto_hash_update(ctx, content_cert,
+			content_cert_size);
+	}
+	if (res == TEE_SUCCESS) {
+		res = crypto_hash_final(ctx, digest, TEE_SHA256_HASH_SIZE);
+	}
+	crypto_hash_free_ctx(ctx);
+
+	return res;
+}
+
 TEE_Result rcar_auth_ta_certificate(const struct shdr *key_cert,
-				struct shdr **secmem_ta)
+				struct shdr **secmem_ta,
+				struct rcar_ta_auth_info *info)
 {
 	TEE_Result res = TEE_SUCCESS;
 	uint32_t ret;
@@ -218,11 +339,9 @@ TEE_Result rcar_auth_ta_certificate(const struct shdr *key_cert,
 	uint32_t object_size = 0U;
 	uint32_t auth_mode;
 	const uint32_t *content_cert;
-	struct shdr *fixed_ta = (struct shdr *)TA_VERIFICATION_BASE;
-	uint8_t *fixed_base = (uint8_t *)TA_VERIFICATION_BASE;
-	uint8_t *fixed_key_cert = (uint8_t *)TA_KEY_CERT_ADDR;
-	uint8_t *fixed_content_cert = (uint8_t *)TA_CONTENT_CERT_ADDR;
+	uint8_t *fixed_base = NULL;
 	uint64_t object_addr;
+	uint32_t slot = TA_SLOT_NUM;
 
 	key_cert_size = get_key_cert_size((const uint32_t *)key_cert);
 	if ((key_cert_size == 0U) || (key_cert_size > TA_KEY_CERT_AREA_SIZE)) {
@@ -248,10 +367,11 @@ TEE_Result rcar_auth_ta_certificate(const struct shdr *key_cert,
 	DMSG("TA size: key_cert=0x%x content_cert=0x%x shdr+bin=0x%x",
 		key_cert_size, content_cert_size, object_size);
 
-	/* check the address of loading TA is the top of verification area */
+	/* check the address of loading TA is the top of a slot */
 	if (res == TEE_SUCCESS) {
 		object_addr = check_object_addr(content_cert);
-		if (object_addr != TA_VERIFICATION_BASE) {
+		slot = get_slot(object_addr);
+		if (slot >= TA_SLOT_NUM) {
 			res = TEE_ERROR_SECURITY;
 		}
 	}
@@ -259,25 +379,33 @@ TEE_Result rcar_auth_ta_certificate(const struct shdr *key_cert,
 	/*
 	 *   Fixed memory map          | TotalSize=TA_VERIFICATION_SIZE
 	 * ---------------------------------------------------------------
-	 * | TA object data area       | TotalSize - [1] - [2] - [3]     |
+	 * | Slot 0 .. Slot N-1        | N * [4], N=TA_SLOT_NUM          |
+	 * ---------------------------------------------------------------
+	 * | Non-cache Stack area      | [3]=TA_NONCACHE_STACK_AREA_SIZE |
+	 * ---------------------------------------------------------------
+	 *
+	 *   Slot memory map           | [4]=TA_SLOT_SIZE
+	 * ---------------------------------------------------------------
+	 * | TA object data area       | [4] - [1] - [2]                 |
 	 * | (signed header + binary)  |                                 |
 	 * ---------------------------------------------------------------
 	 * | Key Certificate area      | [1]=TA_KEY_CERT_AREA_SIZE       |
 	 * ---------------------------------------------------------------
 	 * | Content Certificate area  | [2]=TA_CONTENT_CERT_AREA_SIZE   |
 	 * ---------------------------------------------------------------
-	 * | Non-cache Stack area      | [3]=TA_NONCACHE_STACK_AREA_SIZE |
-	 * ---------------------------------------------------------------
 	 */
 	if (res == TEE_SUCCESS) {
+		acquire_slot(slot);
+		fixed_base = (uint8_t *)(uintptr_t)TA_SLOT_BASE(slot);
+
 		/* copy to fixed memory */
 		(void)memcpy(fixed_base,
 			(const uint8_t *)content_cert + content_cert_size,
 			object_size);
-		(void)memcpy(fixed_key_cert,
+		(void)memcpy(fixed_base + TA_KEY_CERT_OFS,
 			(const uint8_t *)key_cert,
 			key_cert_size);
-		(void)memcpy(fixed_content_cert,
+		(void)memcpy(fixed_base + TA_CONTENT_CERT_OFS,
 			(const uint8_t *)content_cert,
 			content_cert_size);
 
@@ -288,12 +416,12 @@ TEE_Result rcar_auth_ta_certificate(const struct shdr *key_cert,
 			rcar_nex_mutex_lock(&g_rom_api_mutex);
 			ret = asm_switch_stack_pointer(
 				(uintptr_t)call_maskrom_api,
-				TA_NONCACHE_STACK_ADDR, NULL);
+				TA_NONCACHE_STACK_ADDR, fixed_base);
 			rcar_nex_mutex_unlock(&g_rom_api_mutex);
 
 			if (ret == 0U) {
-				DMSG("[%s] Secure boot success!", product_name);
-				*secmem_ta = fixed_ta;
+				DMSG("[%s] Secure boot success! slot=%u",
+					product_name, slot);
 			} else {
 				EMSG("[%s] Secure boot error. 0x%x",
 					product_name, ret);
@@ -301,7 +429,19 @@ TEE_Result rcar_auth_ta_certificate(const struct shdr *key_cert,
 			}
 		} else {
 			DMSG("[%s] Normal boot", product_name);
-			*secmem_ta = fixed_ta;
+		}
+
+		if ((res == TEE_SUCCESS) && (info != NULL)) {
+			info->object_size = object_size;
+			res = get_cert_digest(fixed_base + TA_KEY_CERT_OFS,
+				key_cert_size, fixed_base + TA_CONTENT_CERT_OFS,
+				content_cert_size, info->cert_digest);
+		}
+
+		if (res == TEE_SUCCESS) {
+			*secmem_ta = (struct shdr *)fixed_base;
+		} else {
+			release_slot(slot);
 		}
 	} else {
 		EMSG("Security error. r=0x%x", res);
@@ -309,3 +449,70 @@ TEE_Result rcar_auth_ta_certificate(const struct shdr *key_cert,
 
 	return res;
 }
+
+/*
+ * Digest the key and content certificates at the top of a TA image of
+ * @size bytes, the same way as rcar_auth_ta_certificate() does for the
+ * verified image. The certificates are copied to secure memory first.
+ */
+TEE_Result rcar_auth_ta_cert_digest(const void *ta, size_t size,
+				uint8_t *digest)
+{
+	TEE_Result res = TEE_SUCCESS;
+	uint8_t *certs;
+	size_t certs_size;
+	uint32_t key_cert_size = 0U;
+	uint32_t content_cert_size = 0U;
+
+	certs_size = MIN(size, (size_t)RCAR_TA_CERTS_MAX_SIZE);
+	certs = malloc(certs_size);
+	if (certs == NULL) {
+		res = TEE_ERROR_OUT_OF_MEMORY;
+	} else {
+		(void)memcpy(certs, ta, certs_size);
+		if (certs_size >= CERT_HEADER_SIZE) {
+			key_cert_size = get_key_cert_size(
+				(const uint32_t *)certs);
+		}
+		if ((key_cert_size == 0U) ||
+			(key_cert_size > TA_KEY_CERT_AREA_SIZE) ||
+			((key_cert_size + CERT_HEADER_SIZE) > certs_size)) {
+			res = TEE_ERROR_SECURITY;
+		}
+	}
+
+	if (res == TEE_SUCCESS) {
+		content_cert_size = get_content_cert_size(
+			(const uint32_t *)(certs + key_cert_size));
+		if ((content_cert_size == 0U) ||
+			(content_cert_size > TA_CONTENT_CERT_AREA_SIZE) ||
+			((key_cert_size + content_cert_size) > certs_size)) {
+			res = TEE_ERROR_SECURITY;
+		}
+	}
+
+	if (res == TEE_SUCCESS) {
+		res = get_cert_digest(certs, key_cert_size,
+			certs + key_cert_size, content_cert_size, digest);
+	}
+	free(certs);
+
+	return res;
+}
+
+/*
+ * Release the slot of a TA verified by rcar_auth_ta_certificate() once
+ * the verified image is not read any more.
+ */
+void rcar_auth_ta_release(const struct shdr *secmem_ta)
+{
+	uint32_t slot;
+
+	if (secmem_ta != NULL) {
+		slot = get_slot((uint64_t)(uintptr_t)secmem_ta);
+		if (slot >= TA_SLOT_NUM) {
+			panic("rcar_auth_ta_release slot");
+		}
+		release_slot(slot);
+	}
+}
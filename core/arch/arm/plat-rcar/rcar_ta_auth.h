@@ -6,11 +6,26 @@
 #ifndef RCAR_TA_AUTH_H
 #define RCAR_TA_AUTH_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <signed_hdr.h>
 #include "tee_api_types.h"
+#include "utee_defines.h"
+
+/* Largest key and content certificates at the top of a TA image */
+#define RCAR_TA_CERTS_MAX_SIZE	(8192U)
+
+/* Verified TA image returned by rcar_auth_ta_certificate() */
+struct rcar_ta_auth_info {
+	uint32_t object_size;	/* signed header and binary */
+	uint8_t cert_digest[TEE_SHA256_HASH_SIZE]; /* key and content cert */
+};
 
 TEE_Result rcar_auth_ta_certificate(const struct shdr *key_cert,
-				struct shdr **secmem_ta);
+				struct shdr **secmem_ta,
+				struct rcar_ta_auth_info *info);
+TEE_Result rcar_auth_ta_cert_digest(const void *ta, size_t size,
+				uint8_t *digest);
+void rcar_auth_ta_release(const struct shdr *secmem_ta);
 
 #endif /* RCAR_TA_AUTH_H */
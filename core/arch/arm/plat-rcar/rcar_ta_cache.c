@@ -0,0 +1,267 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2021, Renesas Electronics Corporation
+ */
+
+#include <string.h>
+#include <trace.h>
+#include <kernel/mutex.h>
+#include <malloc.h>
+#include <mm/core_memprot.h>
+#include <mm/tee_mm.h>
+#include <sys/queue.h>
+
+#include "rcar_mutex.h"
+#include "rcar_ta_cache.h"
+
+/*
+ * The verified TA images are kept in TA RAM, the most recently used first.
+ * An image is identified by the UUID and the digest of the certificates
+ * of the TA, so a TA replaced in the REE FS is verified again.
+ * The open TA store handles read an image in place, so only the images
+ * without a reader are evicted. An image removed while it is being read
+ * is freed when its last reader closes.
+ */
+struct rcar_ta_cache_entry {
+	TAILQ_ENTRY(rcar_ta_cache_entry) link;
+	TEE_UUID uuid;
+	uint8_t cert_digest[TEE_SHA256_HASH_SIZE];
+	tee_mm_entry_t *mm;
+	struct shdr *ta;	/* verified signed header and binary */
+	size_t ta_size;
+	uint32_t refc;		/* open handles reading the image */
+	bool removed;		/* not in the cache any more */
+};
+
+TAILQ_HEAD(rcar_ta_cache_head, rcar_ta_cache_entry);
+
+/* Declaration of internal function */
+static struct rcar_ta_cache_entry *cache_find(const TEE_UUID *uuid);
+static void cache_use(struct rcar_ta_cache_entry *e);
+static void cache_remove(struct rcar_ta_cache_entry *e);
+static void cache_free(struct rcar_ta_cache_entry *e);
+static bool cache_make_room(size_t size);
+static TEE_Result cache_insert(const TEE_UUID *uuid,
+			const struct rcar_ta_auth_info *info,
+			const struct shdr *secmem_ta,
+			struct rcar_ta_cache_entry **entry);
+
+static struct mutex g_ta_cache_mutex __nex_data = MUTEX_INITIALIZER;
+static struct rcar_ta_cache_head g_ta_cache __nex_data =
+	TAILQ_HEAD_INITIALIZER(g_ta_cache);
+static struct rcar_ta_cache_stats g_ta_cache_stats __nex_bss;
+
+static struct rcar_ta_cache_entry *cache_find(const TEE_UUID *uuid)
+{
+	struct rcar_ta_cache_entry *e;
+	struct rcar_ta_cache_entry *found = NULL;
+
+	TAILQ_FOREACH(e, &g_ta_cache, link) {
+		if (memcmp(&e->uuid, uuid, sizeof(TEE_UUID)) == 0) {
+			found = e;
+			break;
+		}
+	}
+
+	return found;
+}
+
+static void cache_use(struct rcar_ta_cache_entry *e)
+{
+	e->refc++;
+	TAILQ_REMOVE(&g_ta_cache, e, link);
+	TAILQ_INSERT_HEAD(&g_ta_cache, e, link);
+}
+
+static void cache_remove(struct rcar_ta_cache_entry *e)
+{
+	TAILQ_REMOVE(&g_ta_cache, e, link);
+	g_ta_cache_stats.entries--;
+	e->removed = true;
+	if (e->refc == 0U) {
+		cache_free(e);
+	}
+}
+
+static void cache_free(struct rcar_ta_cache_entry *e)
+{
+	g_ta_cache_stats.bytes -= e->ta_size;
+	tee_mm_free(e->mm);
+	nex_free(e);
+}
+
+/* Evict the least recently used images until @size bytes fit */
+static bool cache_make_room(size_t size)
+{
+	struct rcar_ta_cache_entry *e;
+	struct rcar_ta_cache_entry *prev;
+	bool fit = false;
+
+	e = TAILQ_LAST(&g_ta_cache, rcar_ta_cache_head);
+	while (!fit) {
+		fit = (g_ta_cache_stats.entries <
+			(uint32_t)CFG_RCAR_TA_CACHE_ENTRIES) &&
+			((g_ta_cache_stats.bytes + size) <=
+			(size_t)CFG_RCAR_TA_CACHE_SIZE);
+		if ((fit) || (e == NULL)) {
+			break;
+		}
+		prev = TAILQ_PREV(e, rcar_ta_cache_head, link);
+		if (e->refc == 0U) {
+			cache_remove(e);
+			g_ta_cache_stats.evictions++;
+		}
+		e = prev;
+	}
+
+	return fit;
+}
+
+static TEE_Result cache_insert(const TEE_UUID *uuid,
+			const struct rcar_ta_auth_info *info,
+			const struct shdr *secmem_ta,
+			struct rcar_ta_cache_entry **entry)
+{
+	TEE_Result res = TEE_SUCCESS;
+	struct rcar_ta_cache_entry *e = NULL;
+	size_t size = info->object_size;
+
+	if (!cache_make_room(size)) {
+		res = TEE_ERROR_OUT_OF_MEMORY;
+	}
+
+	if (res == TEE_SUCCESS) {
+		e = nex_calloc(1U, sizeof(*e));
+		if (e == NULL) {
+			res = TEE_ERROR_OUT_OF_MEMORY;
+		}
+	}
+
+	if (res == TEE_SUCCESS) {
+		e->mm = tee_mm_alloc(&tee_mm_sec_ddr, size);
+		if (e->mm != NULL) {
+			e->ta = phys_to_virt(tee_mm_get_smem(e->mm),
+				MEM_AREA_TA_RAM);
+		}
+		if (e->ta == NULL) {
+			tee_mm_free(e->mm);
+			nex_free(e);
+			res = TEE_ERROR_OUT_OF_MEMORY;
+		}
+	}
+
+	if (res == TEE_SUCCESS) {
+		(void)memcpy(e->ta, secmem_ta, size);
+		(void)memcpy(&e->uuid, uuid, sizeof(TEE_UUID));
+		(void)memcpy(e->cert_digest, info->cert_digest,
+			sizeof(e->cert_digest));
+		e->ta_size = size;
+		TAILQ_INSERT_HEAD(&g_ta_cache, e, link);
+		g_ta_cache_stats.entries++;
+		g_ta_cache_stats.bytes += size;
+		g_ta_cache_stats.inserts++;
+		*entry = e;
+	} else {
+		DMSG("TA not cached. r=0x%x size=0x%zx", res, size);
+	}
+
+	return res;
+}
+
+/*
+ * Look up the verified image of a TA with the digest of the key and
+ * content certificates of the TA in the REE FS, see
+ * rcar_auth_ta_cert_digest(). An image of the TA with other certificates
+ * is stale and removed. On success the image is read from @ta until
+ * rcar_ta_cache_put() is called with @entry.
+ */
+TEE_Result rcar_ta_cache_get(const TEE_UUID *uuid,
+			const uint8_t *cert_digest,
+			struct rcar_ta_cache_entry **entry,
+			struct shdr **ta, size_t *ta_size)
+{
+	TEE_Result res = TEE_SUCCESS;
+	struct rcar_ta_cache_entry *e;
+
+	rcar_nex_mutex_lock(&g_ta_cache_mutex);
+	e = cache_find(uuid);
+	if ((e != NULL) && (memcmp(e->cert_digest, cert_digest,
+			sizeof(e->cert_digest)) != 0)) {
+		cache_remove(e);
+		e = NULL;
+	}
+	if (e != NULL) {
+		cache_use(e);
+		g_ta_cache_stats.hits++;
+		*entry = e;
+		*ta = e->ta;
+		*ta_size = e->ta_size;
+	} else {
+		g_ta_cache_stats.misses++;
+		res = TEE_ERROR_ITEM_NOT_FOUND;
+	}
+	rcar_nex_mutex_unlock(&g_ta_cache_mutex);
+
+	return res;
+}
+
+/*
+ * Add an image verified by rcar_auth_ta_certificate() to the cache. The
+ * cached image of the same TA is replaced unless it has the same
+ * certificates. On success the image is read from @ta until
+ * rcar_ta_cache_put() is called with @entry.
+ */
+TEE_Result rcar_ta_cache_add(const TEE_UUID *uuid,
+			const struct rcar_ta_auth_info *info,
+			const struct shdr *secmem_ta,
+			struct rcar_ta_cache_entry **entry,
+			struct shdr **ta, size_t *ta_size)
+{
+	TEE_Result res = TEE_SUCCESS;
+	struct rcar_ta_cache_entry *e;
+
+	rcar_nex_mutex_lock(&g_ta_cache_mutex);
+	e = cache_find(uuid);
+	if ((e != NULL) && (memcmp(e->cert_digest, info->cert_digest,
+			sizeof(e->cert_digest)) != 0)) {
+		cache_remove(e);
+		e = NULL;
+	}
+	if (e == NULL) {
+		res = cache_insert(uuid, info, secmem_ta, &e);
+	}
+	if (res == TEE_SUCCESS) {
+		cache_use(e);
+		*entry = e;
+		*ta = e->ta;
+		*ta_size = e->ta_size;
+	}
+	rcar_nex_mutex_unlock(&g_ta_cache_mutex);
+
+	return res;
+}
+
+void rcar_ta_cache_put(struct rcar_ta_cache_entry *entry)
+{
+	if (entry != NULL) {
+		rcar_nex_mutex_lock(&g_ta_cache_mutex);
+		entry->refc--;
+		if ((entry->refc == 0U) && (entry->removed)) {
+			cache_free(entry);
+		}
+		rcar_nex_mutex_unlock(&g_ta_cache_mutex);
+	}
+}
+
+void rcar_ta_cache_get_stats(struct rcar_ta_cache_stats *stats, bool reset)
+{
+	rcar_nex_mutex_lock(&g_ta_cache_mutex);
+	*stats = g_ta_cache_stats;
+	if (reset) {
+		g_ta_cache_stats.hits = 0U;
+		g_ta_cache_stats.misses = 0U;
+		g_ta_cache_stats.inserts = 0U;
+		g_ta_cache_stats.evictions = 0U;
+	}
+	rcar_nex_mutex_unlock(&g_ta_cache_mutex);
+}
@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Copyright (c) 2021, Renesas Electronics Corporation
+ */
+
+#ifndef RCAR_TA_CACHE_H
+#define RCAR_TA_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <signed_hdr.h>
+#include "tee_api_types.h"
+#include "rcar_ta_auth.h"
+
+struct rcar_ta_cache_entry;
+
+/* Counters of the verified TA cache */
+struct rcar_ta_cache_stats {
+	uint32_t hits;		/* opens served from the cache */
+	uint32_t misses;	/* opens loaded and verified */
+	uint32_t inserts;	/* images added to the cache */
+	uint32_t evictions;	/* images evicted in LRU order */
+	uint32_t entries;	/* images currently cached */
+	uint32_t bytes;		/* bytes currently cached */
+};
+
+TEE_Result rcar_ta_cache_get(const TEE_UUID *uuid,
+			const uint8_t *cert_digest,
+			struct rcar_ta_cache_entry **entry,
+			struct shdr **ta, size_t *ta_size);
+TEE_Result rcar_ta_cache_add(const TEE_UUID *uuid,
+			const struct rcar_ta_auth_info *info,
+			const struct shdr *secmem_ta,
+			struct rcar_ta_cache_entry **entry,
+			struct shdr **ta, size_t *ta_size);
+void rcar_ta_cache_put(struct rcar_ta_cache_entry *entry);
+void rcar_ta_cache_get_stats(struct rcar_ta_cache_stats *stats, bool reset);
+
+#endif /* RCAR_TA_CACHE_H */
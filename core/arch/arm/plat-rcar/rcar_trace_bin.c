@@ -0,0 +1,322 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2021, Renesas Electronics Corporation
+ */
+
+#include <stdarg.h>
+#include <string.h>
+#include <trace.h>
+#include <arm.h>
+#include <kernel/linker.h>
+#include <kernel/misc.h>
+#include <kernel/thread.h>
+#include "rcar_log_func.h"
+
+/*
+ * Binary trace mode. The format string is not rendered, the record holds
+ * its location in tee.elf and the raw arguments instead. The records are
+ * rendered by scripts/rcar_trace_decode.py.
+ */
+
+/* Size of an integer argument selected by the length modifier */
+#define ARG_INT		(0U)
+#define ARG_LONG	(1U)
+#define ARG_QUAD	(2U)
+#define ARG_SIZE	(3U)
+#define ARG_PTRDIFF	(4U)
+
+#define UUID_SIZE	(16U)
+
+/* Declaration of internal function */
+static uint32_t log_bin_offset(const void *ptr);
+static size_t log_bin_put(int8_t *buf, size_t offs, const void *src,
+		size_t len);
+static size_t log_bin_put_int(int8_t *buf, size_t offs, uint32_t arg,
+		va_list *ap);
+static size_t log_bin_put_str(int8_t *buf, size_t offs, int32_t prec,
+		va_list *ap);
+static size_t log_bin_put_args(int8_t *buf, const char *fmt, va_list *ap);
+static void log_bin_write(uint32_t cpu_id, uint64_t stamp,
+		struct log_bin_rec_t *rec, const struct msg_block_t *data,
+		int32_t data_num);
+
+/* Offset of a string of tee.elf, independent of the load address */
+static uint32_t log_bin_offset(const void *ptr)
+{
+	uint32_t offs = LOG_BIN_NONE;
+
+	if (ptr != NULL) {
+		offs = (uint32_t)((vaddr_t)ptr - VCORE_START_VA);
+	}
+
+	return offs;
+}
+
+/*
+ * Append @len bytes to the arguments. Once an argument does not fit, the
+ * returned offset is past LOG_BIN_ARGS_MAX_SIZE and nothing more is
+ * appended.
+ */
+static size_t log_bin_put(int8_t *buf, size_t offs, const void *src,
+		size_t len)
+{
+	size_t next_offs = LOG_BIN_ARGS_MAX_SIZE + 1U;
+
+	if ((offs + len) <= LOG_BIN_ARGS_MAX_SIZE) {
+		(void)memcpy(&buf[offs], src, len);
+		next_offs = offs + len;
+	}
+
+	return next_offs;
+}
+
+static size_t log_bin_put_int(int8_t *buf, size_t offs, uint32_t arg,
+		va_list *ap)
+{
+	int32_t ival;
+	long lval;
+	long long qval;
+	size_t zval;
+	ptrdiff_t tval;
+	size_t next_offs;
+
+	switch (arg) {
+	case ARG_LONG:
+		lval = va_arg(*ap, long);
+		next_offs = log_bin_put(buf, offs, &lval, sizeof(lval));
+		break;
+	case ARG_QUAD:
+		qval = va_arg(*ap, long long);
+		next_offs = log_bin_put(buf, offs, &qval, sizeof(qval));
+		break;
+	case ARG_SIZE:
+		zval = va_arg(*ap, size_t);
+		next_offs = log_bin_put(buf, offs, &zval, sizeof(zval));
+		break;
+	case ARG_PTRDIFF:
+		tval = va_arg(*ap, ptrdiff_t);
+		next_offs = log_bin_put(buf, offs, &tval, sizeof(tval));
+		break;
+	default:
+		/* char and short are promoted to int */
+		ival = va_arg(*ap, int);
+		next_offs = log_bin_put(buf, offs, &ival, sizeof(ival));
+		break;
+	}
+
+	return next_offs;
+}
+
+static size_t log_bin_put_str(int8_t *buf, size_t offs, int32_t prec,
+		va_list *ap)
+{
+	const char *str;
+	size_t max_len = LOG_BIN_STR_MAX_LEN;
+	uint8_t len;
+	size_t next_offs;
+
+	str = va_arg(*ap, const char *);
+	if (str == NULL) {
+		str = "(null)";
+	}
+	if ((prec >= 0) && ((size_t)prec < max_len)) {
+		max_len = (size_t)prec;
+	}
+	len = (uint8_t)strnlen(str, max_len);
+
+	next_offs = log_bin_put(buf, offs, &len, sizeof(len));
+	next_offs = log_bin_put(buf, next_offs, str, len);
+
+	return next_offs;
+}
+
+/*
+ * Append the arguments of @fmt, walking the conversions the way
+ * vsnprintk() does. Returns the size of the appended arguments.
+ */
+static size_t log_bin_put_args(int8_t *buf, const char *fmt, va_list *ap)
+{
+	const char *p = fmt;
+	size_t offs = 0U;
+	uint32_t arg;
+	int32_t prec;
+	int32_t ival;
+	bool dot;
+	bool conv;
+	vaddr_t pval;
+
+	while (*p != '\0') {
+		conv = (*p != '%');
+		p++;
+		arg = ARG_INT;
+		prec = -1;
+		dot = false;
+
+		while ((*p != '\0') && (!conv)) {
+			switch (*p) {
+			case '*':
+				ival = va_arg(*ap, int);
+				offs = log_bin_put(buf, offs, &ival,
+						sizeof(ival));
+				if (dot) {
+					prec = ival;
+				}
+				break;
+			case '.':
+				dot = true;
+				prec = 0;
+				break;
+			case '0': case '1': case '2': case '3': case '4':
+			case '5': case '6': case '7': case '8': case '9':
+				if (dot) {
+					prec = (prec * 10) + (*p - '0');
+				}
+				break;
+			case '#': case '-': case '+': case ' ': case 'h':
+				break;
+			case 'l':
+				if (arg == ARG_LONG) {
+					arg = ARG_QUAD;
+				} else {
+					arg = ARG_LONG;
+				}
+				break;
+			case 'j': case 'q':
+				arg = ARG_QUAD;
+				break;
+			case 'z':
+				arg = ARG_SIZE;
+				break;
+			case 't':
+				arg = ARG_PTRDIFF;
+				break;
+			case 'D': case 'O': case 'U':
+				offs = log_bin_put_int(buf, offs, ARG_LONG,
+						ap);
+				conv = true;
+				break;
+			case 'c': case 'd': case 'i': case 'o': case 'u':
+			case 'x': case 'X':
+				offs = log_bin_put_int(buf, offs, arg,
+						ap);
+				conv = true;
+				break;
+			case 'p':
+				pval = (vaddr_t)va_arg(*ap, void *);
+				if ((p[1] == 'U') && (p[2] == 'l')) {
+					p = &p[2];
+					offs = log_bin_put(buf, offs,
+						(const void *)pval,
+						UUID_SIZE);
+				} else {
+					offs = log_bin_put(buf, offs, &pval,
+						sizeof(pval));
+				}
+				conv = true;
+				break;
+			case 's':
+				offs = log_bin_put_str(buf, offs, prec,
+						ap);
+				conv = true;
+				break;
+			case 'n':
+				/* Nothing is written back */
+				(void)va_arg(*ap, void *);
+				conv = true;
+				break;
+			default:
+				/* "%%" or an unknown conversion */
+				conv = true;
+				break;
+			}
+			p++;
+		}
+	}
+
+	return MIN(offs, (size_t)LOG_BIN_ARGS_MAX_SIZE);
+}
+
+/*
+ * Write @rec followed by the data blocks, at most MAX_PRINT_SIZE bytes of
+ * them. Called on @cpu_id with all exceptions masked.
+ */
+static void log_bin_write(uint32_t cpu_id, uint64_t stamp,
+		struct log_bin_rec_t *rec, const struct msg_block_t *data,
+		int32_t data_num)
+{
+	struct msg_block_t msg_block[1 + MSG_BLK_MAX_NUM];
+	size_t data_size = 0U;
+	int32_t i;
+
+	msg_block[0].addr = (const int8_t *)rec;
+	msg_block[0].size = sizeof(*rec);
+	for (i = 0; (i < data_num) && (i < MSG_BLK_MAX_NUM); i++) {
+		msg_block[i + 1] = data[i];
+		msg_block[i + 1].size = MIN(data[i].size,
+			(size_t)MAX_PRINT_SIZE - data_size);
+		data_size += msg_block[i + 1].size;
+	}
+
+	rec->magic = (uint16_t)LOG_BIN_MAGIC;
+	rec->size = (uint16_t)(sizeof(*rec) + data_size);
+	rec->core = (uint8_t)cpu_id;
+	rec->cntpct = stamp;
+
+	log_ring_write(cpu_id, stamp, msg_block, i + 1);
+}
+
+/*
+ * Write a line formatted elsewhere, such as a TA trace, as a text record.
+ * Called on @cpu_id with all exceptions masked.
+ */
+void log_bin_write_text(uint32_t cpu_id, uint64_t stamp,
+		const struct msg_block_t *msg_block, int32_t msg_block_num)
+{
+	struct log_bin_rec_t rec;
+
+	(void)memset(&rec, 0, sizeof(rec));
+	rec.level = (uint8_t)LOG_BIN_LEVEL_NONE;
+	rec.fmt = LOG_BIN_NONE;
+	rec.func = LOG_BIN_NONE;
+
+	log_bin_write(cpu_id, stamp, &rec, msg_block, msg_block_num);
+}
+
+/* Called by trace_vprintf() instead of rendering the trace */
+void trace_ext_vbinary(const char *func, int line, int level, bool level_ok,
+		       const char *fmt, va_list ap)
+{
+	struct log_bin_rec_t rec;
+	int8_t args[LOG_BIN_ARGS_MAX_SIZE];
+	struct msg_block_t args_block;
+	va_list args_ap;
+	uint32_t exceptions;
+	uint32_t cpu_id;
+	uint64_t stamp;
+
+	if ((fmt != NULL) && (log_secram_header != NULL)) {
+		va_copy(args_ap, ap);
+		args_block.addr = args;
+		args_block.size = log_bin_put_args(args, fmt, &args_ap);
+		va_end(args_ap);
+
+		(void)memset(&rec, 0, sizeof(rec));
+		if (level_ok) {
+			rec.level = (uint8_t)level;
+		} else {
+			rec.level = (uint8_t)LOG_BIN_LEVEL_NONE;
+		}
+		rec.line = (uint16_t)line;
+		rec.fmt = log_bin_offset(fmt);
+		rec.func = log_bin_offset(func);
+
+		/* Stay on this CPU while writing its ring */
+		exceptions = thread_mask_exceptions(THREAD_EXCP_ALL);
+		cpu_id = get_core_pos();
+		stamp = barrier_read_cntpct();
+		log_bin_write(cpu_id, stamp, &rec, &args_block, 1);
+		thread_unmask_exceptions(exceptions);
+
+		log_ring_flush();
+	}
+}
@@ -3,7 +3,9 @@ global-incdirs-y += include
 srcs-y += main.c
 srcs-$(CFG_OTP_SUPPORT) += tee_common_otp.c
 srcs-y += rcar_log_func.c
+srcs-$(CFG_RCAR_TRACE_BINARY) += rcar_trace_bin.c
 srcs-$(CFG_DYNAMIC_TA_AUTH_BY_HWENGINE) += rcar_ta_auth.c
+srcs-$(CFG_RCAR_TA_CACHE) += rcar_ta_cache.c
 srcs-$(CFG_ARM32_core) += rcar_call_maskrom_a32.S
 srcs-$(CFG_ARM64_core) += rcar_call_maskrom_a64.S
 srcs-y += rcar_maskrom.c
@@ -6,12 +6,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <string_ext.h>
+#include <atomic.h>
 #include <assert.h>
+#include <config.h>
 #include <tee/tee_fs.h>
 #include <tee/tee_pobj.h>
 #include <kernel/handle.h>
 #include <kernel/mutex.h>
 #include <kernel/tee_misc.h>
+#include <kernel/thread.h>
 #include <trace.h>
 #include <initcall.h>
 
@@ -25,10 +28,31 @@ static int32_t g_current_surface[SAVE_SECTOR_NUM] __nex_bss;
 static struct handle_db g_fd_handle_db __nex_data = HANDLE_DB_INITIALIZER;
 static struct handle_db g_rd_handle_db __nex_data = HANDLE_DB_INITIALIZER;
 static struct mutex g_standalone_fs_mutex __nex_data = MUTEX_INITIALIZER;
+static struct mutex g_standalone_fs_state_mutex __nex_data = MUTEX_INITIALIZER;
+static struct mutex g_flash_mutex __nex_data = MUTEX_INITIALIZER;
+static struct spim_lock_stats g_lock_stats __nex_bss;
+static struct spim_erase_stats g_erase_stats __nex_bss;
+static uint32_t g_erase_pending __nex_bss;	/* standby surfaces to erase */
 static TEE_Result g_standalone_fs_status __nex_data = TEE_ERROR_STORAGE_NOT_AVAILABLE;
 static uint8_t *g_work_buf __nex_bss;
 static uint8_t *g_record_data_buf __nex_bss;
 static struct spim_record_descriptor *g_record_data_rdesc __nex_bss;
+static uint64_t g_record_data_valid __nex_bss;	/* decrypted chunks */
+static uint64_t g_record_data_dirty __nex_bss;	/* chunks to encrypt */
+static uint32_t g_record_data_src __nex_bss;	/* Record Data on flash */
+static struct spim_record_index g_record_index __nex_bss;
+static struct spim_transaction g_trans __nex_data = {
+	.owner = TRANS_OWNER_NONE,
+	.staged_idx = TRANS_STAGED_NONE
+};
+
+#if RECORD_CHUNK_MAX_NUM > 64
+#error "Chunk bitmap of the Record Data is too small"
+#endif
+
+#if SAVE_SECTOR_NUM > 32
+#error "Bitmap of the standby surfaces to erase is too small"
+#endif
 
 static TEE_Result tee_standalone_fs_init(void);
 static TEE_Result spi_init_sector_info(void);
@@ -44,6 +68,12 @@ static TEE_Result spi_alloc_path(struct tee_pobj *po, char **ppath,
 static void spi_free_file(char *path);
 static void spi_lock(void);
 static void spi_unlock(void);
+static void spi_lock_shared(void);
+static void spi_unlock_shared(void);
+static void spi_lock_state(void);
+static void spi_unlock_state(void);
+static void spi_lock_counted(struct mutex *m, uint32_t *wait_count);
+static bool spi_is_trans_owner(void);
 static TEE_Result spi_encrypt_term_info(const struct spif_term_info *term_info,
 			uint8_t *encrypt_buf);
 static TEE_Result spi_read_term_info(uint32_t sector_addr,
@@ -55,18 +85,36 @@ static TEE_Result spi_check_sector_range(
 			uint32_t inc_path_len, uint32_t inc_data_len);
 static uint32_t spi_get_record_info_size(
 			const struct spim_record_descriptor *rdesc);
+static uint32_t spi_get_record_size(const struct spif_record_head *record_head);
+static uint32_t spi_get_data_size(uint16_t attr, uint32_t data_len);
+static bool spi_is_chunked(const struct spif_record_head *record_head);
 static TEE_Result spi_assign_record_info(uint32_t assign_size,
 			int32_t *sector_idx_out,
 			uint32_t *record_offset_out);
+static uint32_t spi_get_sector_used_size(int32_t sector_idx);
 static TEE_Result spi_write_record_info(struct spim_record_descriptor *rdesc,
 			uint32_t new_size, uint32_t old_size);
+static TEE_Result spi_rewrite_record_info(struct spim_record_descriptor *rdesc,
+			uint32_t new_size, uint32_t old_size);
+static TEE_Result spi_append_record_info(struct spim_record_descriptor *rdesc,
+			uint32_t new_size, uint32_t old_size);
+static TEE_Result spi_append_record(struct spim_record_descriptor *rdesc,
+			uint32_t new_size, uint32_t old_size);
+static TEE_Result spi_compact_sector(struct spim_record_descriptor *rdesc,
+			uint32_t new_size, uint32_t old_size);
+static void spi_relocate_dirstream(int32_t sector_idx, uint32_t skip_offset);
+static void spi_relocate_rdesc(int32_t sector_idx, uint32_t old_offset,
+			uint32_t new_offset);
 static struct spim_record_descriptor *spi_create_record_info(
 			const char *path, size_t path_len,
 			uint16_t attr, const struct spio_write_data *wd,
 			size_t wd_num, TEE_Result *res_out);
 static TEE_Result spi_update_record_info(struct spim_record_descriptor *rdesc,
 			uint32_t old_size);
+static TEE_Result spi_rebind_record_data(struct spim_record_descriptor *rdesc);
 static TEE_Result spi_delete_record_info(struct spim_record_descriptor *rdesc);
+static void spi_migrate_record_data(struct spim_record_descriptor *rdesc,
+			uint32_t old_size);
 static TEE_Result spi_encrypt_record_info(
 			const struct spif_record_info *record_info,
 			uint8_t *encrypt_buf);
@@ -75,7 +123,26 @@ static TEE_Result spi_read_record_head(uint32_t flash_addr,
 static TEE_Result spi_read_record_meta(uint32_t flash_addr,
 			const struct spif_record_head *record_head,
 			struct spif_record_meta *record_meta);
+static TEE_Result spi_encrypt_record_chunks(
+			const struct spif_record_info *record_info,
+			uint8_t *encrypt_buf);
 static TEE_Result spi_read_record_data(struct spim_record_descriptor *rdesc);
+static TEE_Result spi_read_record_chunks(struct spim_record_descriptor *rdesc,
+			uint32_t start, uint32_t end);
+static TEE_Result spi_read_record_chunk(uint32_t data_addr,
+			const struct spif_record_head *record_head,
+			const uint8_t *dek, uint32_t chunk_idx,
+			uint8_t *work_buf, uint8_t *data_out);
+static void spi_get_chunk_aad(const struct spif_record_head *record_head,
+			const uint8_t *chunk_iv, uint32_t chunk_idx,
+			struct spif_chunk_aad *aad);
+static TEE_Result spi_copy_record_chunks(struct spim_file_descriptor *fdp,
+			uint8_t *buf, uint32_t pos, uint32_t len);
+static uint32_t spi_get_chunk_len(uint32_t data_len, uint32_t chunk_idx);
+static uint32_t spi_get_record_data_addr(
+			const struct spim_record_descriptor *rdesc);
+static void spi_claim_record_data(struct spim_record_descriptor *rdesc);
+static void spi_mark_record_data(uint32_t start, uint32_t end);
 static void spi_write_record_data(struct spif_record_info *record_info,
 			const struct spio_write_data *wd, size_t wd_num);
 static void spi_get_parent_dir(const char *path, size_t path_len,
@@ -99,12 +166,51 @@ static TEE_Result spi_search_flash_for_record_info(
 			int32_t *search_sector_idx,
 			uint32_t *search_record_offset,
 			struct spif_record_info *record_info);
+static TEE_Result spi_scan_flash_for_record_info(
+			const struct spio_find_info *f,
+			int32_t *search_sector_idx,
+			uint32_t *search_record_offset,
+			struct spif_record_info *record_info);
+static TEE_Result spi_search_index_for_record_info(
+			const struct spio_find_info *f,
+			int32_t *search_sector_idx,
+			uint32_t *search_record_offset,
+			struct spif_record_info *record_info);
 static TEE_Result spi_match_record_info(const struct spio_find_info *f,
 			uint32_t flash_addr,
 			struct spif_record_info *record_info,
 			uint32_t *next_addr);
+static bool spi_match_index_entry(const struct spio_find_info *f,
+			const struct spim_index_entry *e,
+			int32_t start_sector_idx, uint32_t start_record_offset,
+			uint32_t hop);
+static uint32_t spi_get_hop(const char *path, size_t path_len);
+static TEE_Result spi_build_record_index(void);
+static TEE_Result spi_build_sector_index(int32_t sector_idx);
+static TEE_Result spi_build_appended_index(int32_t sector_idx);
+static TEE_Result spi_verify_appended_record(uint32_t flash_addr,
+			struct spif_record_info *record_info);
+static TEE_Result spi_check_blank(uint32_t flash_addr, uint32_t size,
+			bool *blank);
+static TEE_Result spi_index_record_info(int32_t sector_idx,
+			uint32_t record_offset,
+			const struct spif_record_info *record_info);
+static TEE_Result spi_remove_superseded_entry(int32_t sector_idx,
+			uint32_t record_offset,
+			const struct spif_record_info *record_info);
+static void spi_remove_index_entry(int32_t pos);
+static TEE_Result spi_add_index_entry(int32_t sector_idx,
+			uint32_t record_offset,
+			const struct spif_record_head *record_head,
+			const char *path);
+static int32_t spi_find_index_entry(int32_t sector_idx,
+			uint32_t record_offset);
+static void spi_commit_record_index(
+			const struct spim_record_descriptor *rdesc,
+			uint32_t new_size, uint32_t old_size);
 static struct spim_sector_info *spi_get_current_sector(int32_t sector_idx);
 static struct spim_sector_info *spi_get_next_sector(int32_t sector_idx);
+static struct spim_sector_info *spi_get_write_sector(int32_t sector_idx);
 static void spi_commit_sector(int32_t sector_idx,
 			const struct spif_term_info *new_term_info);
 static struct spim_file_descriptor *spi_alloc_fdp(
@@ -124,7 +230,22 @@ static struct tee_fs_dir *spi_alloc_dirst(const char *dir, size_t dir_len);
 static void spi_free_dirst(struct tee_fs_dir *dirst);
 static TEE_Result spi_read_flash(uint32_t flash_addr, uint8_t *buf,
 			size_t rsize);
-static TEE_Result spi_erase_and_write_sector(uint32_t sector_addr,
+static TEE_Result spi_write_flash(uint32_t flash_addr, const uint8_t *buf,
+			size_t wsize);
+static bool spi_is_staged_addr(uint32_t flash_addr, uint32_t *offset_out);
+static TEE_Result spi_store_sector(int32_t sector_idx,
+			struct spim_sector_info *sector,
+			const uint8_t *encrypted_record_buf,
+			uint32_t record_buf_size,
+			const uint8_t *encrypted_term_info);
+static TEE_Result spi_flush_staged_sector(void);
+static void spi_rollback_staged_sector(void);
+static void spi_rollback_rdesc(struct spim_record_descriptor *rdesc);
+static void spi_switch_surface(int32_t sector_idx, int32_t surface);
+static void spi_erase_standby(void);
+static TEE_Result spi_erase_sector(struct spim_sector_info *sector);
+static TEE_Result spi_erase_and_write_sector(int32_t sector_idx,
+			struct spim_sector_info *sector,
 			const uint8_t *encrypted_record_buf,
 			uint32_t record_buf_size,
 			const uint8_t *encrypted_term_info);
@@ -172,6 +293,8 @@ static TEE_Result standalone_fs_opendir(const TEE_UUID *uuid,
 static TEE_Result standalone_fs_readdir(struct tee_fs_dir *d,
 			struct tee_fs_dirent **ent);
 static void standalone_fs_closedir(struct tee_fs_dir *d);
+static TEE_Result standalone_fs_begin_transaction(void);
+static TEE_Result standalone_fs_commit_transaction(void);
 
 static TEE_Result tee_standalone_fs_init(void)
 {
@@ -196,6 +319,16 @@ static TEE_Result tee_standalone_fs_init(void)
 			res = spi_init_sector_info();
 		}
 
+		if (res == TEE_SUCCESS) {
+			/* Contents of the standby surfaces are not known */
+			g_erase_pending = (1U << (uint32_t)SAVE_SECTOR_NUM) - 1U;
+		}
+
+		if (res == TEE_SUCCESS) {
+			/* The index is optional, lookups fall back to a scan */
+			(void)spi_build_record_index();
+		}
+
 		if (res == TEE_SUCCESS) {
 			g_standalone_fs_status = res;
 		}
@@ -237,7 +370,11 @@ static TEE_Result spi_init_sector_info(void)
 	g_work_buf = (uint8_t *)phys_to_virt(OPTEE_LOG_BASE + 204800U,
 			MEM_AREA_IO_SEC);
 	g_record_data_buf = g_work_buf + SECTOR_SIZE; /* RECORD_DATA_BUF_SIZE */
+	/* SECTOR_SIZE */
+	g_trans.staged_buf = g_record_data_buf + RECORD_DATA_BUF_SIZE;
+	g_trans.staged_idx = TRANS_STAGED_NONE;
 	g_record_data_rdesc = NULL;
+	(void)memset(&g_record_index, 0, sizeof(g_record_index));
 	lsector_addr = STANDALONE_FS_SECTOR_ADDR;
 
 	for (i = 0; i < SURFACE_NUM; i++) {
@@ -296,6 +433,9 @@ static TEE_Result spi_init_sector_info(void)
 				(void)memcpy(&sector_next->term_info,
 					&sector_curr->term_info,
 					sizeof(struct spif_term_info));
+				/* Never take over records of a lost sector */
+				sector_curr->append_dirty = true;
+				sector_next->append_dirty = true;
 				g_current_surface[i] = 1;
 				EMSG("reinit sector info");
 			}
@@ -400,12 +540,74 @@ static void spi_free_file(char *path)
 
 static void spi_lock(void)
 {
-	rcar_nex_mutex_lock(&g_standalone_fs_mutex);
+	/* The owner of a transaction keeps the lock until the commit */
+	if (!spi_is_trans_owner()) {
+		/* Erase left by the previous update, before the FS is locked */
+		spi_erase_standby();
+		spi_lock_counted(&g_standalone_fs_mutex,
+				&g_lock_stats.excl_wait);
+		g_lock_stats.excl_count++;
+	}
 }
 
 static void spi_unlock(void)
 {
-	rcar_nex_mutex_unlock(&g_standalone_fs_mutex);
+	if (!spi_is_trans_owner()) {
+		rcar_nex_mutex_unlock(&g_standalone_fs_mutex);
+	}
+}
+
+static void spi_lock_shared(void)
+{
+	/* Readers run concurrently, writers hold the lock exclusively */
+	if (!spi_is_trans_owner()) {
+		if (!mutex_read_trylock(&g_standalone_fs_mutex)) {
+			(void)atomic_inc32(&g_lock_stats.shared_wait);
+			rcar_nex_mutex_read_lock(&g_standalone_fs_mutex);
+		}
+		(void)atomic_inc32(&g_lock_stats.shared_count);
+	}
+}
+
+static void spi_unlock_shared(void)
+{
+	if (!spi_is_trans_owner()) {
+		rcar_nex_mutex_read_unlock(&g_standalone_fs_mutex);
+	}
+}
+
+static void spi_lock_state(void)
+{
+	/*
+	 * The work buffer, the record data cache and the record index are
+	 * shared by the readers. Writers hold the FS lock exclusively.
+	 */
+	spi_lock_counted(&g_standalone_fs_state_mutex,
+			&g_lock_stats.state_wait);
+}
+
+static void spi_unlock_state(void)
+{
+	rcar_nex_mutex_unlock(&g_standalone_fs_state_mutex);
+}
+
+static void spi_lock_counted(struct mutex *m, uint32_t *wait_count)
+{
+	if (!mutex_trylock(m)) {
+		(void)atomic_inc32(wait_count);
+		rcar_nex_mutex_lock(m);
+	}
+}
+
+static bool spi_is_trans_owner(void)
+{
+	short int owner;
+
+	/* Read without the lock, it is only written by its holder */
+	owner = atomic_load_short(&g_trans.owner);
+
+	return (owner != TRANS_OWNER_NONE) &&
+		(owner == thread_get_id_may_fail());
 }
 
 static TEE_Result spi_encrypt_term_info(const struct spif_term_info *term_info,
@@ -494,23 +696,20 @@ static TEE_Result spi_check_sector_range(
 {
 	TEE_Result res;
 	const struct spif_record_head *lrecord_head;
-	struct spim_sector_info *sector;
 	uint32_t empty_size;
 	uint32_t old_size;
 	uint32_t new_size;
 	uint32_t increment_size;
 
 	lrecord_head = &rdesc->record_info.record_head;
-	sector = spi_get_current_sector(rdesc->sector_idx);
 
-	empty_size = TERM_INFO_OFFSET - sector->term_info.empty_offset;
+	empty_size = TERM_INFO_OFFSET -
+		spi_get_sector_used_size(rdesc->sector_idx);
 	old_size = spi_ceil_ek_size(lrecord_head->path_len) +
-		spi_ceil_ek_size(lrecord_head->data_len);
+		spi_get_data_size(lrecord_head->attr, lrecord_head->data_len);
 	new_size = spi_ceil_ek_size(lrecord_head->path_len + inc_path_len) +
-		spi_ceil_ek_size(lrecord_head->data_len + inc_data_len);
-	if ((lrecord_head->data_len == 0U) && (inc_data_len > 0U)) {
-		new_size += RECORD_DATA_FIXED_SIZE;
-	}
+		spi_get_data_size(lrecord_head->attr,
+			lrecord_head->data_len + inc_data_len);
 	increment_size = new_size - old_size;
 
 	if (increment_size <= empty_size) {
@@ -525,22 +724,53 @@ static TEE_Result spi_check_sector_range(
 
 static uint32_t spi_get_record_info_size(
 			const struct spim_record_descriptor *rdesc)
+{
+	return spi_get_record_size(&rdesc->record_info.record_head);
+}
+
+static uint32_t spi_get_record_size(const struct spif_record_head *record_head)
 {
 	uint32_t rinfo_size;
 
 	/* Record Head + Record Meta */
 	rinfo_size = RECORD_HEAD_SIZE + RECORD_META_FIXED_SIZE +
-		spi_ceil_ek_size(rdesc->record_info.record_head.path_len);
+		spi_ceil_ek_size(record_head->path_len);
 
-	if (rdesc->record_info.record_head.data_len > 0U) {
-		/* Record Data */
-		rinfo_size += RECORD_DATA_FIXED_SIZE + spi_ceil_ek_size(
-			rdesc->record_info.record_head.data_len);
-	}
+	/* Record Data */
+	rinfo_size += spi_get_data_size(record_head->attr,
+			record_head->data_len);
 
 	return rinfo_size;
 }
 
+static uint32_t spi_get_data_size(uint16_t attr, uint32_t data_len)
+{
+	uint32_t data_size;
+	uint32_t chunk_num;
+
+	if (data_len == 0U) {
+		data_size = 0U;
+	} else if ((attr & SAFS_ATTR_MASK_DFORMAT) ==
+		   SAFS_ATTR_DATA_DFORMAT_V2) {
+		/* Only the last chunk is padded */
+		chunk_num = (data_len + RECORD_CHUNK_SIZE - 1U) /
+			RECORD_CHUNK_SIZE;
+		data_size = (chunk_num * RECORD_CHUNK_FIXED_SIZE) +
+			spi_ceil_ek_size(data_len);
+	} else {
+		data_size = RECORD_DATA_FIXED_SIZE +
+			spi_ceil_ek_size(data_len);
+	}
+
+	return data_size;
+}
+
+static bool spi_is_chunked(const struct spif_record_head *record_head)
+{
+	return (record_head->attr & SAFS_ATTR_MASK_DFORMAT) ==
+		SAFS_ATTR_DATA_DFORMAT_V2;
+}
+
 static TEE_Result spi_assign_record_info(uint32_t assign_size,
 			int32_t *sector_idx_out,
 			uint32_t *record_offset_out)
@@ -555,7 +785,8 @@ static TEE_Result spi_assign_record_info(uint32_t assign_size,
 
 	for (lsector_idx = 0; lsector_idx < SAVE_SECTOR_NUM; lsector_idx++) {
 		sector = spi_get_current_sector(lsector_idx);
-		empty_size = TERM_INFO_OFFSET - sector->term_info.empty_offset;
+		empty_size = TERM_INFO_OFFSET -
+			spi_get_sector_used_size(lsector_idx);
 		if ((assign_size <= empty_size) &&
 		    (empty_size > max_empty_size)) {
 			assign_sector_idx = lsector_idx;
@@ -575,8 +806,45 @@ static TEE_Result spi_assign_record_info(uint32_t assign_size,
 	return res;
 }
 
+static uint32_t spi_get_sector_used_size(int32_t sector_idx)
+{
+	uint32_t used_size = 0U;
+	uint32_t i;
+
+	if (IS_ENABLED(CFG_STANDALONE_FS_APPEND) && g_record_index.valid) {
+		/* Superseded records are reclaimed by the compaction */
+		for (i = 0U; i < g_record_index.entry_num; i++) {
+			if (g_record_index.entry[i].sector_idx == sector_idx) {
+				used_size +=
+					g_record_index.entry[i].record_size;
+			}
+		}
+	} else {
+		used_size = spi_get_current_sector(sector_idx)->
+				term_info.empty_offset;
+	}
+
+	return used_size;
+}
+
 static TEE_Result spi_write_record_info(struct spim_record_descriptor *rdesc,
 			uint32_t new_size, uint32_t old_size)
+{
+	TEE_Result res;
+
+	if (IS_ENABLED(CFG_STANDALONE_FS_APPEND)) {
+		res = spi_append_record_info(rdesc, new_size, old_size);
+	} else {
+		res = spi_rewrite_record_info(rdesc, new_size, old_size);
+	}
+
+	g_record_data_dirty = 0U;
+
+	return res;
+}
+
+static TEE_Result spi_rewrite_record_info(struct spim_record_descriptor *rdesc,
+			uint32_t new_size, uint32_t old_size)
 {
 	TEE_Result res = TEE_SUCCESS;
 	struct spim_sector_info *sector_current;
@@ -592,7 +860,7 @@ static TEE_Result spi_write_record_info(struct spim_record_descriptor *rdesc,
 	const uint8_t uninit_iv[SAFS_IV_LEN] = {0};
 
 	sector_current = spi_get_current_sector(rdesc->sector_idx);
-	sector_next = spi_get_next_sector(rdesc->sector_idx);
+	sector_next = spi_get_write_sector(rdesc->sector_idx);
 	enc_buf = g_work_buf;
 
 	difference = new_size - old_size;
@@ -641,7 +909,10 @@ static TEE_Result spi_write_record_info(struct spim_record_descriptor *rdesc,
 				/* no operation */
 			}
 			eterm_info.empty_offset = buf_offset;
-			spi_update_write_count(&eterm_info.write_count);
+			if (g_trans.staged_idx != rdesc->sector_idx) {
+				spi_update_write_count(
+					&eterm_info.write_count);
+			}
 			if (memcmp(eterm_info.iv, uninit_iv, SAFS_IV_LEN)
 			    == 0) {
 				res = tee_sfkm_generate_random(eterm_info.iv,
@@ -656,9 +927,9 @@ static TEE_Result spi_write_record_info(struct spim_record_descriptor *rdesc,
 			if (eterm_info.record_num > 0) {
 				enc_record_buf = enc_buf;
 			}
-			res = spi_erase_and_write_sector(
-					sector_next->sector_addr,
-					enc_record_buf, buf_offset,
+			res = spi_store_sector(rdesc->sector_idx,
+					sector_next, enc_record_buf,
+					buf_offset,
 					&enc_buf[TERM_INFO_OFFSET]);
 		}
 		if (res == TEE_SUCCESS) {
@@ -666,6 +937,7 @@ static TEE_Result spi_write_record_info(struct spim_record_descriptor *rdesc,
 				spi_update_rdesc(rdesc, difference, new_size);
 			}
 			spi_commit_sector(rdesc->sector_idx, &eterm_info);
+			spi_commit_record_index(rdesc, new_size, old_size);
 		}
 	} else {
 		res = TEE_ERROR_STORAGE_NO_SPACE;
@@ -674,6 +946,339 @@ static TEE_Result spi_write_record_info(struct spim_record_descriptor *rdesc,
 	return res;
 }
 
+static TEE_Result spi_append_record_info(struct spim_record_descriptor *rdesc,
+			uint32_t new_size, uint32_t old_size)
+{
+	TEE_Result res = TEE_SUCCESS;
+	struct spim_sector_info *sector;
+	const struct spim_index_entry *e;
+	uint32_t append_size;
+	int32_t pos;
+	bool compaction;
+
+	if (!g_record_index.valid) {
+		/* Superseded records are only resolved through the index */
+		res = spi_build_record_index();
+	}
+
+	if (res == TEE_SUCCESS) {
+		sector = spi_get_current_sector(rdesc->sector_idx);
+		compaction = sector->append_dirty;
+
+		if (old_size > 0U) {
+			pos = spi_find_index_entry(rdesc->sector_idx,
+					rdesc->record_offset);
+			if (pos < 0) {
+				res = TEE_ERROR_ITEM_NOT_FOUND;
+				EMSG("record index entry is not found");
+			} else {
+				e = &g_record_index.entry[pos];
+				if ((e->path_len != rdesc->record_info.
+				     record_head.path_len) ||
+				    (e->hop != spi_get_hop(
+				     rdesc->record_info.record_meta.path,
+				     rdesc->record_info.record_head.path_len))) {
+					/*
+					 * Rename needs the old path to be gone
+					 * in the same commit.
+					 */
+					compaction = true;
+				}
+			}
+		}
+	}
+
+	if (res == TEE_SUCCESS) {
+		if (new_size > 0U) {
+			append_size = new_size;
+		} else {
+			/* Tombstone: Record Head + Record Meta */
+			append_size = RECORD_HEAD_SIZE +
+				RECORD_META_FIXED_SIZE + spi_ceil_ek_size(
+				rdesc->record_info.record_head.path_len);
+		}
+		if ((sector->term_info.empty_offset + append_size) >
+		    TERM_INFO_OFFSET) {
+			compaction = true;
+		}
+
+		if (compaction) {
+			res = spi_compact_sector(rdesc, new_size, old_size);
+		} else {
+			res = spi_append_record(rdesc, new_size, old_size);
+		}
+	}
+
+	return res;
+}
+
+static TEE_Result spi_append_record(struct spim_record_descriptor *rdesc,
+			uint32_t new_size, uint32_t old_size)
+{
+	TEE_Result res;
+	struct spim_sector_info *sector;
+	struct spif_record_info erecord_info; /* entity */
+	struct spif_record_info *lrecord_info;
+	uint8_t old_iv[SAFS_IV_LEN];
+	uint32_t append_offset;
+	uint32_t page_offset;
+	uint32_t lead_size;
+	uint32_t append_size;
+	int32_t pos;
+	uint8_t *enc_buf;
+
+	sector = spi_get_current_sector(rdesc->sector_idx);
+	enc_buf = g_work_buf;
+	append_offset = sector->term_info.empty_offset;
+	page_offset = (append_offset / APPEND_PAGE_SIZE) * APPEND_PAGE_SIZE;
+	lead_size = append_offset - page_offset;
+
+	if (new_size > 0U) {
+		lrecord_info = &rdesc->record_info;
+		append_size = new_size;
+	} else {
+		/* Tombstone of the deleted record */
+		(void)memcpy(&erecord_info, &rdesc->record_info,
+			sizeof(struct spif_record_info));
+		erecord_info.record_head.attr |= SAFS_ATTR_DATA_DELETED;
+		erecord_info.record_head.data_len = 0U;
+		lrecord_info = &erecord_info;
+		append_size = spi_get_record_size(&erecord_info.record_head);
+	}
+
+	/* Each version of a record is encrypted with a fresh IV */
+	(void)memcpy(old_iv, lrecord_info->record_head.iv, SAFS_IV_LEN);
+	res = tee_sfkm_generate_random(lrecord_info->record_head.iv,
+			SAFS_IV_LEN);
+
+	if (res == TEE_SUCCESS) {
+		/* Programming the erased value keeps the written area */
+		(void)memset(enc_buf, FLASH_ERASED_BYTE, lead_size);
+		res = spi_encrypt_record_info(lrecord_info,
+				enc_buf + lead_size);
+	}
+	if (res == TEE_SUCCESS) {
+		res = spi_write_flash(sector->sector_addr + page_offset,
+				enc_buf, lead_size + append_size);
+		if (res == TEE_ERROR_TARGET_DEAD) {
+			/* The area may be partially programmed */
+			sector->append_dirty = true;
+		}
+	}
+
+	if (res == TEE_SUCCESS) {
+		sector->term_info.empty_offset += append_size;
+		sector->term_info.record_num++;
+
+		if (old_size > 0U) {
+			pos = spi_find_index_entry(rdesc->sector_idx,
+					rdesc->record_offset);
+			spi_remove_index_entry(pos);
+		}
+		if (new_size > 0U) {
+			rdesc->record_offset = append_offset;
+			res = spi_add_index_entry(rdesc->sector_idx,
+					append_offset,
+					&lrecord_info->record_head,
+					lrecord_info->record_meta.path);
+			if (res != TEE_SUCCESS) {
+				/* The record is on flash, rebuild the index */
+				g_record_index.valid = false;
+				res = TEE_SUCCESS;
+			}
+		}
+	} else {
+		(void)memcpy(lrecord_info->record_head.iv, old_iv,
+			SAFS_IV_LEN);
+	}
+
+	return res;
+}
+
+static TEE_Result spi_compact_sector(struct spim_record_descriptor *rdesc,
+			uint32_t new_size, uint32_t old_size)
+{
+	TEE_Result res = TEE_SUCCESS;
+	struct spim_sector_info *sector_current;
+	struct spim_sector_info *sector_next;
+	struct spif_term_info eterm_info; /* entity */
+	struct spim_index_entry *e;
+	uint32_t buf_offset = 0U;
+	uint32_t new_record_offset = 0U;
+	uint32_t record_num = 0U;
+	uint32_t skip_offset;
+	uint32_t i;
+	int32_t pos;
+	uint8_t *enc_buf;
+	uint8_t *enc_record_buf = NULL;
+	const uint8_t uninit_iv[SAFS_IV_LEN] = {0};
+
+	sector_current = spi_get_current_sector(rdesc->sector_idx);
+	sector_next = spi_get_write_sector(rdesc->sector_idx);
+	enc_buf = g_work_buf;
+	if (old_size > 0U) {
+		skip_offset = rdesc->record_offset;
+	} else {
+		skip_offset = TERM_INFO_OFFSET;	/* no record is skipped */
+	}
+
+	/* Live records keep their encrypted image and their order */
+	for (i = 0U; (i < g_record_index.entry_num) && (res == TEE_SUCCESS);
+	     i++) {
+		e = &g_record_index.entry[i];
+		if ((e->sector_idx == rdesc->sector_idx) &&
+		    (e->record_offset != skip_offset)) {
+			if ((buf_offset + e->record_size) <= TERM_INFO_OFFSET) {
+				res = spi_read_flash(sector_current->sector_addr
+						+ e->record_offset,
+						enc_buf + buf_offset,
+						e->record_size);
+				buf_offset += e->record_size;
+				record_num++;
+			} else {
+				res = TEE_ERROR_STORAGE_NO_SPACE;
+			}
+		}
+	}
+	if ((res == TEE_SUCCESS) && (new_size > 0U)) {
+		if ((buf_offset + new_size) <= TERM_INFO_OFFSET) {
+			new_record_offset = buf_offset;
+			res = spi_encrypt_record_info(&rdesc->record_info,
+					enc_buf + buf_offset);
+			buf_offset += new_size;
+			record_num++;
+		} else {
+			res = TEE_ERROR_STORAGE_NO_SPACE;
+		}
+	}
+
+	if (res == TEE_SUCCESS) {
+		(void)memcpy(&eterm_info, &sector_current->term_info,
+			sizeof(struct spif_term_info));
+		eterm_info.record_num = record_num;
+		eterm_info.empty_offset = buf_offset;
+		if (g_trans.staged_idx != rdesc->sector_idx) {
+			spi_update_write_count(&eterm_info.write_count);
+		}
+		if (memcmp(eterm_info.iv, uninit_iv, SAFS_IV_LEN) == 0) {
+			res = tee_sfkm_generate_random(eterm_info.iv,
+					SAFS_IV_LEN);
+		}
+	}
+	if (res == TEE_SUCCESS) {
+		res = spi_encrypt_term_info(&eterm_info,
+				&enc_buf[TERM_INFO_OFFSET]);
+	}
+	if (res == TEE_SUCCESS) {
+		if (record_num > 0U) {
+			enc_record_buf = enc_buf;
+		}
+		res = spi_store_sector(rdesc->sector_idx, sector_next,
+				enc_record_buf, buf_offset,
+				&enc_buf[TERM_INFO_OFFSET]);
+	}
+
+	if (res == TEE_SUCCESS) {
+		spi_relocate_dirstream(rdesc->sector_idx, skip_offset);
+
+		if (old_size > 0U) {
+			pos = spi_find_index_entry(rdesc->sector_idx,
+					skip_offset);
+			spi_remove_index_entry(pos);
+		}
+		buf_offset = 0U;
+		for (i = 0U; i < g_record_index.entry_num; i++) {
+			e = &g_record_index.entry[i];
+			if (e->sector_idx == rdesc->sector_idx) {
+				spi_relocate_rdesc(e->sector_idx,
+						e->record_offset, buf_offset);
+				e->record_offset = buf_offset;
+				buf_offset += e->record_size;
+			}
+		}
+		if (new_size > 0U) {
+			rdesc->record_offset = new_record_offset;
+			if (spi_add_index_entry(rdesc->sector_idx,
+					new_record_offset,
+					&rdesc->record_info.record_head,
+					rdesc->record_info.record_meta.path)
+			    != TEE_SUCCESS) {
+				g_record_index.valid = false;
+			}
+		}
+
+		spi_commit_sector(rdesc->sector_idx, &eterm_info);
+		sector_next->append_dirty = false;
+		DMSG("sector compacted, idx=%d size=%u", rdesc->sector_idx,
+			eterm_info.empty_offset);
+	}
+
+	return res;
+}
+
+static void spi_relocate_dirstream(int32_t sector_idx, uint32_t skip_offset)
+{
+	struct spim_record_descriptor *rdesc;
+	const struct spim_index_entry *e;
+	uint32_t new_offset = 0U;
+	uint32_t buf_offset;
+	uint32_t i;
+	int32_t j;
+	bool found;
+
+	for (j = 0; j < (int32_t)g_rd_handle_db.max_ptrs; j++) {
+		rdesc = spi_get_rdesc(j);
+		if ((rdesc != NULL) && (rdesc->sector_idx == sector_idx) &&
+		    ((rdesc->ctrl_flag & RDESC_CTRL_DIRSTREAM) != 0U)) {
+			/*
+			 * Move the cursor onto the next live record; the
+			 * DELETE flag keeps readdir from skipping over it.
+			 */
+			found = false;
+			buf_offset = 0U;
+			for (i = 0U; (i < g_record_index.entry_num) && !found;
+			     i++) {
+				e = &g_record_index.entry[i];
+				if ((e->sector_idx == sector_idx) &&
+				    (e->record_offset != skip_offset)) {
+					if ((e->record_offset >
+					     rdesc->record_offset) ||
+					    ((e->record_offset ==
+					      rdesc->record_offset) &&
+					     ((rdesc->ctrl_flag &
+					       RDESC_CTRL_DELETE) != 0U))) {
+						new_offset = buf_offset;
+						found = true;
+					}
+					buf_offset += e->record_size;
+				}
+			}
+			if (!found) {
+				/* the new record is placed after them */
+				new_offset = buf_offset;
+			}
+			rdesc->record_offset = new_offset;
+			rdesc->ctrl_flag |= RDESC_CTRL_DELETE;
+		}
+	}
+}
+
+static void spi_relocate_rdesc(int32_t sector_idx, uint32_t old_offset,
+			uint32_t new_offset)
+{
+	struct spim_record_descriptor *rdesc;
+	int32_t i;
+
+	for (i = 0; i < (int32_t)g_rd_handle_db.max_ptrs; i++) {
+		rdesc = spi_get_rdesc(i);
+		if ((rdesc != NULL) && (rdesc->sector_idx == sector_idx) &&
+		    (rdesc->record_offset == old_offset) &&
+		    ((rdesc->ctrl_flag & RDESC_CTRL_DIRSTREAM) == 0U)) {
+			rdesc->record_offset = new_offset;
+		}
+	}
+}
+
 static struct spim_record_descriptor *spi_create_record_info(
 			const char *path, size_t path_len,
 			uint16_t attr, const struct spio_write_data *wd,
@@ -688,6 +1293,10 @@ static struct spim_record_descriptor *spi_create_record_info(
 	if (rdesc != NULL) {
 		lrecord_info = &rdesc->record_info;
 		lrecord_info->record_head.attr = attr;
+		if (IS_ENABLED(CFG_STANDALONE_FS_CHUNKED_DATA)) {
+			lrecord_info->record_head.attr |=
+				SAFS_ATTR_DATA_DFORMAT_V2;
+		}
 		lrecord_info->record_head.path_len = path_len;
 		lrecord_info->record_head.data_len = 0U;
 		(void)memcpy(lrecord_info->record_meta.path, path, path_len);
@@ -739,14 +1348,28 @@ static TEE_Result spi_update_record_info(struct spim_record_descriptor *rdesc,
 {
 	TEE_Result res;
 	uint32_t new_size;
+	uint16_t old_attr;
 	struct spim_sector_info *sector;
 
 	sector = spi_get_current_sector(rdesc->sector_idx);
 
 	if (rdesc->record_offset < sector->term_info.empty_offset) {
+		/* Clean chunks are copied from the stored version */
+		g_record_data_src = spi_get_record_data_addr(rdesc);
+		old_attr = rdesc->record_info.record_head.attr;
+		spi_migrate_record_data(rdesc, old_size);
 		new_size = spi_get_record_info_size(rdesc);
 
-		res = spi_write_record_info(rdesc, new_size, old_size);
+		res = spi_rebind_record_data(rdesc);
+		if (res == TEE_SUCCESS) {
+			res = spi_write_record_info(rdesc, new_size,
+					old_size);
+		}
+		if (res != TEE_SUCCESS) {
+			/* The cached chunks may not match the stored record */
+			rdesc->record_info.record_head.attr = old_attr;
+			g_record_data_rdesc = NULL;
+		}
 	} else {
 		res = TEE_ERROR_MAC_INVALID;
 		EMSG("Sector destruction error!");
@@ -755,12 +1378,92 @@ static TEE_Result spi_update_record_info(struct spim_record_descriptor *rdesc,
 	return res;
 }
 
-static TEE_Result spi_delete_record_info(struct spim_record_descriptor *rdesc)
+static TEE_Result spi_rebind_record_data(struct spim_record_descriptor *rdesc)
 {
-	TEE_Result res;
-	uint32_t old_size;
+	TEE_Result res = TEE_SUCCESS;
+	struct spim_sector_info *sector;
+	struct spif_record_info *lrecord_info;
+	struct spif_record_head src_head;
+	uint32_t i;
+
+	lrecord_info = &rdesc->record_info;
+
+	/*
+	 * Each chunk is bound to the Record Head IV and the Data Length of
+	 * its version. The clean chunks cannot be copied when either of them
+	 * changes, they are decrypted with the stored binding and encrypted
+	 * again. The append path gives each version a fresh Record Head IV.
+	 */
+	if (spi_is_chunked(&lrecord_info->record_head) &&
+	    (lrecord_info->record_head.data_len > 0U) &&
+	    (g_record_data_dirty != RECORD_CHUNK_ALL)) {
+		sector = spi_get_current_sector(rdesc->sector_idx);
+		res = spi_read_record_head(sector->sector_addr +
+				rdesc->record_offset, &src_head);
+		if ((res == TEE_SUCCESS) &&
+		    (IS_ENABLED(CFG_STANDALONE_FS_APPEND) ||
+		     (src_head.data_len !=
+		      lrecord_info->record_head.data_len) ||
+		     (memcmp(src_head.iv, lrecord_info->record_head.iv,
+			     SAFS_IV_LEN) != 0))) {
+			for (i = 0U; ((i * RECORD_CHUNK_SIZE) <
+				      lrecord_info->record_head.data_len) &&
+			     (res == TEE_SUCCESS); i++) {
+				if ((g_record_data_valid & (1ULL << i)) ==
+				    0U) {
+					res = spi_read_record_chunk(
+						g_record_data_src, &src_head,
+						lrecord_info->record_meta.dek,
+						i, g_work_buf,
+						&lrecord_info->record_data->
+						data[i * RECORD_CHUNK_SIZE]);
+				}
+				if (res == TEE_SUCCESS) {
+					g_record_data_valid |= (1ULL << i);
+				}
+			}
+			g_record_data_dirty = RECORD_CHUNK_ALL;
+		}
+	}
 
-	old_size = spi_get_record_info_size(rdesc);
+	return res;
+}
+
+static void spi_migrate_record_data(struct spim_record_descriptor *rdesc,
+			uint32_t old_size)
+{
+	struct spif_record_head *lrecord_head;
+	uint32_t empty_size;
+	uint32_t new_size;
+
+	lrecord_head = &rdesc->record_info.record_head;
+
+	/*
+	 * The whole Record Data of a V1 record is in the buffer on every
+	 * update, re-encrypt it as chunks if the sector has the room.
+	 */
+	if (IS_ENABLED(CFG_STANDALONE_FS_CHUNKED_DATA) &&
+	    (lrecord_head->data_len > 0U) && !spi_is_chunked(lrecord_head)) {
+		empty_size = TERM_INFO_OFFSET -
+			spi_get_sector_used_size(rdesc->sector_idx);
+		new_size = RECORD_HEAD_SIZE + RECORD_META_FIXED_SIZE +
+			spi_ceil_ek_size(lrecord_head->path_len) +
+			spi_get_data_size(SAFS_ATTR_DATA_DFORMAT_V2,
+				lrecord_head->data_len);
+		if ((new_size <= old_size) ||
+		    ((new_size - old_size) <= empty_size)) {
+			lrecord_head->attr |= SAFS_ATTR_DATA_DFORMAT_V2;
+			g_record_data_dirty = RECORD_CHUNK_ALL;
+		}
+	}
+}
+
+static TEE_Result spi_delete_record_info(struct spim_record_descriptor *rdesc)
+{
+	TEE_Result res;
+	uint32_t old_size;
+
+	old_size = spi_get_record_info_size(rdesc);
 
 	res = spi_write_record_info(rdesc, 0U, old_size);
 	if (res == TEE_SUCCESS) {
@@ -810,7 +1513,12 @@ static TEE_Result spi_encrypt_record_info(
 	}
 
 	/* Record Data */
-	if ((res == TEE_SUCCESS) && (record_info->record_head.data_len > 0U)) {
+	if ((res == TEE_SUCCESS) && (record_info->record_head.data_len > 0U) &&
+	    spi_is_chunked(&record_info->record_head)) {
+		encrypt_buf += RECORD_META_ENC_OFFSET + meta_enc_size;
+		res = spi_encrypt_record_chunks(record_info, encrypt_buf);
+	} else if ((res == TEE_SUCCESS) &&
+		   (record_info->record_head.data_len > 0U)) {
 		encrypt_buf += RECORD_META_ENC_OFFSET + meta_enc_size;
 		data_enc_size = spi_ceil_ek_size(
 				record_info->record_head.data_len);
@@ -830,6 +1538,65 @@ static TEE_Result spi_encrypt_record_info(
 	return res;
 }
 
+static TEE_Result spi_encrypt_record_chunks(
+			const struct spif_record_info *record_info,
+			uint8_t *encrypt_buf)
+{
+	TEE_Result res = TEE_SUCCESS;
+	struct tee_sfkm_crypt_info c;
+	struct spif_chunk_aad aad;
+	uint32_t data_len;
+	uint32_t chunk_len;
+	uint32_t chunk_enc_size;
+	uint32_t i;
+	uint8_t *chunk_buf;
+
+	data_len = record_info->record_head.data_len;
+
+	for (i = 0U; ((i * RECORD_CHUNK_SIZE) < data_len) &&
+	     (res == TEE_SUCCESS); i++) {
+		chunk_buf = encrypt_buf + (i * RECORD_CHUNK_STRIDE);
+		chunk_len = spi_get_chunk_len(data_len, i);
+		chunk_enc_size = spi_ceil_ek_size(chunk_len);
+
+		if ((g_record_data_dirty & (1ULL << i)) == 0U) {
+			/* Unchanged chunk keeps its encrypted image */
+			res = spi_read_flash(g_record_data_src +
+					(i * RECORD_CHUNK_STRIDE), chunk_buf,
+					RECORD_CHUNK_FIXED_SIZE +
+					chunk_enc_size);
+		} else {
+			/* The IV ends with the chunk index */
+			res = tee_sfkm_generate_random(chunk_buf,
+					SAFS_IV_LEN - sizeof(uint32_t));
+			if (res == TEE_SUCCESS) {
+				(void)memcpy(chunk_buf + SAFS_IV_LEN -
+					sizeof(uint32_t), &i,
+					sizeof(uint32_t));
+
+				c.data_in	= &record_info->record_data->
+						data[i * RECORD_CHUNK_SIZE];
+				c.data_size	= chunk_enc_size;
+				c.iv		= chunk_buf;
+				c.iv_size	= SAFS_IV_LEN;
+				c.key		= record_info->record_meta.dek;
+				c.key_size	= SAFS_EK_SIZE;
+
+				spi_get_chunk_aad(&record_info->record_head,
+						chunk_buf, i, &aad);
+				res = tee_sfkm_encrypt_auth(&c,
+						(const uint8_t *)&aad,
+						sizeof(aad),
+						chunk_buf +
+						RECORD_CHUNK_ENC_OFFSET,
+						chunk_buf + SAFS_IV_LEN);
+			}
+		}
+	}
+
+	return res;
+}
+
 static TEE_Result spi_read_record_head(uint32_t flash_addr,
 			struct spif_record_head *record_head)
 {
@@ -900,25 +1667,51 @@ static TEE_Result spi_read_record_meta(uint32_t flash_addr,
 
 static TEE_Result spi_read_record_data(struct spim_record_descriptor *rdesc)
 {
-	TEE_Result res;
+	return spi_read_record_chunks(rdesc, 0U,
+			rdesc->record_info.record_head.data_len);
+}
+
+static TEE_Result spi_read_record_chunks(struct spim_record_descriptor *rdesc,
+			uint32_t start, uint32_t end)
+{
+	TEE_Result res = TEE_SUCCESS;
 	struct spif_record_info *lrecord_info;
-	struct spim_sector_info *sector;
 	struct tee_sfkm_crypt_info c;
 	uint32_t flash_addr;
 	uint32_t buf_size;
+	uint32_t i;
 	uint8_t *encrypted_data;
 	const uint32_t enc_offset = RECORD_DATA_ENC_OFFSET;
 
-	if (rdesc->record_info.record_head.data_len == 0U) {
+	lrecord_info = &rdesc->record_info;
+
+	if (lrecord_info->record_head.data_len == 0U) {
 		res = TEE_ERROR_NO_DATA;
+	} else if (spi_is_chunked(&lrecord_info->record_head)) {
+		/* Only the chunks covering [start, end) are decrypted */
+		spi_claim_record_data(rdesc);
+		flash_addr = spi_get_record_data_addr(rdesc);
+		for (i = start / RECORD_CHUNK_SIZE;
+		     ((i * RECORD_CHUNK_SIZE) < end) &&
+		     ((i * RECORD_CHUNK_SIZE) <
+		      lrecord_info->record_head.data_len) &&
+		     (res == TEE_SUCCESS); i++) {
+			if ((g_record_data_valid & (1ULL << i)) == 0U) {
+				res = spi_read_record_chunk(flash_addr,
+					&lrecord_info->record_head,
+					lrecord_info->record_meta.dek,
+					i, g_work_buf,
+					&lrecord_info->record_data->
+					data[i * RECORD_CHUNK_SIZE]);
+				if (res == TEE_SUCCESS) {
+					g_record_data_valid |= (1ULL << i);
+				}
+			}
+		}
 	} else if (rdesc == g_record_data_rdesc) {
 		res = TEE_SUCCESS;
 	} else {
-		lrecord_info = &rdesc->record_info;
-		sector = spi_get_current_sector(rdesc->sector_idx);
-		flash_addr = sector->sector_addr + rdesc->record_offset +
-			RECORD_HEAD_SIZE + RECORD_META_FIXED_SIZE +
-			spi_ceil_ek_size(lrecord_info->record_head.path_len);
+		flash_addr = spi_get_record_data_addr(rdesc);
 		encrypted_data = g_work_buf;
 		buf_size = enc_offset +
 			spi_ceil_ek_size(lrecord_info->record_head.data_len);
@@ -941,14 +1734,198 @@ static TEE_Result spi_read_record_data(struct spim_record_descriptor *rdesc)
 				(void)memcpy(lrecord_info->record_data->tag,
 					encrypted_data,
 					SAFS_TAG_LEN);
-				g_record_data_rdesc = rdesc;
+				spi_claim_record_data(rdesc);
+				g_record_data_valid = RECORD_CHUNK_ALL;
+			}
+		}
+	}
+
+	return res;
+}
+
+static TEE_Result spi_read_record_chunk(uint32_t data_addr,
+			const struct spif_record_head *record_head,
+			const uint8_t *dek, uint32_t chunk_idx,
+			uint8_t *work_buf, uint8_t *data_out)
+{
+	TEE_Result res;
+	struct tee_sfkm_crypt_info c;
+	struct spif_chunk_aad aad;
+	uint32_t chunk_len;
+	uint32_t buf_size;
+	uint8_t *encrypted_data;
+
+	chunk_len = spi_get_chunk_len(record_head->data_len, chunk_idx);
+	encrypted_data = work_buf;
+	buf_size = RECORD_CHUNK_ENC_OFFSET + spi_ceil_ek_size(chunk_len);
+
+	res = spi_read_flash(data_addr + (chunk_idx * RECORD_CHUNK_STRIDE),
+			encrypted_data, buf_size);
+
+	if (res == TEE_SUCCESS) {
+		/* A chunk must not be swapped with another one */
+		if (memcmp(encrypted_data + SAFS_IV_LEN - sizeof(uint32_t),
+			   &chunk_idx, sizeof(uint32_t)) != 0) {
+			res = TEE_ERROR_MAC_INVALID;
+			EMSG("chunk index mismatched");
+		}
+	}
+	if (res == TEE_SUCCESS) {
+		c.data_in	= encrypted_data + RECORD_CHUNK_ENC_OFFSET;
+		c.data_size	= buf_size - RECORD_CHUNK_ENC_OFFSET;
+		c.iv		= encrypted_data;
+		c.iv_size	= SAFS_IV_LEN;
+		c.key		= dek;
+		c.key_size	= SAFS_EK_SIZE;
+
+		spi_get_chunk_aad(record_head, encrypted_data, chunk_idx,
+				&aad);
+		res = tee_sfkm_decrypt_auth(&c,
+				(const uint8_t *)&aad, sizeof(aad),
+				encrypted_data + SAFS_IV_LEN,	/* Tag */
+				data_out);
+	}
+
+	return res;
+}
+
+static void spi_get_chunk_aad(const struct spif_record_head *record_head,
+			const uint8_t *chunk_iv, uint32_t chunk_idx,
+			struct spif_chunk_aad *aad)
+{
+	(void)memset(aad, 0, sizeof(struct spif_chunk_aad));
+	(void)memcpy(aad->iv, chunk_iv, SAFS_IV_LEN);
+	(void)memcpy(aad->head_iv, record_head->iv, SAFS_IV_LEN);
+	aad->chunk_idx = chunk_idx;
+	aad->data_len = record_head->data_len;
+}
+
+static TEE_Result spi_copy_record_chunks(struct spim_file_descriptor *fdp,
+			uint8_t *buf, uint32_t pos, uint32_t len)
+{
+	TEE_Result res = TEE_SUCCESS;
+	struct spim_record_descriptor *rdesc;
+	struct spif_record_info *lrecord_info;
+	uint32_t data_addr;
+	uint32_t chunk_len;
+	uint32_t copy_start;
+	uint32_t copy_end;
+	uint32_t i;
+	uint8_t *chunk_buf;
+	uint8_t *data;
+
+	rdesc = fdp->ag_rdesc;
+	lrecord_info = &rdesc->record_info;
+	data = &lrecord_info->record_data->data[0];
+	data_addr = spi_get_record_data_addr(rdesc);
+
+	spi_lock_state();
+
+	for (i = pos / RECORD_CHUNK_SIZE;
+	     ((i * RECORD_CHUNK_SIZE) < (pos + len)) && (res == TEE_SUCCESS);
+	     i++) {
+		if ((g_record_data_rdesc != rdesc) ||
+		    ((g_record_data_valid & (1ULL << i)) == 0U)) {
+			/* Kept by the file descriptor until it is closed */
+			if (fdp->chunk_buf == NULL) {
+				fdp->chunk_buf = malloc(RECORD_CHUNK_STRIDE +
+						RECORD_CHUNK_SIZE);
+			}
+			chunk_buf = fdp->chunk_buf;
+			if (chunk_buf != NULL) {
+				/* Decrypt in parallel with other readers */
+				spi_unlock_state();
+				res = spi_read_record_chunk(data_addr,
+					&lrecord_info->record_head,
+					lrecord_info->record_meta.dek,
+					i, chunk_buf,
+					chunk_buf + RECORD_CHUNK_STRIDE);
+				spi_lock_state();
+				if (res == TEE_SUCCESS) {
+					chunk_len = spi_get_chunk_len(
+						lrecord_info->record_head.
+						data_len, i);
+					spi_claim_record_data(rdesc);
+					(void)memcpy(
+						&data[i * RECORD_CHUNK_SIZE],
+						chunk_buf + RECORD_CHUNK_STRIDE,
+						chunk_len);
+				}
+			} else {
+				spi_claim_record_data(rdesc);
+				res = spi_read_record_chunk(data_addr,
+						&lrecord_info->record_head,
+						lrecord_info->record_meta.dek,
+						i, g_work_buf,
+						&data[i * RECORD_CHUNK_SIZE]);
+			}
+			if (res == TEE_SUCCESS) {
+				g_record_data_valid |= (1ULL << i);
+			}
+		}
+		if (res == TEE_SUCCESS) {
+			copy_start = i * RECORD_CHUNK_SIZE;
+			if (copy_start < pos) {
+				copy_start = pos;
 			}
+			copy_end = (i + 1U) * RECORD_CHUNK_SIZE;
+			if (copy_end > (pos + len)) {
+				copy_end = pos + len;
+			}
+			(void)memcpy(buf + (copy_start - pos),
+				&data[copy_start], copy_end - copy_start);
 		}
 	}
 
+	spi_unlock_state();
+
 	return res;
 }
 
+static uint32_t spi_get_chunk_len(uint32_t data_len, uint32_t chunk_idx)
+{
+	uint32_t chunk_len;
+
+	chunk_len = data_len - (chunk_idx * RECORD_CHUNK_SIZE);
+	if (chunk_len > RECORD_CHUNK_SIZE) {
+		chunk_len = RECORD_CHUNK_SIZE;
+	}
+
+	return chunk_len;
+}
+
+static uint32_t spi_get_record_data_addr(
+			const struct spim_record_descriptor *rdesc)
+{
+	struct spim_sector_info *sector;
+
+	sector = spi_get_current_sector(rdesc->sector_idx);
+
+	return sector->sector_addr + rdesc->record_offset +
+		RECORD_HEAD_SIZE + RECORD_META_FIXED_SIZE +
+		spi_ceil_ek_size(rdesc->record_info.record_head.path_len);
+}
+
+static void spi_claim_record_data(struct spim_record_descriptor *rdesc)
+{
+	if (g_record_data_rdesc != rdesc) {
+		g_record_data_rdesc = rdesc;
+		g_record_data_valid = 0U;
+	}
+}
+
+static void spi_mark_record_data(uint32_t start, uint32_t end)
+{
+	uint32_t i;
+
+	/* The chunks covering [start, end) hold the new plaintext */
+	for (i = start / RECORD_CHUNK_SIZE; (i * RECORD_CHUNK_SIZE) < end;
+	     i++) {
+		g_record_data_valid |= (1ULL << i);
+		g_record_data_dirty |= (1ULL << i);
+	}
+}
+
 static void spi_write_record_data(struct spif_record_info *record_info,
 			const struct spio_write_data *wd, size_t wd_num)
 {
@@ -964,6 +1941,7 @@ static void spi_write_record_data(struct spif_record_info *record_info,
 	}
 
 	record_info->record_head.data_len = dpos;
+	g_record_data_dirty = RECORD_CHUNK_ALL;
 
 	if (g_record_data_rdesc != NULL) {
 		g_record_data_rdesc = NULL;
@@ -1155,6 +2133,48 @@ static TEE_Result spi_search_flash_for_record_info(
 			int32_t *search_sector_idx,
 			uint32_t *search_record_offset,
 			struct spif_record_info *record_info)
+{
+	TEE_Result res = TEE_ERROR_MAC_INVALID;
+
+	if (!g_record_index.valid) {
+		(void)spi_build_record_index();
+	}
+
+	if (g_record_index.valid) {
+		res = spi_search_index_for_record_info(f, search_sector_idx,
+				search_record_offset, record_info);
+		if (res == TEE_ERROR_MAC_INVALID) {
+			/* The flash no longer matches the index */
+			g_record_index.valid = false;
+			EMSG("record index mismatch, fall back to scan");
+		}
+	}
+
+	if (res == TEE_ERROR_MAC_INVALID) {
+		if (IS_ENABLED(CFG_STANDALONE_FS_APPEND)) {
+			/* A scan cannot tell superseded records apart */
+			res = spi_build_record_index();
+			if (res == TEE_SUCCESS) {
+				res = spi_search_index_for_record_info(f,
+						search_sector_idx,
+						search_record_offset,
+						record_info);
+			}
+		} else {
+			res = spi_scan_flash_for_record_info(f,
+					search_sector_idx,
+					search_record_offset, record_info);
+		}
+	}
+
+	return res;
+}
+
+static TEE_Result spi_scan_flash_for_record_info(
+			const struct spio_find_info *f,
+			int32_t *search_sector_idx,
+			uint32_t *search_record_offset,
+			struct spif_record_info *record_info)
 {
 	TEE_Result res;
 	TEE_Result resi = TEE_ERROR_ITEM_NOT_FOUND; /* Internal error code */
@@ -1253,56 +2273,578 @@ static TEE_Result spi_match_record_info(const struct spio_find_info *f,
 	uint16_t ftype_mask;
 	uint16_t filetype;
 
-	lrecord_head = &record_info->record_head;
-	lrecord_meta = &record_info->record_meta;
-	ftype_mask = f->attr_mask & SAFS_ATTR_MASK_FTYPE;
-	filetype = f->attr & SAFS_ATTR_MASK_FTYPE;
+	lrecord_head = &record_info->record_head;
+	lrecord_meta = &record_info->record_meta;
+	ftype_mask = f->attr_mask & SAFS_ATTR_MASK_FTYPE;
+	filetype = f->attr & SAFS_ATTR_MASK_FTYPE;
+
+	/* Read the Record Head */
+	res = spi_read_record_head(flash_addr, lrecord_head);
+
+	if (res == TEE_SUCCESS) {
+		flash_addr += RECORD_HEAD_SIZE;
+		if (((lrecord_head->attr & ftype_mask) == filetype) &&
+		    (((f->match_flag == PERFECT_MATCHING) &&
+		      (f->path_len == lrecord_head->path_len)) ||
+		     ((f->match_flag == FORWARD_MATCHING) &&
+		      (f->path_len < lrecord_head->path_len))) &&
+		    ((f->hod == lrecord_head->hod))) {
+
+			/* Read the Record Meta */
+			res = spi_read_record_meta(flash_addr, lrecord_head,
+					lrecord_meta);
+		} else {
+			res = TEE_ERROR_ITEM_NOT_FOUND;
+		}
+
+		/* If successful the reading of Record Meta */
+		if (res == TEE_SUCCESS) {
+			if (strncmp(f->path, lrecord_meta->path, f->path_len)
+			    == 0) {
+				res = TEE_SUCCESS;
+			} else {
+				res = TEE_ERROR_ITEM_NOT_FOUND;
+			}
+		}
+
+		flash_addr += (RECORD_META_FIXED_SIZE +
+				spi_ceil_ek_size(lrecord_head->path_len));
+		flash_addr += spi_get_data_size(lrecord_head->attr,
+				lrecord_head->data_len);
+		*next_addr = flash_addr;
+	}
+
+	return res;
+}
+
+static TEE_Result spi_search_index_for_record_info(
+			const struct spio_find_info *f,
+			int32_t *search_sector_idx,
+			uint32_t *search_record_offset,
+			struct spif_record_info *record_info)
+{
+	TEE_Result res = TEE_ERROR_ITEM_NOT_FOUND;
+	const struct spim_index_entry *e = NULL;
+	struct spim_sector_info *sector;
+	uint32_t next_addr = 0U;
+	uint32_t hop = 0U;
+	uint32_t i;
+
+	if (f->match_flag == PERFECT_MATCHING) {
+		hop = spi_get_hop(f->path, f->path_len);
+	}
+
+	for (i = 0U; i < g_record_index.entry_num; i++) {
+		e = &g_record_index.entry[i];
+		if (spi_match_index_entry(f, e, *search_sector_idx,
+				*search_record_offset, hop)) {
+			/* Only the candidate record is read and decrypted */
+			sector = spi_get_current_sector(e->sector_idx);
+			res = spi_match_record_info(f,
+					sector->sector_addr + e->record_offset,
+					record_info, &next_addr);
+			if (res != TEE_ERROR_ITEM_NOT_FOUND) {
+				break;
+			}
+		}
+	}
+
+	if (res == TEE_SUCCESS) {
+		*search_sector_idx = e->sector_idx;
+		*search_record_offset = e->record_offset;
+		if ((record_info->record_head.attr & f->attr_mask) != f->attr) {
+			res = TEE_ERROR_ACCESS_CONFLICT;
+			EMSG("tee file has no access rights");
+		}
+	} else if (res == TEE_ERROR_ITEM_NOT_FOUND) {
+		*search_sector_idx = SAVE_SECTOR_NUM;
+		*search_record_offset = 0U;
+	} else {
+		/* no operation */
+	}
+
+	return res;
+}
+
+static bool spi_match_index_entry(const struct spio_find_info *f,
+			const struct spim_index_entry *e,
+			int32_t start_sector_idx, uint32_t start_record_offset,
+			uint32_t hop)
+{
+	bool match;
+	uint16_t ftype_mask;
+	uint16_t filetype;
+
+	ftype_mask = f->attr_mask & SAFS_ATTR_MASK_FTYPE;
+	filetype = f->attr & SAFS_ATTR_MASK_FTYPE;
+
+	if ((e->sector_idx < start_sector_idx) ||
+	    ((e->sector_idx == start_sector_idx) &&
+	     (e->record_offset < start_record_offset))) {
+		/* before the search start position */
+		match = false;
+	} else if ((e->hod != f->hod) ||
+		   ((e->attr & ftype_mask) != filetype)) {
+		match = false;
+	} else if (f->match_flag == PERFECT_MATCHING) {
+		match = ((e->path_len == f->path_len) && (e->hop == hop));
+	} else {
+		match = (f->path_len < e->path_len);
+	}
+
+	return match;
+}
+
+static uint32_t spi_get_hop(const char *path, size_t path_len)
+{
+	uint32_t hop = 2166136261U;	/* FNV-1a offset basis */
+	size_t i;
+
+	for (i = 0U; i < path_len; i++) {
+		hop ^= (uint8_t)path[i];
+		hop *= 16777619U;	/* FNV-1a prime */
+	}
+
+	return hop;
+}
+
+static TEE_Result spi_build_record_index(void)
+{
+	TEE_Result res = TEE_SUCCESS;
+	int32_t lsector_idx;
+
+	g_record_index.entry_num = 0U;
+	g_record_index.valid = false;
+
+	for (lsector_idx = 0; (lsector_idx < SAVE_SECTOR_NUM) &&
+	     (res == TEE_SUCCESS); lsector_idx++) {
+		res = spi_build_sector_index(lsector_idx);
+	}
+
+	if (res == TEE_SUCCESS) {
+		g_record_index.valid = true;
+		DMSG("record index built, num=%u", g_record_index.entry_num);
+	} else {
+		EMSG("record index build error! r=0x%x", res);
+	}
+
+	return res;
+}
+
+static TEE_Result spi_build_sector_index(int32_t sector_idx)
+{
+	TEE_Result res = TEE_SUCCESS;
+	TEE_Result resi;
+	struct spim_sector_info *sector;
+	struct spif_record_info erecord_info; /* entity */
+	uint32_t flash_addr;
+	uint32_t record_offset = 0U;
+	uint32_t record_cnt = 0U;
+
+	sector = spi_get_current_sector(sector_idx);
+
+	while ((res == TEE_SUCCESS) &&
+	       (record_offset < sector->term_info.empty_offset)) {
+		flash_addr = sector->sector_addr + record_offset;
+		resi = spi_read_record_head(flash_addr,
+				&erecord_info.record_head);
+		if (resi == TEE_SUCCESS) {
+			resi = spi_read_record_meta(flash_addr + RECORD_HEAD_SIZE,
+					&erecord_info.record_head,
+					&erecord_info.record_meta);
+			if (resi == TEE_SUCCESS) {
+				res = spi_index_record_info(sector_idx,
+						record_offset, &erecord_info);
+			} else if (resi == TEE_ERROR_MAC_INVALID) {
+				EMSG("Skip record_info ofs=%d sectorIdx=%d",
+					record_offset, sector_idx);
+			} else {
+				res = resi;
+			}
+			record_offset += spi_get_record_size(
+					&erecord_info.record_head);
+			record_cnt++;
+		} else if (resi == TEE_ERROR_MAC_INVALID) {
+			EMSG("Delete record_info num=%d sectorIdx=%d",
+				sector->term_info.record_num - record_cnt,
+				sector_idx);
+			sector->term_info.empty_offset = record_offset;
+			sector->term_info.record_num = record_cnt;
+			sector->append_dirty = true;
+		} else {
+			res = resi;
+		}
+	}
+
+	if ((res == TEE_SUCCESS) && IS_ENABLED(CFG_STANDALONE_FS_APPEND) &&
+	    !sector->append_dirty) {
+		res = spi_build_appended_index(sector_idx);
+	}
+
+	return res;
+}
+
+static TEE_Result spi_build_appended_index(int32_t sector_idx)
+{
+	TEE_Result res = TEE_SUCCESS;
+	TEE_Result resi;
+	struct spim_sector_info *sector;
+	struct spif_record_info erecord_info; /* entity */
+	uint32_t record_offset;
+	uint32_t record_size;
+	uint32_t check_size;
+	bool end_of_record = false;
+	bool blank = true;
+
+	sector = spi_get_current_sector(sector_idx);
+	record_offset = sector->term_info.empty_offset;
+
+	/* Records appended after the last sector commit */
+	while ((res == TEE_SUCCESS) && !end_of_record &&
+	       ((record_offset + RECORD_HEAD_SIZE) <= TERM_INFO_OFFSET)) {
+		resi = spi_verify_appended_record(
+				sector->sector_addr + record_offset,
+				&erecord_info);
+		if (resi == TEE_SUCCESS) {
+			record_size = spi_get_record_size(
+					&erecord_info.record_head);
+			if ((record_offset + record_size) > TERM_INFO_OFFSET) {
+				resi = TEE_ERROR_MAC_INVALID;
+			}
+		}
+		if (resi == TEE_SUCCESS) {
+			res = spi_index_record_info(sector_idx,
+					record_offset, &erecord_info);
+			record_offset += record_size;
+			sector->term_info.record_num++;
+		} else if (resi == TEE_ERROR_MAC_INVALID) {
+			/* An interrupted append leaves a programmed tail */
+			check_size = TERM_INFO_OFFSET - record_offset;
+			if (check_size > RECORD_HEAD_SIZE) {
+				check_size = RECORD_HEAD_SIZE;
+			}
+			res = spi_check_blank(
+					sector->sector_addr + record_offset,
+					check_size, &blank);
+			end_of_record = true;
+		} else {
+			res = resi;
+		}
+	}
+
+	sector->term_info.empty_offset = record_offset;
+	if (!blank) {
+		sector->append_dirty = true;
+		EMSG("Incomplete record_info ofs=%d sectorIdx=%d",
+			record_offset, sector_idx);
+	}
+
+	return res;
+}
+
+static TEE_Result spi_verify_appended_record(uint32_t flash_addr,
+			struct spif_record_info *record_info)
+{
+	TEE_Result res;
+	struct spif_record_head *lrecord_head;
+	struct spif_record_data *lrecord_data;
+	struct tee_sfkm_crypt_info c;
+	uint32_t data_addr;
+	uint32_t buf_size;
+	uint32_t i;
+	uint8_t *encrypted_data;
+
+	lrecord_head = &record_info->record_head;
+	lrecord_data = (struct spif_record_data *)(void *)g_record_data_buf;
+
+	res = spi_read_record_head(flash_addr, lrecord_head);
+	if (res == TEE_SUCCESS) {
+		res = spi_read_record_meta(flash_addr + RECORD_HEAD_SIZE,
+				lrecord_head, &record_info->record_meta);
+	}
+	if ((res == TEE_SUCCESS) && (lrecord_head->data_len > 0U)) {
+		/* The whole record must be programmed to be valid */
+		data_addr = flash_addr + RECORD_HEAD_SIZE +
+			RECORD_META_FIXED_SIZE +
+			spi_ceil_ek_size(lrecord_head->path_len);
+		g_record_data_rdesc = NULL;
+	}
+	if ((res == TEE_SUCCESS) && (lrecord_head->data_len > 0U) &&
+	    spi_is_chunked(lrecord_head)) {
+		for (i = 0U; ((i * RECORD_CHUNK_SIZE) < lrecord_head->data_len)
+		     && (res == TEE_SUCCESS); i++) {
+			res = spi_read_record_chunk(data_addr, lrecord_head,
+					record_info->record_meta.dek, i,
+					g_work_buf, &lrecord_data->
+					data[i * RECORD_CHUNK_SIZE]);
+		}
+	} else if ((res == TEE_SUCCESS) && (lrecord_head->data_len > 0U)) {
+		encrypted_data = g_work_buf;
+		buf_size = RECORD_DATA_ENC_OFFSET +
+			spi_ceil_ek_size(lrecord_head->data_len);
+		res = spi_read_flash(data_addr, encrypted_data, buf_size);
+		if (res == TEE_SUCCESS) {
+			c.data_in	= encrypted_data + RECORD_DATA_ENC_OFFSET;
+			c.data_size	= buf_size - RECORD_DATA_ENC_OFFSET;
+			c.iv		= lrecord_head->iv;
+			c.iv_size	= SAFS_IV_LEN;
+			c.key		= record_info->record_meta.dek;
+			c.key_size	= SAFS_EK_SIZE;
+
+			res = tee_sfkm_decrypt(&c, encrypted_data,	/* Tag */
+					&lrecord_data->data[0]);
+		}
+	}
+
+	return res;
+}
+
+static TEE_Result spi_check_blank(uint32_t flash_addr, uint32_t size,
+			bool *blank)
+{
+	TEE_Result res = TEE_SUCCESS;
+	uint8_t read_buf[RECORD_HEAD_SIZE];
+	uint32_t i;
+
+	*blank = true;
+	if (size > 0U) {
+		res = spi_read_flash(flash_addr, read_buf, size);
+	}
+	if (res == TEE_SUCCESS) {
+		for (i = 0U; i < size; i++) {
+			if (read_buf[i] != FLASH_ERASED_BYTE) {
+				*blank = false;
+			}
+		}
+	}
+
+	return res;
+}
+
+static TEE_Result spi_index_record_info(int32_t sector_idx,
+			uint32_t record_offset,
+			const struct spif_record_info *record_info)
+{
+	TEE_Result res;
+
+	/* A later version of a path supersedes the earlier one */
+	res = spi_remove_superseded_entry(sector_idx, record_offset,
+			record_info);
+
+	if ((res == TEE_SUCCESS) &&
+	    ((record_info->record_head.attr & SAFS_ATTR_MASK_DELETED) == 0U)) {
+		res = spi_add_index_entry(sector_idx, record_offset,
+				&record_info->record_head,
+				record_info->record_meta.path);
+	}
+
+	return res;
+}
+
+static TEE_Result spi_remove_superseded_entry(int32_t sector_idx,
+			uint32_t record_offset,
+			const struct spif_record_info *record_info)
+{
+	TEE_Result res = TEE_SUCCESS;
+	struct spif_record_info erecord_info; /* entity */
+	const struct spim_index_entry *e;
+	struct spim_sector_info *sector;
+	uint32_t flash_addr;
+	uint32_t hop;
+	uint32_t i = 0U;
+
+	sector = spi_get_current_sector(sector_idx);
+	hop = spi_get_hop(record_info->record_meta.path,
+			record_info->record_head.path_len);
+
+	while ((res == TEE_SUCCESS) && (i < g_record_index.entry_num)) {
+		e = &g_record_index.entry[i];
+		if ((e->sector_idx == sector_idx) &&
+		    (e->record_offset < record_offset) &&
+		    (e->hod == record_info->record_head.hod) &&
+		    (e->hop == hop) &&
+		    (e->path_len == record_info->record_head.path_len)) {
+			/* Compare the path itself to rule out a collision */
+			flash_addr = sector->sector_addr + e->record_offset;
+			res = spi_read_record_head(flash_addr,
+					&erecord_info.record_head);
+			if (res == TEE_SUCCESS) {
+				res = spi_read_record_meta(
+						flash_addr + RECORD_HEAD_SIZE,
+						&erecord_info.record_head,
+						&erecord_info.record_meta);
+			}
+			if ((res == TEE_SUCCESS) &&
+			    (strcmp(erecord_info.record_meta.path,
+				    record_info->record_meta.path) == 0)) {
+				spi_remove_index_entry((int32_t)i);
+			} else {
+				i++;
+			}
+		} else {
+			i++;
+		}
+	}
+
+	return res;
+}
+
+static TEE_Result spi_add_index_entry(int32_t sector_idx,
+			uint32_t record_offset,
+			const struct spif_record_head *record_head,
+			const char *path)
+{
+	TEE_Result res = TEE_SUCCESS;
+	struct spim_index_entry *new_entry;
+	struct spim_index_entry *e;
+	uint32_t new_max;
+	uint32_t pos;
+
+	if (g_record_index.entry_num == g_record_index.entry_max) {
+		if (g_record_index.entry_max == 0U) {
+			new_max = RINDEX_INIT_ENTRY_NUM;
+		} else {
+			new_max = g_record_index.entry_max * 2U;
+		}
+		new_entry = realloc(g_record_index.entry,
+				new_max * sizeof(struct spim_index_entry));
+		if (new_entry != NULL) {
+			g_record_index.entry = new_entry;
+			g_record_index.entry_max = new_max;
+		} else {
+			res = TEE_ERROR_OUT_OF_MEMORY;
+		}
+	}
+
+	if (res == TEE_SUCCESS) {
+		/* Keep the entries sorted by (sector_idx, record_offset) */
+		pos = g_record_index.entry_num;
+		while (pos > 0U) {
+			e = &g_record_index.entry[pos - 1U];
+			if ((e->sector_idx < sector_idx) ||
+			    ((e->sector_idx == sector_idx) &&
+			     (e->record_offset < record_offset))) {
+				break;
+			}
+			pos--;
+		}
+		(void)memmove(&g_record_index.entry[pos + 1U],
+			&g_record_index.entry[pos],
+			(g_record_index.entry_num - pos) *
+			sizeof(struct spim_index_entry));
+
+		e = &g_record_index.entry[pos];
+		e->hod = record_head->hod;
+		e->hop = spi_get_hop(path, record_head->path_len);
+		e->attr = record_head->attr;
+		e->path_len = record_head->path_len;
+		e->sector_idx = sector_idx;
+		e->record_offset = record_offset;
+		e->record_size = spi_get_record_size(record_head);
+		g_record_index.entry_num++;
+	}
+
+	return res;
+}
+
+static void spi_remove_index_entry(int32_t pos)
+{
+	if ((pos >= 0) && ((uint32_t)pos < g_record_index.entry_num)) {
+		g_record_index.entry_num--;
+		(void)memmove(&g_record_index.entry[pos],
+			&g_record_index.entry[pos + 1],
+			(g_record_index.entry_num - pos) *
+			sizeof(struct spim_index_entry));
+	}
+}
+
+static int32_t spi_find_index_entry(int32_t sector_idx,
+			uint32_t record_offset)
+{
+	int32_t pos = -1;
+	uint32_t i;
 
-	/* Read the Record Head */
-	res = spi_read_record_head(flash_addr, lrecord_head);
+	for (i = 0U; i < g_record_index.entry_num; i++) {
+		if ((g_record_index.entry[i].sector_idx == sector_idx) &&
+		    (g_record_index.entry[i].record_offset == record_offset)) {
+			pos = (int32_t)i;
+			break;
+		}
+	}
 
-	if (res == TEE_SUCCESS) {
-		flash_addr += RECORD_HEAD_SIZE;
-		if (((lrecord_head->attr & ftype_mask) == filetype) &&
-		    (((f->match_flag == PERFECT_MATCHING) &&
-		      (f->path_len == lrecord_head->path_len)) ||
-		     ((f->match_flag == FORWARD_MATCHING) &&
-		      (f->path_len < lrecord_head->path_len))) &&
-		    ((f->hod == lrecord_head->hod))) {
+	return pos;
+}
 
-			/* Read the Record Meta */
-			res = spi_read_record_meta(flash_addr, lrecord_head,
-					lrecord_meta);
-		} else {
-			res = TEE_ERROR_ITEM_NOT_FOUND;
+static void spi_commit_record_index(
+			const struct spim_record_descriptor *rdesc,
+			uint32_t new_size, uint32_t old_size)
+{
+	TEE_Result res = TEE_SUCCESS;
+	const struct spif_record_info *lrecord_info;
+	struct spim_index_entry *e;
+	int32_t difference;
+	int32_t pos;
+	uint32_t i;
+
+	if (g_record_index.valid) {
+		lrecord_info = &rdesc->record_info;
+		difference = new_size - old_size;
+
+		/* Shift the records behind the updated record */
+		for (i = 0U; i < g_record_index.entry_num; i++) {
+			e = &g_record_index.entry[i];
+			if ((e->sector_idx == rdesc->sector_idx) &&
+			    (e->record_offset > rdesc->record_offset)) {
+				e->record_offset += difference;
+			}
 		}
 
-		/* If successful the reading of Record Meta */
-		if (res == TEE_SUCCESS) {
-			if (strncmp(f->path, lrecord_meta->path, f->path_len)
-			    == 0) {
-				res = TEE_SUCCESS;
-			} else {
+		if (old_size == 0U) {
+			res = spi_add_index_entry(rdesc->sector_idx,
+					rdesc->record_offset,
+					&lrecord_info->record_head,
+					lrecord_info->record_meta.path);
+		} else {
+			pos = spi_find_index_entry(rdesc->sector_idx,
+					rdesc->record_offset);
+			if (pos < 0) {
 				res = TEE_ERROR_ITEM_NOT_FOUND;
+			} else if (new_size == 0U) {
+				spi_remove_index_entry(pos);
+			} else {
+				e = &g_record_index.entry[pos];
+				e->hod = lrecord_info->record_head.hod;
+				e->hop = spi_get_hop(
+					lrecord_info->record_meta.path,
+					lrecord_info->record_head.path_len);
+				e->attr = lrecord_info->record_head.attr;
+				e->path_len = lrecord_info->record_head.path_len;
+				e->record_size = new_size;
 			}
 		}
 
-		flash_addr += (RECORD_META_FIXED_SIZE +
-				spi_ceil_ek_size(lrecord_head->path_len));
-		if (lrecord_head->data_len > 0U) {
-			flash_addr += (RECORD_DATA_FIXED_SIZE +
-				spi_ceil_ek_size(lrecord_head->data_len));
+		if (res != TEE_SUCCESS) {
+			/* Rebuilt from flash on the next search */
+			g_record_index.valid = false;
+			EMSG("record index update error! r=0x%x", res);
 		}
-		*next_addr = flash_addr;
 	}
-
-	return res;
 }
 
 static struct spim_sector_info *spi_get_current_sector(int32_t sector_idx)
 {
+	struct spim_sector_info *sector;
+
 	assert(sector_idx < SAVE_SECTOR_NUM);
-	return &g_sector[g_current_surface[sector_idx]][sector_idx];
+
+	if (g_trans.staged_idx == sector_idx) {
+		/* Not on the flash yet, g_current_surface is switched later */
+		sector = &g_sector[g_trans.staged_surface][sector_idx];
+	} else {
+		sector = &g_sector[g_current_surface[sector_idx]][sector_idx];
+	}
+
+	return sector;
 }
 
 static struct spim_sector_info *spi_get_next_sector(int32_t sector_idx)
@@ -1320,6 +2862,20 @@ static struct spim_sector_info *spi_get_next_sector(int32_t sector_idx)
 	return &g_sector[next_surface][sector_idx];
 }
 
+static struct spim_sector_info *spi_get_write_sector(int32_t sector_idx)
+{
+	struct spim_sector_info *sector;
+
+	if (g_trans.staged_idx == sector_idx) {
+		/* The staged image is rewritten in place */
+		sector = spi_get_current_sector(sector_idx);
+	} else {
+		sector = spi_get_next_sector(sector_idx);
+	}
+
+	return sector;
+}
+
 static void spi_commit_sector(int32_t sector_idx,
 			const struct spif_term_info *new_term_info)
 {
@@ -1327,14 +2883,19 @@ static void spi_commit_sector(int32_t sector_idx,
 
 	assert(sector_idx < SAVE_SECTOR_NUM);
 
-	if (g_current_surface[sector_idx] == 0) {
+	if (g_trans.staged_idx == sector_idx) {
+		/* Switched by spi_flush_staged_sector() once programmed */
+		next_surface = g_trans.staged_surface;
+	} else if (g_current_surface[sector_idx] == 0) {
 		next_surface = 1;
 	} else {
 		next_surface = 0;
 	}
 	(void)memcpy(&g_sector[next_surface][sector_idx].term_info,
 		new_term_info, sizeof(struct spif_term_info));
-	g_current_surface[sector_idx] = next_surface;
+	if (g_trans.staged_idx != sector_idx) {
+		spi_switch_surface(sector_idx, next_surface);
+	}
 }
 
 static struct spim_file_descriptor *spi_alloc_fdp(
@@ -1347,6 +2908,7 @@ static struct spim_file_descriptor *spi_alloc_fdp(
 
 	if (fdp != NULL) {
 		fdp->ag_rdesc = rdesc;
+		fdp->chunk_buf = NULL;
 		descriptor = handle_get(&g_fd_handle_db, fdp);
 		if (descriptor >= 0) {
 			fdp->fd = descriptor;
@@ -1363,6 +2925,7 @@ static void spi_free_fdp(struct spim_file_descriptor *fdp)
 {
 	spi_free_rdesc(fdp->ag_rdesc);
 	(void)handle_put(&g_fd_handle_db, fdp->fd);
+	free(fdp->chunk_buf);
 	free(fdp);
 }
 
@@ -1575,8 +3138,52 @@ static TEE_Result spi_read_flash(uint32_t flash_addr, uint8_t *buf,
 {
 	TEE_Result res;
 	uint32_t ret;
+	uint32_t offset;
 
-	ret = qspi_hyper_flash_read(flash_addr, buf, rsize);
+	if (spi_is_staged_addr(flash_addr, &offset)) {
+		(void)memcpy(buf, g_trans.staged_buf + offset, rsize);
+		ret = FL_DRV_OK;
+	} else {
+		/* Readers share the flash device */
+		spi_lock_counted(&g_flash_mutex, &g_lock_stats.flash_wait);
+		ret = qspi_hyper_flash_read_stream(flash_addr, buf, rsize);
+		rcar_nex_mutex_unlock(&g_flash_mutex);
+	}
+
+	if (ret == FL_DRV_OK) {
+		res = TEE_SUCCESS;
+	} else if (ret == FL_DRV_ERR_OUT_OF_MEMORY) {
+		res = TEE_ERROR_OUT_OF_MEMORY;
+	} else {
+		res = TEE_ERROR_TARGET_DEAD;
+	}
+
+	return res;
+}
+
+static TEE_Result spi_write_flash(uint32_t flash_addr, const uint8_t *buf,
+			size_t wsize)
+{
+	TEE_Result res;
+	uint32_t ret;
+	uint32_t offset;
+	size_t i;
+
+	if (spi_is_staged_addr(flash_addr, &offset)) {
+		/* Programming only clears bits of the staged image */
+		for (i = 0U; i < wsize; i++) {
+			g_trans.staged_buf[offset + i] &= buf[i];
+		}
+		if ((offset + wsize) > g_trans.staged_size) {
+			g_trans.staged_size = offset + wsize;
+		}
+		ret = FL_DRV_OK;
+	} else {
+		/* Ordered with the erase of the standby surfaces */
+		spi_lock_counted(&g_flash_mutex, &g_lock_stats.flash_wait);
+		ret = qspi_hyper_flash_write(flash_addr, buf, wsize);
+		rcar_nex_mutex_unlock(&g_flash_mutex);
+	}
 
 	if (ret == FL_DRV_OK) {
 		res = TEE_SUCCESS;
@@ -1589,24 +3196,255 @@ static TEE_Result spi_read_flash(uint32_t flash_addr, uint8_t *buf,
 	return res;
 }
 
-static TEE_Result spi_erase_and_write_sector(uint32_t sector_addr,
+static bool spi_is_staged_addr(uint32_t flash_addr, uint32_t *offset_out)
+{
+	uint32_t sector_addr;
+	bool staged = false;
+
+	if (g_trans.staged_idx != TRANS_STAGED_NONE) {
+		sector_addr = g_sector[g_trans.staged_surface]
+				[g_trans.staged_idx].sector_addr;
+		if ((flash_addr >= sector_addr) &&
+		    (flash_addr < (sector_addr + SECTOR_SIZE))) {
+			*offset_out = flash_addr - sector_addr;
+			staged = true;
+		}
+	}
+
+	return staged;
+}
+
+static TEE_Result spi_store_sector(int32_t sector_idx,
+			struct spim_sector_info *sector,
 			const uint8_t *encrypted_record_buf,
 			uint32_t record_buf_size,
 			const uint8_t *encrypted_term_info)
+{
+	TEE_Result res = TEE_SUCCESS;
+	uint32_t staged_size = 0U;
+
+	if (g_trans.owner == TRANS_OWNER_NONE) {
+		res = spi_erase_and_write_sector(sector_idx, sector,
+				encrypted_record_buf, record_buf_size,
+				encrypted_term_info);
+	} else {
+		if (g_trans.staged_idx != sector_idx) {
+			/* Only one sector image can be staged */
+			res = spi_flush_staged_sector();
+		}
+		if (res == TEE_SUCCESS) {
+			if (encrypted_record_buf != NULL) {
+				(void)memcpy(g_trans.staged_buf,
+					encrypted_record_buf,
+					record_buf_size);
+				staged_size = record_buf_size;
+			}
+			(void)memset(g_trans.staged_buf + staged_size,
+				FLASH_ERASED_BYTE,
+				TERM_INFO_OFFSET - staged_size);
+			(void)memcpy(g_trans.staged_buf + TERM_INFO_OFFSET,
+				encrypted_term_info, TERM_INFO_SIZE);
+			g_trans.staged_size = staged_size;
+			if (sector == &g_sector[0][sector_idx]) {
+				g_trans.staged_surface = 0;
+			} else {
+				g_trans.staged_surface = 1;
+			}
+			g_trans.staged_idx = sector_idx;
+		}
+	}
+
+	return res;
+}
+
+static TEE_Result spi_flush_staged_sector(void)
+{
+	TEE_Result res = TEE_SUCCESS;
+	const uint8_t *enc_record_buf = NULL;
+	struct spim_sector_info *sector;
+
+	if (g_trans.staged_idx != TRANS_STAGED_NONE) {
+		sector = &g_sector[g_trans.staged_surface][g_trans.staged_idx];
+		if (g_trans.staged_size > 0U) {
+			enc_record_buf = g_trans.staged_buf;
+		}
+		/*
+		 * The previous surface stays valid until the term info of
+		 * the staged image is programmed.
+		 */
+		res = spi_erase_and_write_sector(g_trans.staged_idx, sector,
+				enc_record_buf, g_trans.staged_size,
+				g_trans.staged_buf + TERM_INFO_OFFSET);
+		if (res == TEE_SUCCESS) {
+			spi_switch_surface(g_trans.staged_idx,
+				g_trans.staged_surface);
+			g_trans.staged_idx = TRANS_STAGED_NONE;
+		} else {
+			EMSG("staged sector flush error! r=0x%x", res);
+			spi_rollback_staged_sector();
+		}
+	}
+
+	return res;
+}
+
+/*
+ * Discard the staged image after its flush failed. The previous surface
+ * is still current on the flash, so the record index, the Record Data
+ * cache and the descriptors of the sector are taken from it again.
+ */
+static void spi_rollback_staged_sector(void)
+{
+	struct spim_record_descriptor *rdesc;
+	int32_t staged_idx;
+	int32_t i;
+
+	staged_idx = g_trans.staged_idx;
+	g_trans.staged_idx = TRANS_STAGED_NONE;
+	g_erase_stats.rollback_count++;
+	g_record_index.valid = false;
+	g_record_data_rdesc = NULL;
+
+	for (i = 0; i < (int32_t)g_rd_handle_db.max_ptrs; i++) {
+		rdesc = spi_get_rdesc(i);
+		if ((rdesc != NULL) && (rdesc->sector_idx == staged_idx)) {
+			if ((rdesc->ctrl_flag & RDESC_CTRL_DIRSTREAM) != 0U) {
+				/* The stream restarts from the first sector */
+				rdesc->sector_idx = RDESC_SECTOR_IDX_UNASSIGNED;
+				rdesc->record_offset = 0U;
+				rdesc->ctrl_flag &= ~RDESC_CTRL_DELETE;
+			} else {
+				spi_rollback_rdesc(rdesc);
+			}
+		}
+	}
+}
+
+/* Take the record of @rdesc from the flash again */
+static void spi_rollback_rdesc(struct spim_record_descriptor *rdesc)
+{
+	TEE_Result res;
+	struct spio_find_info f;
+	struct spif_record_info lrecord_info;
+	int32_t lsector_idx = 0;
+	uint32_t lrecord_offset = 0U;
+
+	f.path		= rdesc->record_info.record_meta.path;
+	f.path_len	= rdesc->record_info.record_head.path_len;
+	f.attr_mask	= 0U;
+	f.attr		= 0U;
+	f.hod		= rdesc->record_info.record_head.hod;
+	f.match_flag	= PERFECT_MATCHING;
+
+	res = spi_search_flash_for_record_info(&f, &lsector_idx,
+			&lrecord_offset, &lrecord_info);
+	if (res == TEE_SUCCESS) {
+		(void)memcpy(&rdesc->record_info.record_head,
+			&lrecord_info.record_head,
+			sizeof(struct spif_record_head));
+		(void)memcpy(&rdesc->record_info.record_meta,
+			&lrecord_info.record_meta,
+			sizeof(struct spif_record_meta));
+		rdesc->sector_idx = lsector_idx;
+		rdesc->record_offset = lrecord_offset;
+	} else {
+		/* Only stored by the discarded image */
+		rdesc->sector_idx = RDESC_SECTOR_IDX_UNASSIGNED;
+		rdesc->record_offset = 0U;
+	}
+}
+
+/*
+ * Make @surface the current surface of the sector. The previous one holds
+ * a stale image from now on and is erased by spi_erase_standby() ahead of
+ * the next update of the sector.
+ */
+static void spi_switch_surface(int32_t sector_idx, int32_t surface)
+{
+	spi_lock_counted(&g_flash_mutex, &g_lock_stats.flash_wait);
+	g_current_surface[sector_idx] = surface;
+	g_erase_pending |= (1U << (uint32_t)sector_idx);
+	rcar_nex_mutex_unlock(&g_flash_mutex);
+}
+
+/*
+ * Erase one standby surface left by a previous update. Called before the
+ * FS lock is taken, so the erase is not part of an update. The flash mutex
+ * orders it with the updates: a writer erases a pending surface itself,
+ * and a surface only becomes pending once it is no longer current.
+ */
+static void spi_erase_standby(void)
+{
+	struct spim_sector_info *sector = NULL;
+	int32_t i;
+
+	if (atomic_load_u32(&g_erase_pending) != 0U) {
+		spi_lock_counted(&g_flash_mutex, &g_lock_stats.flash_wait);
+		for (i = 0; (i < SAVE_SECTOR_NUM) && (sector == NULL); i++) {
+			if ((g_erase_pending & (1U << (uint32_t)i)) != 0U) {
+				g_erase_pending &= ~(1U << (uint32_t)i);
+				sector = spi_get_next_sector(i);
+			}
+		}
+		if (sector != NULL) {
+			if (spi_erase_sector(sector) == TEE_SUCCESS) {
+				g_erase_stats.deferred_count++;
+			} else {
+				/* Erased again by the next update */
+				EMSG("standby sector erase error!");
+			}
+		}
+		rcar_nex_mutex_unlock(&g_flash_mutex);
+	}
+}
+
+/* Called with the flash mutex held */
+static TEE_Result spi_erase_sector(struct spim_sector_info *sector)
 {
 	TEE_Result res;
 	uint32_t ret;
 
-	ret = qspi_hyper_flash_erase(sector_addr);
+	g_erase_stats.total_erase_count++;
+	sector->blank_state = SECTOR_NOT_BLANK;
+	ret = qspi_hyper_flash_erase(sector->sector_addr);
 	if (ret == FL_DRV_OK) {
+		sector->blank_state = SECTOR_BLANK;
+		res = TEE_SUCCESS;
+	} else if (ret == FL_DRV_ERR_OUT_OF_MEMORY) {
+		res = TEE_ERROR_OUT_OF_MEMORY;
+	} else {
+		res = TEE_ERROR_TARGET_DEAD;
+	}
+
+	return res;
+}
+
+static TEE_Result spi_erase_and_write_sector(int32_t sector_idx,
+			struct spim_sector_info *sector,
+			const uint8_t *encrypted_record_buf,
+			uint32_t record_buf_size,
+			const uint8_t *encrypted_term_info)
+{
+	TEE_Result res = TEE_SUCCESS;
+	uint32_t ret = FL_DRV_OK;
+
+	spi_lock_counted(&g_flash_mutex, &g_lock_stats.flash_wait);
+	/* Not erased ahead yet, the surface is erased here */
+	g_erase_pending &= ~(1U << (uint32_t)sector_idx);
+	if (sector->blank_state != SECTOR_BLANK) {
+		g_trans.erase_count++;
+		res = spi_erase_sector(sector);
+	}
+	if (res == TEE_SUCCESS) {
+		sector->blank_state = SECTOR_NOT_BLANK;
 		if (encrypted_record_buf != NULL) {
-			ret = qspi_hyper_flash_write(sector_addr,
+			ret = qspi_hyper_flash_write(sector->sector_addr,
 					encrypted_record_buf,
 					record_buf_size);
 		}
 		if (ret == FL_DRV_OK) {
 			ret = qspi_hyper_flash_write(
-					sector_addr + TERM_INFO_OFFSET,
+					sector->sector_addr + TERM_INFO_OFFSET,
 					encrypted_term_info,
 					TERM_INFO_SIZE);
 		}
@@ -1617,11 +3455,8 @@ static TEE_Result spi_erase_and_write_sector(uint32_t sector_addr,
 		} else {
 			res = TEE_ERROR_TARGET_DEAD;
 		}
-	} else if (ret == FL_DRV_ERR_OUT_OF_MEMORY) {
-		res = TEE_ERROR_OUT_OF_MEMORY;
-	} else {
-		res = TEE_ERROR_TARGET_DEAD;
 	}
+	rcar_nex_mutex_unlock(&g_flash_mutex);
 
 	return res;
 }
@@ -1716,22 +3551,31 @@ static TEE_Result tee_standalone_read(struct spim_file_descriptor *fdp,
 
 	rdesc = fdp->ag_rdesc;
 	lrecord_data = rdesc->record_info.record_data;
-	res = spi_read_record_data(rdesc);
-	if (res == TEE_SUCCESS) {
-		read_len = *buf_len;
-		rdata_len = rdesc->record_info.record_head.data_len;
-		if (rdata_len < (fpos + read_len)) {
-			if (fpos < rdata_len) {
-				read_len = rdata_len - fpos;
-			} else {
-				read_len = 0;
-			}
-			DMSG("reached EOF, update read length to %zu",
-				read_len);
+	read_len = *buf_len;
+	rdata_len = rdesc->record_info.record_head.data_len;
+	if (rdata_len < (fpos + read_len)) {
+		if (fpos < rdata_len) {
+			read_len = rdata_len - fpos;
+		} else {
+			read_len = 0;
 		}
-		if (read_len > 0U) {
+		DMSG("reached EOF, update read length to %zu", read_len);
+	}
+	if (rdata_len == 0U) {
+		res = TEE_ERROR_NO_DATA;
+	} else if (read_len == 0U) {
+		res = TEE_SUCCESS;
+	} else if (spi_is_chunked(&rdesc->record_info.record_head)) {
+		res = spi_copy_record_chunks(fdp, buf, fpos, read_len);
+	} else {
+		spi_lock_state();
+		res = spi_read_record_data(rdesc);
+		if (res == TEE_SUCCESS) {
 			(void)memcpy(buf, &lrecord_data->data[fpos], read_len);
 		}
+		spi_unlock_state();
+	}
+	if (res == TEE_SUCCESS) {
 		*buf_len = read_len;
 	} else if (res == TEE_ERROR_NO_DATA) {
 		*buf_len = 0;
@@ -1754,6 +3598,7 @@ static TEE_Result tee_standalone_write(struct spim_file_descriptor *fdp,
 	uint32_t old_data_len;
 	uint32_t new_data_len;
 	uint32_t new_fpos;
+	uint32_t dirty_start;
 
 	rdesc = fdp->ag_rdesc;
 	lrecord_head = &rdesc->record_info.record_head;
@@ -1766,10 +3611,16 @@ static TEE_Result tee_standalone_write(struct spim_file_descriptor *fdp,
 	} else {
 		new_data_len = new_fpos;
 	}
+	if (old_data_len < fpos) {
+		dirty_start = old_data_len;
+	} else {
+		dirty_start = fpos;
+	}
 	if (old_data_len > 0U) {
-		res = spi_read_record_data(rdesc);
-		g_record_data_rdesc = NULL;
+		/* The rewritten chunks keep the data around the range */
+		res = spi_read_record_chunks(rdesc, dirty_start, new_fpos);
 	} else {
+		spi_claim_record_data(rdesc);
 		res = TEE_SUCCESS;
 	}
 	if ((res == TEE_SUCCESS) && (old_data_len < new_data_len)) {
@@ -1784,6 +3635,7 @@ static TEE_Result tee_standalone_write(struct spim_file_descriptor *fdp,
 		}
 		(void)memcpy(&lrecord_data->data[fpos], buf, buf_len);
 		lrecord_head->data_len = new_data_len;
+		spi_mark_record_data(dirty_start, new_fpos);
 
 		res = spi_update_record_info(rdesc, old_size);
 		if (res != TEE_SUCCESS) {
@@ -1836,6 +3688,9 @@ static TEE_Result tee_standalone_rename(const char *old_file, size_t old_len,
 			lrecord_info->record_head.path_len = new_len;
 			(void)memcpy(lrecord_info->record_meta.path,
 				new_file, new_len + 1);
+			/* Record Data moves with the path */
+			spi_mark_record_data(0U,
+				lrecord_info->record_head.data_len);
 
 			res = spi_update_record_info(rdesc, old_size);
 			if (res != TEE_SUCCESS) {
@@ -1875,6 +3730,8 @@ static TEE_Result tee_standalone_truncate(struct spim_file_descriptor *fdp,
 	struct spif_record_data *lrecord_data;
 	uint32_t old_size;
 	uint32_t old_dlen;
+	uint32_t dirty_start;
+	uint32_t dirty_end;
 
 	rdesc = fdp->ag_rdesc;
 	lrecord_head = &rdesc->record_info.record_head;
@@ -1883,10 +3740,18 @@ static TEE_Result tee_standalone_truncate(struct spim_file_descriptor *fdp,
 		old_size = spi_get_record_info_size(rdesc);
 		old_dlen = lrecord_head->data_len;
 		if (length > 0U) {
+			if (old_dlen < length) {
+				dirty_start = old_dlen;
+				dirty_end = length;
+			} else {
+				dirty_start = length;
+				dirty_end = old_dlen;
+			}
 			if (old_dlen > 0U) {
-				res = spi_read_record_data(rdesc);
-				g_record_data_rdesc = NULL;
+				res = spi_read_record_chunks(rdesc,
+					dirty_start, dirty_end);
 			} else {
+				spi_claim_record_data(rdesc);
 				res = TEE_SUCCESS;
 			}
 			if ((res == TEE_SUCCESS) &&
@@ -1900,6 +3765,9 @@ static TEE_Result tee_standalone_truncate(struct spim_file_descriptor *fdp,
 						0, length - old_dlen);
 				}
 			}
+			if (res == TEE_SUCCESS) {
+				spi_mark_record_data(dirty_start, dirty_end);
+			}
 		} else {
 			res = TEE_SUCCESS;
 		}
@@ -2090,7 +3958,7 @@ static TEE_Result standalone_fs_read(struct tee_file_handle *fh, size_t pos,
 	if ((fh != NULL) && (buf != NULL) && (len != NULL)) {
 		res = spi_get_status();
 		if (res == TEE_SUCCESS) {
-			spi_lock();
+			spi_lock_shared();
 			fdp = spi_get_fdp(fh);
 			if (fdp != NULL) {
 				res = tee_standalone_read(fdp, buf, len, pos);
@@ -2098,7 +3966,7 @@ static TEE_Result standalone_fs_read(struct tee_file_handle *fh, size_t pos,
 				res = TEE_ERROR_BAD_PARAMETERS;
 				EMSG("Invalid file descriptor.");
 			}
-			spi_unlock();
+			spi_unlock_shared();
 		}
 	} else {
 		res = TEE_ERROR_BAD_PARAMETERS;
@@ -2270,9 +4138,12 @@ static TEE_Result standalone_fs_readdir(struct tee_fs_dir *d,
 	if ((d != NULL) && (ent != NULL)) {
 		res = spi_get_status();
 		if (res == TEE_SUCCESS) {
-			spi_lock();
+			/* The lookup may rebuild the record index */
+			spi_lock_shared();
+			spi_lock_state();
 			res = tee_standalone_readdir(d, ent);
-			spi_unlock();
+			spi_unlock_state();
+			spi_unlock_shared();
 		}
 	} else {
 		res = TEE_ERROR_BAD_PARAMETERS;
@@ -2304,6 +4175,55 @@ static void standalone_fs_closedir(struct tee_fs_dir *d)
 	DMSG("OUT status=0x%X", res);
 }
 
+static TEE_Result standalone_fs_begin_transaction(void)
+{
+	TEE_Result res;
+
+	DMSG("IN");
+
+	res = spi_get_status();
+	if (res == TEE_SUCCESS) {
+		spi_lock();
+		if (spi_is_trans_owner()) {
+			g_trans.nest++;
+		} else {
+			atomic_store_short(&g_trans.owner, thread_get_id());
+			g_trans.nest = 1U;
+			g_trans.erase_count = 0U;
+		}
+	}
+
+	DMSG("OUT res=0x%X", res);
+	return res;
+}
+
+static TEE_Result standalone_fs_commit_transaction(void)
+{
+	TEE_Result res = TEE_SUCCESS;
+
+	DMSG("IN");
+
+	if (spi_is_trans_owner()) {
+		g_trans.nest--;
+		if (g_trans.nest == 0U) {
+			res = spi_flush_staged_sector();
+			if (res == TEE_SUCCESS) {
+				g_erase_stats.trans_count++;
+				g_erase_stats.trans_erase_count =
+					g_trans.erase_count;
+			}
+			atomic_store_short(&g_trans.owner, TRANS_OWNER_NONE);
+			spi_unlock();
+		}
+	} else {
+		res = TEE_ERROR_BAD_STATE;
+		EMSG("transaction is not open");
+	}
+
+	DMSG("OUT res=0x%X", res);
+	return res;
+}
+
 const struct tee_file_operations standalone_fs_ops = {
 	.open = standalone_fs_open,
 	.create = standalone_fs_create,
@@ -2315,5 +4235,26 @@ const struct tee_file_operations standalone_fs_ops = {
 	.remove = standalone_fs_remove,
 	.opendir = standalone_fs_opendir,
 	.readdir = standalone_fs_readdir,
-	.closedir = standalone_fs_closedir
+	.closedir = standalone_fs_closedir,
+	.begin_transaction = standalone_fs_begin_transaction,
+	.commit_transaction = standalone_fs_commit_transaction
 };
+
+void tee_standalone_fs_get_lock_stats(struct spim_lock_stats *stats,
+			bool reset)
+{
+	(void)memcpy(stats, &g_lock_stats, sizeof(struct spim_lock_stats));
+	if (reset) {
+		(void)memset(&g_lock_stats, 0, sizeof(struct spim_lock_stats));
+	}
+}
+
+void tee_standalone_fs_get_erase_stats(struct spim_erase_stats *stats,
+			bool reset)
+{
+	(void)memcpy(stats, &g_erase_stats, sizeof(struct spim_erase_stats));
+	if (reset) {
+		(void)memset(&g_erase_stats, 0,
+			sizeof(struct spim_erase_stats));
+	}
+}
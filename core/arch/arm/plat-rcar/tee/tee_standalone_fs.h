@@ -6,7 +6,9 @@
 #ifndef TEE_STANDALONE_FS_H
 #define TEE_STANDALONE_FS_H
 
+#include <stdbool.h>
 #include <drivers/qspi_hyper_flash.h>
+#include <tee/tee_fs.h>
 #include "tee_standalone_fs_key_manager.h"
 
 #if ((STANDALONE_FS_SECTOR_ADDR % SECTOR_SIZE) != 0)
@@ -46,11 +48,16 @@
 #define SAFS_ATTR_MASK_FTYPE		(0x0001U)
 #define SAFS_ATTR_MASK_IWUSR		(0x0002U)
 #define SAFS_ATTR_MASK_IRUSR		(0x0004U)
+#define SAFS_ATTR_MASK_DELETED		(0x0008U)
+#define SAFS_ATTR_MASK_DFORMAT		(0x0030U)
 
 #define SAFS_ATTR_DATA_FILE		(0x0000U)
 #define SAFS_ATTR_DATA_DIR		(0x0001U)
 #define SAFS_ATTR_DATA_IWUSR		(0x0002U)
 #define SAFS_ATTR_DATA_IRUSR		(0x0004U)
+#define SAFS_ATTR_DATA_DELETED		(0x0008U)	/* Tombstone */
+#define SAFS_ATTR_DATA_DFORMAT_V1	(0x0000U)	/* Single MAC */
+#define SAFS_ATTR_DATA_DFORMAT_V2	(0x0010U)	/* Chunked */
 
 #define PERFECT_MATCHING		(0U)
 #define FORWARD_MATCHING		(1U)
@@ -61,6 +68,34 @@
 #define RDESC_CTRL_DIRSTREAM		(0x00000002U)
 #define RDESC_CTRL_DELETE		(0x00000004U)
 
+#define RINDEX_INIT_ENTRY_NUM		(32U)
+
+/* Program unit of the flash write buffer, appended records start on it */
+#define APPEND_PAGE_SIZE		(256U)
+#define FLASH_ERASED_BYTE		(0xFFU)
+
+/* Blank state of a surface, only an erase that completed makes it blank */
+#define SECTOR_NOT_BLANK		(0U)
+#define SECTOR_BLANK			(1U)	/* erased, not programmed since */
+
+/*
+ * Record Data format V2: [IV][Tag][Encrypted data] for each chunk, the Tag
+ * covers the encrypted data and struct spif_chunk_aad. Older builds cannot
+ * read the records converted to this format.
+ */
+#define RECORD_CHUNK_SIZE		(4096U)
+#define RECORD_CHUNK_ENC_OFFSET		(SAFS_IV_LEN + SAFS_TAG_LEN)
+#define RECORD_CHUNK_FIXED_SIZE		(SAFS_IV_LEN + SAFS_TAG_LEN)
+#define RECORD_CHUNK_STRIDE		(RECORD_CHUNK_FIXED_SIZE + \
+					RECORD_CHUNK_SIZE)
+#define RECORD_CHUNK_MAX_NUM		((RECORD_DATA_BUF_SIZE + \
+					RECORD_CHUNK_SIZE - 1U) / \
+					RECORD_CHUNK_SIZE)
+#define RECORD_CHUNK_ALL		(0xFFFFFFFFFFFFFFFFULL)
+
+#define TRANS_OWNER_NONE		(-1)
+#define TRANS_STAGED_NONE		(SAVE_SECTOR_NUM)
+
 /**
  * Non-volatile information. 'Record Head'
  */
@@ -92,6 +127,17 @@ struct spif_record_data {
 	uint8_t data[];				/* Data Area */
 };
 
+/**
+ * Authenticated with each chunk of a V2 Record Data, a chunk only matches
+ * its position in the version of the record it was written for.
+ */
+struct spif_chunk_aad {
+	uint8_t iv[SAFS_IV_LEN];		/* Chunk IV */
+	uint8_t head_iv[SAFS_IV_LEN];		/* Record Head IV */
+	uint32_t chunk_idx;			/* Chunk Index */
+	uint32_t data_len;			/* Data Length */
+};
+
 /**
  * Non-volatile information. 'Record Information'
  */
@@ -140,6 +186,70 @@ struct spio_write_data {
 struct spim_sector_info {
 	uint32_t sector_addr;
 	struct spif_term_info term_info;
+	bool append_dirty;	/* area after empty_offset is not blank */
+	uint32_t blank_state;	/* SECTOR_BLANK or SECTOR_NOT_BLANK */
+};
+
+/**
+ * Volatile information. 'Record Index Entry'
+ */
+struct spim_index_entry {
+	uint32_t hod;				/* Hash of Directory */
+	uint32_t hop;				/* Hash of Path */
+	uint16_t attr;				/* Attribute */
+	uint16_t path_len;			/* Path Length */
+	int32_t sector_idx;
+	uint32_t record_offset;
+	uint32_t record_size;
+};
+
+/**
+ * Volatile information. 'Record Index Information'
+ * Entries are sorted by (sector_idx, record_offset).
+ */
+struct spim_record_index {
+	struct spim_index_entry *entry;
+	uint32_t entry_num;
+	uint32_t entry_max;
+	bool valid;
+};
+
+/**
+ * Volatile information. 'Transaction Information'
+ * While a transaction is open the sector image is kept in staged_buf and
+ * erased and programmed once at the commit.
+ */
+struct spim_transaction {
+	short int owner;		/* thread id of the owner */
+	uint32_t nest;
+	int32_t staged_idx;		/* sector index of the staged image */
+	int32_t staged_surface;
+	uint32_t staged_size;		/* size of the record area */
+	uint8_t *staged_buf;
+	uint32_t erase_count;		/* sectors erased by the transaction */
+};
+
+/**
+ * Volatile information. 'Erase Statistics'
+ */
+struct spim_erase_stats {
+	uint32_t total_erase_count;	/* sectors erased */
+	uint32_t trans_count;		/* committed transactions */
+	uint32_t trans_erase_count;	/* erased by the last transaction */
+	uint32_t rollback_count;	/* staged images discarded */
+	uint32_t deferred_count;	/* standby surfaces erased ahead */
+};
+
+/**
+ * Volatile information. 'Lock Statistics'
+ */
+struct spim_lock_stats {
+	uint32_t excl_count;		/* exclusive acquisitions */
+	uint32_t excl_wait;		/* acquisitions that waited */
+	uint32_t shared_count;		/* shared acquisitions */
+	uint32_t shared_wait;
+	uint32_t state_wait;		/* waits for the shared buffers */
+	uint32_t flash_wait;		/* waits for the flash device */
 };
 
 /**
@@ -160,6 +270,7 @@ struct spim_record_descriptor {
 struct spim_file_descriptor {
 	struct spim_record_descriptor *ag_rdesc; 	/* aggregation */
 	int32_t fd;
+	uint8_t *chunk_buf;		/* work buffer of the chunked reads */
 };
 
 /**
@@ -172,4 +283,9 @@ struct tee_fs_dir {
 	struct tee_fs_dirent dirent;
 };
 
+void tee_standalone_fs_get_lock_stats(struct spim_lock_stats *stats,
+			bool reset);
+void tee_standalone_fs_get_erase_stats(struct spim_erase_stats *stats,
+			bool reset);
+
 #endif /* TEE_STANDALONE_FS_H */
@@ -21,6 +21,7 @@
 #include <initcall.h>
 #include <stdlib.h>
 #include <string.h>
+#include <kernel/spinlock.h>
 #include <kernel/tee_common_otp.h>
 #include <tee/tee_cryp_utl.h>
 #include <crypto/crypto.h>
@@ -34,6 +35,8 @@
 static const uint8_t string_for_ssk_gen[] = "ONLY_FOR_tee_fs_ssk";
 static uint8_t g_safs_suk[SAFS_EK_SIZE] __nex_bss;
 static uint8_t g_safs_ivek[TEE_SHA256_HASH_SIZE] __nex_bss;
+static struct tee_sfkm_stats g_sfkm_stats __nex_bss;
+static unsigned int g_sfkm_stats_lock __nex_bss = SPINLOCK_UNLOCK;
 
 static TEE_Result generate_ssk(uint8_t *ssk, uint32_t ssk_size,
 			uint8_t *huk, uint32_t huk_size,
@@ -50,6 +53,18 @@ TEE_Result tee_sfkm_generate_random(uint8_t *buf, uint8_t len)
 	return crypto_rng_read(buf, len);
 }
 
+void tee_sfkm_get_stats(struct tee_sfkm_stats *stats, bool reset)
+{
+	uint32_t exceptions;
+
+	exceptions = cpu_spin_lock_xsave(&g_sfkm_stats_lock);
+	*stats = g_sfkm_stats;
+	if (reset) {
+		(void)memset(&g_sfkm_stats, 0, sizeof(g_sfkm_stats));
+	}
+	cpu_spin_unlock_xrestore(&g_sfkm_stats_lock, exceptions);
+}
+
 static TEE_Result generate_ssk(uint8_t *ssk, uint32_t ssk_size,
 			uint8_t *huk, uint32_t huk_size,
 			uint8_t *message, uint32_t message_size)
@@ -79,7 +94,7 @@ static TEE_Result generate_ssk(uint8_t *ssk, uint32_t ssk_size,
 	}
 
 	if (ctx != NULL) {
-		free(ctx);
+		crypto_mac_free_ctx(ctx);
 	}
 
 	return res;
@@ -185,6 +200,25 @@ TEE_Result tee_sfkm_encrypt(const struct tee_sfkm_crypt_info *c,
 	return res;
 }
 
+TEE_Result tee_sfkm_encrypt_auth(const struct tee_sfkm_crypt_info *c,
+			const uint8_t *aad, size_t aad_size,
+			uint8_t *data_out, uint8_t *tag)
+{
+	TEE_Result res;
+
+	res = crypt_aes(TEE_ALG_AES_CBC_NOPAD, TEE_MODE_ENCRYPT,
+			c, data_out);
+
+	if (res == TEE_SUCCESS) {
+		/* Encrypt-then-MAC, the associated data is authenticated */
+		res = generate_cmac(data_out, c->data_size,
+				tag, c->key, c->key_size,
+				aad, aad_size);
+	}
+
+	return res;
+}
+
 TEE_Result tee_sfkm_decrypt_suk(struct tee_sfkm_crypt_info *c,
 			const uint8_t *tag, uint8_t *data_out,
 			uint8_t *decrypted_iv)
@@ -258,6 +292,33 @@ TEE_Result tee_sfkm_decrypt(const struct tee_sfkm_crypt_info *c,
 	return res;
 }
 
+TEE_Result tee_sfkm_decrypt_auth(const struct tee_sfkm_crypt_info *c,
+			const uint8_t *aad, size_t aad_size,
+			const uint8_t *tag, uint8_t *data_out)
+{
+	TEE_Result res;
+	uint8_t mac_buf[SAFS_TAG_LEN];
+
+	/* Encrypt-then-MAC, the associated data is authenticated */
+	res = generate_cmac(c->data_in, c->data_size,
+			mac_buf, c->key, c->key_size,
+			aad, aad_size);
+
+	if (res == TEE_SUCCESS) {
+		if (memcmp(mac_buf, tag, SAFS_TAG_LEN) != 0) {
+			res = TEE_ERROR_MAC_INVALID;
+			DMSG("MAC mismatched");
+		}
+	}
+
+	if (res == TEE_SUCCESS) {
+		res = crypt_aes(TEE_ALG_AES_CBC_NOPAD, TEE_MODE_DECRYPT,
+				c, data_out);
+	}
+
+	return res;
+}
+
 TEE_Result tee_sfkm_generate_sha256(const uint8_t *data_in, size_t data_size,
 			uint8_t *hash_out)
 {
@@ -281,7 +342,7 @@ TEE_Result tee_sfkm_generate_sha256(const uint8_t *data_in, size_t data_size,
 	}
 
 	if (ctx != NULL) {
-		free(ctx);
+		crypto_hash_free_ctx(ctx);
 	}
 
 	if ((res != TEE_SUCCESS) && (res != TEE_ERROR_OUT_OF_MEMORY)) {
@@ -298,6 +359,12 @@ static TEE_Result crypt_aes(uint32_t algo, TEE_OperationMode mode,
 {
 	TEE_Result res;
 	void *ctx = NULL;
+	uint32_t exceptions;
+
+	exceptions = cpu_spin_lock_xsave(&g_sfkm_stats_lock);
+	g_sfkm_stats.aes_count++;
+	g_sfkm_stats.aes_bytes += c->data_size;
+	cpu_spin_unlock_xrestore(&g_sfkm_stats_lock, exceptions);
 
 	res = crypto_cipher_alloc_ctx(&ctx, algo);
 
@@ -317,7 +384,7 @@ static TEE_Result crypt_aes(uint32_t algo, TEE_OperationMode mode,
 	}
 
 	if (ctx != NULL) {
-		free(ctx);
+		crypto_cipher_free_ctx(ctx);
 	}
 
 	if ((res != TEE_SUCCESS) && (res != TEE_ERROR_OUT_OF_MEMORY)) {
@@ -336,6 +403,17 @@ static TEE_Result generate_cmac(const uint8_t *data_in, size_t data_size,
 	void *ctx = NULL;
 	const uint32_t algo = TEE_ALG_AES_CMAC;
 	const size_t mac_size = TEE_AES_BLOCK_SIZE;
+	struct crypto_sg sg[2];
+	size_t num = 1U;
+	uint32_t exceptions;
+
+	exceptions = cpu_spin_lock_xsave(&g_sfkm_stats_lock);
+	g_sfkm_stats.cmac_count++;
+	g_sfkm_stats.cmac_bytes += data_size;
+	if (data2_in != NULL) {
+		g_sfkm_stats.cmac_bytes += data2_size;
+	}
+	cpu_spin_unlock_xrestore(&g_sfkm_stats_lock, exceptions);
 
 	res = crypto_mac_alloc_ctx(&ctx, algo);
 
@@ -344,11 +422,14 @@ static TEE_Result generate_cmac(const uint8_t *data_in, size_t data_size,
 	}
 
 	if (res == TEE_SUCCESS) {
-		res = crypto_mac_update(ctx, data_in, data_size);
-	}
-
-	if ((res == TEE_SUCCESS) && (data2_in != NULL)) {
-		res = crypto_mac_update(ctx, data2_in, data2_size);
+		sg[0].data = data_in;
+		sg[0].len = data_size;
+		if (data2_in != NULL) {
+			sg[1].data = data2_in;
+			sg[1].len = data2_size;
+			num++;
+		}
+		res = crypto_mac_update_sg(ctx, sg, num);
 	}
 
 	if (res == TEE_SUCCESS) {
@@ -356,7 +437,7 @@ static TEE_Result generate_cmac(const uint8_t *data_in, size_t data_size,
 	}
 
 	if (ctx != NULL) {
-		free(ctx);
+		crypto_mac_free_ctx(ctx);
 	}
 
 	if ((res != TEE_SUCCESS) && (res != TEE_ERROR_OUT_OF_MEMORY)) {
@@ -6,6 +6,7 @@
 #ifndef TEE_STANDALONE_FS_KEY_MANAGER_H
 #define TEE_STANDALONE_FS_KEY_MANAGER_H
 
+#include <stdbool.h>
 #include <utee_defines.h>
 #include <tee/tee_fs_key_manager.h>
 
@@ -13,6 +14,14 @@
 #define SAFS_IV_LEN		(16)		/* Initial Vector Length */
 #define SAFS_TAG_LEN		(16)		/* MAC Length */
 
+/* Crypto operations of the standalone FS */
+struct tee_sfkm_stats {
+	uint32_t aes_count;	/* AES encryptions and decryptions */
+	uint32_t cmac_count;	/* AES-CMAC computations */
+	uint64_t aes_bytes;	/* bytes encrypted or decrypted */
+	uint64_t cmac_bytes;	/* bytes authenticated */
+};
+
 struct tee_sfkm_crypt_info {
 	const uint8_t *data_in;
 	size_t data_size;
@@ -33,6 +42,10 @@ TEE_Result tee_sfkm_encrypt_suk(struct tee_sfkm_crypt_info *c,
 TEE_Result tee_sfkm_encrypt(const struct tee_sfkm_crypt_info *c,
 			uint8_t *data_out, uint8_t *tag);
 
+TEE_Result tee_sfkm_encrypt_auth(const struct tee_sfkm_crypt_info *c,
+			const uint8_t *aad, size_t aad_size,
+			uint8_t *data_out, uint8_t *tag);
+
 TEE_Result tee_sfkm_decrypt_suk(struct tee_sfkm_crypt_info *c,
 			const uint8_t *tag, uint8_t *data_out,
 			uint8_t *decrypted_iv);
@@ -40,7 +53,13 @@ TEE_Result tee_sfkm_decrypt_suk(struct tee_sfkm_crypt_info *c,
 TEE_Result tee_sfkm_decrypt(const struct tee_sfkm_crypt_info *c,
 			const uint8_t *tag, uint8_t *data_out);
 
+TEE_Result tee_sfkm_decrypt_auth(const struct tee_sfkm_crypt_info *c,
+			const uint8_t *aad, size_t aad_size,
+			const uint8_t *tag, uint8_t *data_out);
+
 TEE_Result tee_sfkm_generate_sha256(const uint8_t *data_in,
 			size_t data_size, uint8_t *hash_out);
 
+void tee_sfkm_get_stats(struct tee_sfkm_stats *stats, bool reset);
+
 #endif /* TEE_STANDALONE_FS_KEY_MANAGER_H */
@@ -9,7 +9,7 @@
 #include <trace.h>
 #include <arm.h>
 #include <kernel/tee_time.h>
-#include <kernel/spinlock.h>
+#include <kernel/thread.h>
 #include <kernel/time_source.h>
 #include "rcar_log_func.h"
 #include "rcar_common.h"
@@ -27,6 +27,8 @@ void trace_ext_puts(const char *str)
 	struct msg_block_t msg_block[MSG_BLK_MAX_NUM];
 	int32_t msg_block_num;
 	uint32_t exceptions;
+	uint32_t cpu_id;
+	uint64_t stamp;
 #ifdef RCAR_DEBUG_LOG
 	const int8_t TERM_LOG_PREFIX[] = "[OP-TEE]";
 	const size_t TERM_LOG_PREFIX_LEN = sizeof(TERM_LOG_PREFIX) - 1U;
@@ -35,8 +37,7 @@ void trace_ext_puts(const char *str)
 #endif
 
 	if ((str != NULL) && (log_secram_header != NULL)) {
-		exceptions = cpu_spin_lock_xsave(&log_spin_lock);
-
+		/* Format the time stamp before masking the exceptions */
 		if (_time_source.get_sys_time != NULL) {
 			ret = tee_time_get_sys_time(&sys_time);
 		} else {
@@ -44,24 +45,42 @@ void trace_ext_puts(const char *str)
 		}
 		if (ret == TEE_SUCCESS) {
 			res = snprintf((char *)time_buf, sizeof(time_buf),
-				"[%u.%06u][%d]",
+				"[%u.%06u]",
 				sys_time.seconds,
-				sys_time.millis * 1000U,
-				(int32_t)get_core_pos());
+				sys_time.millis * 1000U);
 			if (0 < res) {
 				time_len = (size_t)res;
 			}
 		}
 
 		msg_block[SECRAM_IDX_TIME].addr = time_buf;
-		msg_block[SECRAM_IDX_TIME].size = time_len;
 		msg_block[SECRAM_IDX_MESG].addr = (const int8_t *)str;
 		msg_block[SECRAM_IDX_MESG].size = strlen(str);
 		msg_block_num = SECRAM_MSG_BLK_NUM;
 
-		log_buf_write(msg_block, msg_block_num);
+		/* Stay on this CPU while writing its ring */
+		exceptions = thread_mask_exceptions(THREAD_EXCP_ALL);
+		cpu_id = get_core_pos();
+		stamp = barrier_read_cntpct();
+		if (time_len > 0U) {
+			res = snprintf((char *)&time_buf[time_len],
+				sizeof(time_buf) - time_len, "[%d]",
+				(int32_t)cpu_id);
+			if (0 < res) {
+				time_len += MIN((size_t)res,
+					sizeof(time_buf) - time_len - 1U);
+			}
+		}
+		msg_block[SECRAM_IDX_TIME].size = time_len;
+
+#ifdef CFG_RCAR_TRACE_BINARY
+		log_bin_write_text(cpu_id, stamp, msg_block, msg_block_num);
+#else
+		log_ring_write(cpu_id, stamp, msg_block, msg_block_num);
+#endif
+		thread_unmask_exceptions(exceptions);
 
-		cpu_spin_unlock_xrestore(&log_spin_lock, exceptions);
+		log_ring_flush();
 
 #ifdef RCAR_DEBUG_LOG
 		if (is_normal_world_initialized != 0) {
@@ -8,6 +8,7 @@
 #include <crypto/crypto_impl.h>
 #include <crypto/internal_aes-gcm.h>
 #include <io.h>
+#include <stdlib_ext.h>
 #include <string_ext.h>
 #include <string.h>
 #include <tee_api_types.h>
@@ -421,6 +422,11 @@ TEE_Result internal_aes_gcm_dec(const struct internal_aes_gcm_key *enc_key,
 struct aes_gcm_ctx {
 	struct crypto_authenc_ctx aec;
 	struct internal_aes_gcm_ctx ctx;
+#ifdef CFG_CRYPTO_HW_GCM
+	/* AES key of the Secure IP engine */
+	uint8_t key[TEE_AES_MAX_KEY_SIZE];
+	size_t key_len;
+#endif
 };
 
 static const struct crypto_authenc_ops aes_gcm_ops;
@@ -448,13 +454,18 @@ TEE_Result crypto_aes_gcm_alloc_ctx(struct crypto_authenc_ctx **ctx_ret)
 
 static void aes_gcm_free_ctx(struct crypto_authenc_ctx *aec)
 {
-	free(to_aes_gcm_ctx(aec));
+	free_wipe(to_aes_gcm_ctx(aec));
 }
 
 static void aes_gcm_copy_state(struct crypto_authenc_ctx *dst_ctx,
 			       struct crypto_authenc_ctx *src_ctx)
 {
 	to_aes_gcm_ctx(dst_ctx)->ctx = to_aes_gcm_ctx(src_ctx)->ctx;
+#ifdef CFG_CRYPTO_HW_GCM
+	memcpy(to_aes_gcm_ctx(dst_ctx)->key, to_aes_gcm_ctx(src_ctx)->key,
+	       sizeof(to_aes_gcm_ctx(src_ctx)->key));
+	to_aes_gcm_ctx(dst_ctx)->key_len = to_aes_gcm_ctx(src_ctx)->key_len;
+#endif
 }
 
 static TEE_Result aes_gcm_init(struct crypto_authenc_ctx *aec,
@@ -464,6 +475,14 @@ static TEE_Result aes_gcm_init(struct crypto_authenc_ctx *aec,
 			       size_t tag_len, size_t aad_len __unused,
 			       size_t payload_len __unused)
 {
+#ifdef CFG_CRYPTO_HW_GCM
+	struct aes_gcm_ctx *ctx = to_aes_gcm_ctx(aec);
+
+	if (key_len > sizeof(ctx->key))
+		return TEE_ERROR_BAD_PARAMETERS;
+	memcpy(ctx->key, key, key_len);
+	ctx->key_len = key_len;
+#endif
 	return internal_aes_gcm_init(&to_aes_gcm_ctx(aec)->ctx, mode, key,
 				     key_len, nonce, nonce_len, tag_len);
 }
@@ -475,21 +494,170 @@ static TEE_Result aes_gcm_update_aad(struct crypto_authenc_ctx *aec,
 					   len);
 }
 
+#ifdef CFG_CRYPTO_HW_GCM
+/* Payload encrypted by the engine and then hashed while still in cache */
+#define GCM_HW_CHUNK_SIZE	(16 * 1024)
+
+static void add_ctr(struct internal_aes_gcm_state *state, size_t n)
+{
+	uint64_t lo = TEE_U64_FROM_BIG_ENDIAN(state->ctr[1]);
+	uint64_t c = lo + n;
+
+	state->ctr[1] = TEE_U64_TO_BIG_ENDIAN(c);
+	if (c < lo) {
+		c = TEE_U64_FROM_BIG_ENDIAN(state->ctr[0]) + 1;
+		state->ctr[0] = TEE_U64_TO_BIG_ENDIAN(c);
+	}
+}
+
+/*
+ * Encrypts or decrypts whole blocks with AES-CTR on the Secure IP engine
+ * and hashes the ciphertext on the CPU. The state is left as
+ * __gcm_update_payload() leaves it after the same blocks.
+ */
+static TEE_Result gcm_update_blocks_hw(struct aes_gcm_ctx *ctx,
+				       TEE_OperationMode mode,
+				       const uint8_t *src, size_t len,
+				       uint8_t *dst)
+{
+	struct internal_aes_gcm_state *state = &ctx->ctx.state;
+	struct internal_aes_gcm_key *ek = &ctx->ctx.key;
+	TEE_Result res = TEE_SUCCESS;
+	void *hw_ctx = NULL;
+	size_t n = 0;
+	size_t l = 0;
+
+	assert(!state->buf_pos && !(len % TEE_AES_BLOCK_SIZE));
+
+	/*
+	 * Encryption keeps the keystream of the next block in buf_cryp
+	 * with the counter one block ahead, see __gcm_init().
+	 */
+	if (mode == TEE_MODE_ENCRYPT)
+		internal_aes_gcm_dec_ctr(state);
+
+	res = crypto_hw_cipher_alloc_ctx(&hw_ctx, TEE_ALG_AES_CTR);
+	if (!res)
+		res = crypto_hw_cipher_init(hw_ctx, TEE_ALG_AES_CTR,
+					    TEE_MODE_ENCRYPT, ctx->key,
+					    ctx->key_len,
+					    (const uint8_t *)state->ctr,
+					    sizeof(state->ctr));
+	if (res) {
+		/* Nothing processed yet, fall back to software */
+		if (hw_ctx)
+			crypto_hw_cipher_free_ctx(hw_ctx);
+		if (mode == TEE_MODE_ENCRYPT)
+			internal_aes_gcm_inc_ctr(state);
+		return internal_aes_gcm_update_payload(&ctx->ctx, mode, src,
+						       len, dst);
+	}
+
+	while (n < len) {
+		l = MIN(len - n, (size_t)GCM_HW_CHUNK_SIZE);
+		/* Hash the ciphertext before it is decrypted in place */
+		if (mode == TEE_MODE_DECRYPT)
+			ghash_update_pad_zero(state, src + n, l);
+		res = crypto_hw_cipher_update(hw_ctx, TEE_ALG_AES_CTR,
+					      TEE_MODE_ENCRYPT, false, src + n,
+					      l, dst + n);
+		if (res)
+			goto out;
+		if (mode == TEE_MODE_ENCRYPT)
+			ghash_update_pad_zero(state, dst + n, l);
+		n += l;
+	}
+
+	add_ctr(state, len / TEE_AES_BLOCK_SIZE);
+	state->payload_bytes += len;
+out:
+	crypto_hw_cipher_final(hw_ctx, TEE_ALG_AES_CTR);
+	crypto_hw_cipher_free_ctx(hw_ctx);
+	if (mode == TEE_MODE_ENCRYPT) {
+		crypto_aes_enc_block(ek->data, sizeof(ek->data), ek->rounds,
+				     state->ctr, state->buf_cryp);
+		internal_aes_gcm_inc_ctr(state);
+	}
+
+	return res;
+}
+
+/*
+ * Runs the whole blocks of large payloads through gcm_update_blocks_hw(),
+ * completing a pending partial block and the trailing bytes in software.
+ * Short payloads are processed in software only.
+ */
+static TEE_Result gcm_update_payload_hw(struct aes_gcm_ctx *ctx,
+					TEE_OperationMode mode,
+					const uint8_t *src, size_t len,
+					uint8_t *dst)
+{
+	struct internal_aes_gcm_state *state = &ctx->ctx.state;
+	TEE_Result res = TEE_SUCCESS;
+	size_t head = 0;
+	size_t bulk = 0;
+
+	if (len < CFG_CRYPTO_HW_GCM_MIN_LEN)
+		return internal_aes_gcm_update_payload(&ctx->ctx, mode, src,
+						       len, dst);
+
+	/*
+	 * Completes a pending partial block of payload, or hashes the last
+	 * partial block of AAD.
+	 */
+	if (state->payload_bytes && state->buf_pos)
+		head = TEE_AES_BLOCK_SIZE - state->buf_pos;
+	res = internal_aes_gcm_update_payload(&ctx->ctx, mode, src, head,
+					      dst);
+	if (res)
+		return res;
+
+	bulk = ROUNDDOWN(len - head, TEE_AES_BLOCK_SIZE);
+	res = gcm_update_blocks_hw(ctx, mode, src + head, bulk, dst + head);
+	if (res)
+		return res;
+
+	return internal_aes_gcm_update_payload(&ctx->ctx, mode,
+					       src + head + bulk,
+					       len - head - bulk,
+					       dst + head + bulk);
+}
+#endif /*CFG_CRYPTO_HW_GCM*/
+
 static TEE_Result aes_gcm_update_payload(struct crypto_authenc_ctx *aec,
 					 TEE_OperationMode m,
 					 const uint8_t *src, size_t len,
 					 uint8_t *dst)
 {
+#ifdef CFG_CRYPTO_HW_GCM
+	return gcm_update_payload_hw(to_aes_gcm_ctx(aec), m, src, len, dst);
+#else
 	return internal_aes_gcm_update_payload(&to_aes_gcm_ctx(aec)->ctx,
 					       m, src, len, dst);
+#endif
 }
 
 static TEE_Result aes_gcm_enc_final(struct crypto_authenc_ctx *aec,
 				    const uint8_t *src, size_t len,
 				    uint8_t *dst, uint8_t *tag, size_t *tag_len)
 {
+#ifdef CFG_CRYPTO_HW_GCM
+	TEE_Result res = TEE_SUCCESS;
+
+	if (*tag_len < to_aes_gcm_ctx(aec)->ctx.state.tag_len)
+		return TEE_ERROR_SHORT_BUFFER;
+
+	res = gcm_update_payload_hw(to_aes_gcm_ctx(aec), TEE_MODE_ENCRYPT,
+				    src, len, dst);
+	if (res)
+		return res;
+
+	return internal_aes_gcm_enc_final(&to_aes_gcm_ctx(aec)->ctx, NULL, 0,
+					  NULL, tag, tag_len);
+#else
 	return internal_aes_gcm_enc_final(&to_aes_gcm_ctx(aec)->ctx, src, len,
 					  dst, tag, tag_len);
+#endif
 }
 
 static TEE_Result aes_gcm_dec_final(struct crypto_authenc_ctx *aec,
@@ -497,8 +665,23 @@ static TEE_Result aes_gcm_dec_final(struct crypto_authenc_ctx *aec,
 				    uint8_t *dst, const uint8_t *tag,
 				    size_t tag_len)
 {
+#ifdef CFG_CRYPTO_HW_GCM
+	TEE_Result res = TEE_SUCCESS;
+
+	if (tag_len != to_aes_gcm_ctx(aec)->ctx.state.tag_len)
+		return TEE_ERROR_MAC_INVALID;
+
+	res = gcm_update_payload_hw(to_aes_gcm_ctx(aec), TEE_MODE_DECRYPT,
+				    src, len, dst);
+	if (res)
+		return res;
+
+	return internal_aes_gcm_dec_final(&to_aes_gcm_ctx(aec)->ctx, NULL, 0,
+					  NULL, tag, tag_len);
+#else
 	return internal_aes_gcm_dec_final(&to_aes_gcm_ctx(aec)->ctx, src, len,
 					  dst, tag, tag_len);
+#endif
 }
 
 static void aes_gcm_final(struct crypto_authenc_ctx *aec __unused)
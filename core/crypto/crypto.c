@@ -12,26 +12,177 @@
 #include <crypto/crypto_impl.h>
 #include <kernel/panic.h>
 #include <stdlib.h>
+#include <stdlib_ext.h>
 #include <string.h>
 #include <utee_defines.h>
+#include <util.h>
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+#include <arm.h>
+#include <atomic.h>
+#include <initcall.h>
+#include <trace.h>
+
+/* Operation sizes measured by the calibration */
+#define DISPATCH_CALIB_MIN_LEN		16U
+#define DISPATCH_CALIB_MAX_LEN		4096U
+#define DISPATCH_CALIB_LOOPS		8U
+/* Threshold scale while another operation is using the HW engine */
+#define DISPATCH_BUSY_FACTOR		4U
+/* Operation size from which the HW engine is used until calibrated */
+#define DISPATCH_DEFAULT_THRESHOLD	256U
+
+#define DISPATCH_ENTRY_INIT { \
+		.threshold = DISPATCH_DEFAULT_THRESHOLD, \
+		.busy_threshold = DISPATCH_DEFAULT_THRESHOLD * \
+				  DISPATCH_BUSY_FACTOR, \
+		.avg_len = DISPATCH_DEFAULT_THRESHOLD, \
+	}
 
-TEE_Result crypto_hash_alloc_ctx(void **ctx, uint32_t algo)
+static struct crypto_hw_dispatch_entry
+dispatch_table[CRYPTO_HW_DISPATCH_NUM] __nex_data = {
+	[CRYPTO_HW_DISPATCH_HASH] = DISPATCH_ENTRY_INIT,
+	[CRYPTO_HW_DISPATCH_MAC] = DISPATCH_ENTRY_INIT,
+	[CRYPTO_HW_DISPATCH_CIPHER] = DISPATCH_ENTRY_INIT,
+};
+
+/* Operations in progress on the HW engine */
+static uint32_t dispatch_hw_busy __nex_bss;
+
+/*
+ * Initializes the engine selection state of a new HW context. Only a
+ * missing memory is an error when allocating the SW context, an algorithm
+ * without SW implementation always runs on the HW engine.
+ */
+static TEE_Result dispatch_attach(struct crypto_hw_dispatch *d,
+				  TEE_Result sw_res, void *sw_ctx)
+{
+	if (sw_res == TEE_ERROR_OUT_OF_MEMORY)
+		return sw_res;
+
+	d->sw_ctx = NULL;
+	if (sw_res == TEE_SUCCESS)
+		d->sw_ctx = sw_ctx;
+	d->engine = SS_HW_ENGINE;
+	d->pinned = false;
+	d->hw_open = false;
+	d->op_len = 0;
+	d->last_len = 0;
+
+	return TEE_SUCCESS;
+}
+
+static void *dispatch_sw_ctx(struct crypto_hw_dispatch *d)
+{
+	if (d->engine == SS_SW_ENGINE)
+		return d->sw_ctx;
+
+	return NULL;
+}
+
+static void dispatch_close(struct crypto_hw_dispatch *d)
+{
+	if (d->hw_open) {
+		d->hw_open = false;
+		atomic_dec32(&dispatch_hw_busy);
+	}
+}
+
+/*
+ * Selects the engine of a new operation from the size of the previous
+ * operation on the context, or the average size of the class for a new
+ * context. Returns the SW context if the SW engine is selected.
+ */
+static void *dispatch_select(struct crypto_hw_dispatch *d, uint32_t class)
+{
+	struct crypto_hw_dispatch_entry *e = &dispatch_table[class];
+	uint32_t threshold = e->threshold;
+	size_t expect = d->last_len;
+
+	dispatch_close(d);
+
+	if (!d->pinned) {
+		if (!expect)
+			expect = e->avg_len;
+		if (atomic_load_u32(&dispatch_hw_busy))
+			threshold = e->busy_threshold;
+
+		if (d->sw_ctx && expect < threshold) {
+			d->engine = SS_SW_ENGINE;
+			atomic_inc32(&e->sw_count);
+		} else {
+			d->engine = SS_HW_ENGINE;
+			atomic_inc32(&e->hw_count);
+		}
+	}
+
+	if (d->engine == SS_HW_ENGINE) {
+		d->hw_open = true;
+		atomic_inc32(&dispatch_hw_busy);
+	}
+	d->op_len = 0;
+
+	return dispatch_sw_ctx(d);
+}
+
+static void *dispatch_update(struct crypto_hw_dispatch *d, size_t len)
+{
+	d->op_len += len;
+
+	return dispatch_sw_ctx(d);
+}
+
+static void *dispatch_final(struct crypto_hw_dispatch *d, uint32_t class)
+{
+	struct crypto_hw_dispatch_entry *e = &dispatch_table[class];
+	uint32_t len = MIN(d->op_len, (size_t)UINT32_MAX);
+
+	if (!d->pinned) {
+		d->last_len = d->op_len;
+		/*
+		 * Average over about the last 8 operations. Concurrent
+		 * updates may drop a sample, which only delays the average.
+		 */
+		e->avg_len = e->avg_len - e->avg_len / 8 + len / 8;
+	}
+	dispatch_close(d);
+
+	return dispatch_sw_ctx(d);
+}
+
+/* Copies a HW context, the destination keeps its own SW context */
+static void *dispatch_copy(void *dst_ctx, struct crypto_hw_dispatch *dst,
+			   const void *src_ctx,
+			   const struct crypto_hw_dispatch *src, size_t ctx_size)
+{
+	struct crypto_hw_dispatch saved = *dst;
+
+	(void)memcpy(dst_ctx, src_ctx, ctx_size);
+	*dst = saved;
+	dst->engine = src->engine;
+	dst->op_len = src->op_len;
+	dst->last_len = src->last_len;
+
+	return dispatch_sw_ctx(dst);
+}
+#endif /* CFG_CRYPTO_HW_DISPATCH */
+
+static TEE_Result sg_total_len(const struct crypto_sg *sg, size_t num,
+			       size_t *len)
+{
+	size_t n = 0;
+
+	*len = 0;
+	for (n = 0; n < num; n++)
+		if (ADD_OVERFLOW(*len, sg[n].len, len))
+			return TEE_ERROR_OVERFLOW;
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result hash_alloc_sw_ctx(void **ctx, uint32_t algo)
 {
 	TEE_Result res = TEE_ERROR_NOT_IMPLEMENTED;
 	struct crypto_hash_ctx *c = NULL;
-#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
-    void *ss_ctx = NULL;
-
-    if (crypto_hw_hash_check_support(algo) == SS_HW_SUPPORT_ALG)
-    {
-        res = crypto_hw_hash_alloc_ctx(&ss_ctx, algo);
-        if (TEE_SUCCESS == res)
-        {
-            *ctx = ss_ctx;
-        }
-        return res;
-    }
-#endif
 
 	/*
 	 * Use default cryptographic implementation if no matching
@@ -73,6 +224,42 @@ TEE_Result crypto_hash_alloc_ctx(void **ctx, uint32_t algo)
 	return res;
 }
 
+TEE_Result crypto_hash_alloc_ctx(void **ctx, uint32_t algo)
+{
+#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
+    TEE_Result res = TEE_ERROR_NOT_IMPLEMENTED;
+    void *ss_ctx = NULL;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    TEE_Result sw_res = TEE_ERROR_NOT_IMPLEMENTED;
+    void *sw_ctx = NULL;
+#endif
+
+    if (crypto_hw_hash_check_support(algo) == SS_HW_SUPPORT_ALG)
+    {
+        res = crypto_hw_hash_alloc_ctx(&ss_ctx, algo);
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+        if (TEE_SUCCESS == res)
+        {
+            sw_res = hash_alloc_sw_ctx(&sw_ctx, algo);
+            res = dispatch_attach(crypto_hw_hash_get_dispatch(ss_ctx),
+                    sw_res, sw_ctx);
+            if (TEE_SUCCESS != res)
+            {
+                crypto_hw_hash_free_ctx(ss_ctx);
+            }
+        }
+#endif
+        if (TEE_SUCCESS == res)
+        {
+            *ctx = ss_ctx;
+        }
+        return res;
+    }
+#endif
+
+	return hash_alloc_sw_ctx(ctx, algo);
+}
+
 static const struct crypto_hash_ops *hash_ops(void *ctx)
 {
 	struct crypto_hash_ctx *c = ctx;
@@ -86,12 +273,23 @@ void crypto_hash_free_ctx(void *ctx)
 {
 #if defined(CFG_CRYPT_HW_CRYPTOENGINE)
     uint32_t engine = 0;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    struct crypto_hw_dispatch *d = NULL;
+#endif
 
     if (crypto_hw_hash_check_current_engine(ctx, &engine) == TEE_SUCCESS)
     {
         if (engine == SS_HW_ENGINE)
         {
-            free(ctx);
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            d = crypto_hw_hash_get_dispatch(ctx);
+            dispatch_close(d);
+            if (d->sw_ctx != NULL)
+            {
+                hash_ops(d->sw_ctx)->free_ctx(d->sw_ctx);
+            }
+#endif
+            crypto_hw_hash_free_ctx(ctx);
             return;
         }
     }
@@ -111,6 +309,10 @@ void crypto_hash_copy_state(void *dst_ctx, void *src_ctx)
     uint32_t algo = 0;
     uint32_t engine = 0;
     TEE_Result res = TEE_SUCCESS;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    struct crypto_hw_dispatch *src = NULL;
+    void *sw_ctx = NULL;
+#endif
 
     if (crypto_hw_hash_check_current_engine(src_ctx, &engine) == TEE_SUCCESS)
     {
@@ -120,7 +322,18 @@ void crypto_hash_copy_state(void *dst_ctx, void *src_ctx)
             res = crypto_hw_hash_get_ctx_size(algo, &ctx_size);
             if(res == TEE_SUCCESS)
             {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+                src = crypto_hw_hash_get_dispatch(src_ctx);
+                sw_ctx = dispatch_copy(dst_ctx,
+                        crypto_hw_hash_get_dispatch(dst_ctx), src_ctx, src,
+                        ctx_size);
+                if (sw_ctx != NULL)
+                {
+                    hash_ops(sw_ctx)->copy_state(sw_ctx, src->sw_ctx);
+                }
+#else
             	(void)memcpy(dst_ctx, src_ctx, ctx_size);
+#endif
             }
             return;
         }
@@ -139,12 +352,23 @@ TEE_Result crypto_hash_init(void *ctx)
     uint32_t algo = 0;
     uint32_t engine = 0;
     TEE_Result ret = TEE_SUCCESS;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    void *sw_ctx = NULL;
+#endif
 
     ret = crypto_hw_hash_check_current_engine(ctx, &engine);
     if (ret == TEE_SUCCESS)
     {
         if (engine == SS_HW_ENGINE)
         {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            sw_ctx = dispatch_select(crypto_hw_hash_get_dispatch(ctx),
+                    CRYPTO_HW_DISPATCH_HASH);
+            if (sw_ctx != NULL)
+            {
+                return hash_ops(sw_ctx)->init(sw_ctx);
+            }
+#endif
             crypto_hw_hash_get_current_algo(ctx, &algo);
             return crypto_hw_hash_init(ctx, algo);
         }
@@ -163,12 +387,22 @@ TEE_Result crypto_hash_update(void *ctx, const uint8_t *data, size_t len)
     uint32_t algo = 0;
     uint32_t engine = 0;
     TEE_Result ret = TEE_SUCCESS;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    void *sw_ctx = NULL;
+#endif
 
     ret = crypto_hw_hash_check_current_engine(ctx, &engine);
     if (ret == TEE_SUCCESS)
     {
         if (engine == SS_HW_ENGINE)
         {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            sw_ctx = dispatch_update(crypto_hw_hash_get_dispatch(ctx), len);
+            if (sw_ctx != NULL)
+            {
+                return hash_ops(sw_ctx)->update(sw_ctx, data, len);
+            }
+#endif
             crypto_hw_hash_get_current_algo(ctx, &algo);
             return crypto_hw_hash_update(ctx, algo, data, len);
         }
@@ -181,18 +415,82 @@ TEE_Result crypto_hash_update(void *ctx, const uint8_t *data, size_t len)
 	return hash_ops(ctx)->update(ctx, data, len);
 }
 
+static TEE_Result hash_update_sg_sw(void *ctx, const struct crypto_sg *sg,
+				    size_t num)
+{
+	TEE_Result res = TEE_SUCCESS;
+	size_t n = 0;
+
+	for (n = 0; n < num && !res; n++)
+		res = hash_ops(ctx)->update(ctx, sg[n].data, sg[n].len);
+
+	return res;
+}
+
+TEE_Result crypto_hash_update_sg(void *ctx, const struct crypto_sg *sg,
+				 size_t num)
+{
+#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
+    uint32_t algo = 0;
+    uint32_t engine = 0;
+    TEE_Result ret = TEE_SUCCESS;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    void *sw_ctx = NULL;
+    size_t len = 0;
+#endif
+
+    ret = crypto_hw_hash_check_current_engine(ctx, &engine);
+    if (ret == TEE_SUCCESS)
+    {
+        if (engine == SS_HW_ENGINE)
+        {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            ret = sg_total_len(sg, num, &len);
+            if (ret != TEE_SUCCESS)
+            {
+                return ret;
+            }
+            sw_ctx = dispatch_update(crypto_hw_hash_get_dispatch(ctx), len);
+            if (sw_ctx != NULL)
+            {
+                return hash_update_sg_sw(sw_ctx, sg, num);
+            }
+#endif
+            crypto_hw_hash_get_current_algo(ctx, &algo);
+            return crypto_hw_hash_update_sg(ctx, algo, sg, num);
+        }
+    }
+    else
+    {
+        return ret;
+    }
+#endif
+	return hash_update_sg_sw(ctx, sg, num);
+}
+
 TEE_Result crypto_hash_final(void *ctx, uint8_t *digest, size_t len)
 {
 #if defined(CFG_CRYPT_HW_CRYPTOENGINE)
     uint32_t algo = 0;
     uint32_t engine = 0;
     TEE_Result ret = TEE_SUCCESS;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    void *sw_ctx = NULL;
+#endif
 
     ret = crypto_hw_hash_check_current_engine(ctx, &engine);
     if (ret == TEE_SUCCESS)
     {
         if (engine == SS_HW_ENGINE)
         {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            sw_ctx = dispatch_final(crypto_hw_hash_get_dispatch(ctx),
+                    CRYPTO_HW_DISPATCH_HASH);
+            if (sw_ctx != NULL)
+            {
+                return hash_ops(sw_ctx)->final(sw_ctx, digest, len);
+            }
+#endif
             crypto_hw_hash_get_current_algo(ctx, &algo);
             return crypto_hw_hash_final(ctx, algo, digest, len);
         }
@@ -205,23 +503,10 @@ TEE_Result crypto_hash_final(void *ctx, uint8_t *digest, size_t len)
 	return hash_ops(ctx)->final(ctx, digest, len);
 }
 
-TEE_Result crypto_cipher_alloc_ctx(void **ctx, uint32_t algo)
+static TEE_Result cipher_alloc_sw_ctx(void **ctx, uint32_t algo)
 {
 	TEE_Result res = TEE_ERROR_NOT_IMPLEMENTED;
 	struct crypto_cipher_ctx *c = NULL;
-#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
-	void *ss_ctx = NULL;
-
-	if (crypto_hw_cipher_check_support(algo) == SS_HW_SUPPORT_ALG)
-	{
-		res = crypto_hw_cipher_alloc_ctx(&ss_ctx, algo);
-		if (TEE_SUCCESS == res)
-		{
-			*ctx = ss_ctx;
-		}
-		return res;
-	}
-#endif
 
 	/*
 	 * Use default cryptographic implementation if no matching
@@ -278,6 +563,43 @@ TEE_Result crypto_cipher_alloc_ctx(void **ctx, uint32_t algo)
 	return res;
 }
 
+TEE_Result crypto_cipher_alloc_ctx(void **ctx, uint32_t algo)
+{
+#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
+	TEE_Result res = TEE_ERROR_NOT_IMPLEMENTED;
+	void *ss_ctx = NULL;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+	TEE_Result sw_res = TEE_ERROR_NOT_IMPLEMENTED;
+	void *sw_ctx = NULL;
+#endif
+
+	if (crypto_hw_cipher_check_support(algo) == SS_HW_SUPPORT_ALG)
+	{
+		res = crypto_hw_cipher_alloc_ctx(&ss_ctx, algo);
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+		if (TEE_SUCCESS == res)
+		{
+			sw_res = cipher_alloc_sw_ctx(&sw_ctx, algo);
+			res = dispatch_attach(
+				crypto_hw_cipher_get_dispatch(ss_ctx),
+				sw_res, sw_ctx);
+			if (TEE_SUCCESS != res)
+			{
+				crypto_hw_cipher_free_ctx(ss_ctx);
+			}
+		}
+#endif
+		if (TEE_SUCCESS == res)
+		{
+			*ctx = ss_ctx;
+		}
+		return res;
+	}
+#endif
+
+	return cipher_alloc_sw_ctx(ctx, algo);
+}
+
 static const struct crypto_cipher_ops *cipher_ops(void *ctx)
 {
 	struct crypto_cipher_ctx *c = ctx;
@@ -291,12 +613,23 @@ void crypto_cipher_free_ctx(void *ctx)
 {
 #if defined(CFG_CRYPT_HW_CRYPTOENGINE)
     uint32_t engine = 0;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    struct crypto_hw_dispatch *d = NULL;
+#endif
 
     if (crypto_hw_cipher_check_current_engine(ctx, &engine) == TEE_SUCCESS)
     {
         if (engine == SS_HW_ENGINE)
         {
-            free(ctx);
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            d = crypto_hw_cipher_get_dispatch(ctx);
+            dispatch_close(d);
+            if (d->sw_ctx != NULL)
+            {
+                cipher_ops(d->sw_ctx)->free_ctx(d->sw_ctx);
+            }
+#endif
+            crypto_hw_cipher_free_ctx(ctx);
             return;
         }
     }
@@ -316,6 +649,10 @@ void crypto_cipher_copy_state(void *dst_ctx, void *src_ctx)
     uint32_t algo = 0;
     uint32_t engine = 0;
     TEE_Result res = TEE_SUCCESS;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    struct crypto_hw_dispatch *src = NULL;
+    void *sw_ctx = NULL;
+#endif
 
     if (crypto_hw_cipher_check_current_engine(src_ctx, &engine) == TEE_SUCCESS)
     {
@@ -325,7 +662,18 @@ void crypto_cipher_copy_state(void *dst_ctx, void *src_ctx)
             res = crypto_hw_cipher_get_ctx_size(algo, &ctx_size);
             if(res == TEE_SUCCESS)
             {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+                src = crypto_hw_cipher_get_dispatch(src_ctx);
+                sw_ctx = dispatch_copy(dst_ctx,
+                        crypto_hw_cipher_get_dispatch(dst_ctx), src_ctx, src,
+                        ctx_size);
+                if (sw_ctx != NULL)
+                {
+                    cipher_ops(sw_ctx)->copy_state(sw_ctx, src->sw_ctx);
+                }
+#else
             	(void)memcpy(dst_ctx, src_ctx, ctx_size);
+#endif
             }
             return;
         }
@@ -347,6 +695,9 @@ TEE_Result crypto_cipher_init(void *ctx, TEE_OperationMode mode,
     uint32_t algo = 0;
     uint32_t engine = 0;
     TEE_Result ret = TEE_SUCCESS;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    void *sw_ctx = NULL;
+#endif
 #endif
 
 	if (mode != TEE_MODE_DECRYPT && mode != TEE_MODE_ENCRYPT)
@@ -358,6 +709,15 @@ TEE_Result crypto_cipher_init(void *ctx, TEE_OperationMode mode,
     {
         if (engine == SS_HW_ENGINE)
         {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            sw_ctx = dispatch_select(crypto_hw_cipher_get_dispatch(ctx),
+                    CRYPTO_HW_DISPATCH_CIPHER);
+            if (sw_ctx != NULL)
+            {
+                return cipher_ops(sw_ctx)->init(sw_ctx, mode, key1,
+                        key1_len, key2, key2_len, iv, iv_len);
+            }
+#endif
             crypto_hw_cipher_get_current_algo(ctx, &algo);
             return crypto_hw_cipher_init(ctx, algo, mode, key1, key1_len, iv,
                     iv_len);
@@ -381,15 +741,40 @@ TEE_Result crypto_cipher_update(void *ctx, TEE_OperationMode mode __unused,
     uint32_t algo = 0;
     uint32_t engine = 0;
     TEE_Result ret = TEE_SUCCESS;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    struct crypto_hw_dispatch *d = NULL;
+    void *sw_ctx = NULL;
+#endif
 
     ret = crypto_hw_cipher_check_current_engine(ctx, &engine);
     if (ret == TEE_SUCCESS)
     {
         if (engine == SS_HW_ENGINE)
         {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            d = crypto_hw_cipher_get_dispatch(ctx);
+            sw_ctx = dispatch_update(d, len);
+            if (sw_ctx != NULL)
+            {
+                ret = cipher_ops(sw_ctx)->update(sw_ctx, last_block, data,
+                        len, dst);
+            }
+            else
+            {
+                crypto_hw_cipher_get_current_algo(ctx, &algo);
+                ret = crypto_hw_cipher_update(ctx, algo, mode, last_block,
+                        data, len, dst);
+            }
+            if (last_block)
+            {
+                (void)dispatch_final(d, CRYPTO_HW_DISPATCH_CIPHER);
+            }
+            return ret;
+#else
             crypto_hw_cipher_get_current_algo(ctx, &algo);
             return crypto_hw_cipher_update(ctx, algo, mode, last_block, data,
                     len, dst);
+#endif
         }
     }
     else
@@ -400,16 +785,123 @@ TEE_Result crypto_cipher_update(void *ctx, TEE_OperationMode mode __unused,
 	return cipher_ops(ctx)->update(ctx, last_block, data, len, dst);
 }
 
+static TEE_Result cipher_update_sg_sw(void *ctx, bool last_block,
+				      const struct crypto_sg *sg, size_t num,
+				      uint8_t *dst)
+{
+	TEE_Result res = TEE_SUCCESS;
+	uint8_t *buf = NULL;
+	size_t len = 0;
+	size_t pos = 0;
+	size_t n = 0;
+
+	if (num == 1)
+		return cipher_ops(ctx)->update(ctx, last_block, sg->data,
+					       sg->len, dst);
+
+	/*
+	 * The fragments may split the cipher blocks, which the SW ciphers
+	 * don't accept on an update, so the list is gathered first.
+	 */
+	res = sg_total_len(sg, num, &len);
+	if (res)
+		return res;
+	if (len) {
+		buf = malloc(len);
+		if (!buf)
+			return TEE_ERROR_OUT_OF_MEMORY;
+	}
+	for (n = 0; n < num; n++) {
+		if (sg[n].len)
+			memcpy(buf + pos, sg[n].data, sg[n].len);
+		pos += sg[n].len;
+	}
+
+	res = cipher_ops(ctx)->update(ctx, last_block, buf, len, dst);
+	free_wipe(buf);
+
+	return res;
+}
+
+TEE_Result crypto_cipher_update_sg(void *ctx, TEE_OperationMode mode __unused,
+				   bool last_block, const struct crypto_sg *sg,
+				   size_t num, uint8_t *dst)
+{
+#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
+    uint32_t algo = 0;
+    uint32_t engine = 0;
+    TEE_Result ret = TEE_SUCCESS;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    struct crypto_hw_dispatch *d = NULL;
+    void *sw_ctx = NULL;
+    size_t len = 0;
+#endif
+
+    ret = crypto_hw_cipher_check_current_engine(ctx, &engine);
+    if (ret == TEE_SUCCESS)
+    {
+        if (engine == SS_HW_ENGINE)
+        {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            ret = sg_total_len(sg, num, &len);
+            if (ret != TEE_SUCCESS)
+            {
+                return ret;
+            }
+            d = crypto_hw_cipher_get_dispatch(ctx);
+            sw_ctx = dispatch_update(d, len);
+            if (sw_ctx != NULL)
+            {
+                ret = cipher_update_sg_sw(sw_ctx, last_block, sg, num, dst);
+            }
+            else
+            {
+                crypto_hw_cipher_get_current_algo(ctx, &algo);
+                ret = crypto_hw_cipher_update_sg(ctx, algo, mode,
+                        last_block, sg, num, dst);
+            }
+            if (last_block)
+            {
+                (void)dispatch_final(d, CRYPTO_HW_DISPATCH_CIPHER);
+            }
+            return ret;
+#else
+            crypto_hw_cipher_get_current_algo(ctx, &algo);
+            return crypto_hw_cipher_update_sg(ctx, algo, mode, last_block,
+                    sg, num, dst);
+#endif
+        }
+    }
+    else
+    {
+        return ret;
+    }
+#endif
+	return cipher_update_sg_sw(ctx, last_block, sg, num, dst);
+}
+
 void crypto_cipher_final(void *ctx)
 {
 #if defined(CFG_CRYPT_HW_CRYPTOENGINE)
     uint32_t algo = 0;
     uint32_t engine = 0;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    struct crypto_hw_dispatch *d = NULL;
+#endif
 
     if (crypto_hw_cipher_check_current_engine(ctx, &engine) == TEE_SUCCESS)
     {
         if (engine == SS_HW_ENGINE)
         {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            d = crypto_hw_cipher_get_dispatch(ctx);
+            dispatch_close(d);
+            if (dispatch_sw_ctx(d) != NULL)
+            {
+                cipher_ops(d->sw_ctx)->final(d->sw_ctx);
+                return;
+            }
+#endif
             crypto_hw_cipher_get_current_algo(ctx, &algo);
             crypto_hw_cipher_final(ctx, algo);
             return;
@@ -447,23 +939,10 @@ TEE_Result crypto_cipher_get_block_size(uint32_t algo, size_t *size)
 	}
 }
 
-TEE_Result crypto_mac_alloc_ctx(void **ctx, uint32_t algo)
+static TEE_Result mac_alloc_sw_ctx(void **ctx, uint32_t algo)
 {
 	TEE_Result res = TEE_SUCCESS;
 	struct crypto_mac_ctx *c = NULL;
-#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
-	void *ss_ctx = NULL;
-
-	if (crypto_hw_mac_check_support(algo) == SS_HW_SUPPORT_ALG)
-	{
-		res = crypto_hw_mac_alloc_ctx(&ss_ctx, algo);
-		if (TEE_SUCCESS == res)
-		{
-			*ctx = ss_ctx;
-		}
-		return res;
-	}
-#endif
 
 	/*
 	 * Use default cryptographic implementation if no matching
@@ -529,6 +1008,42 @@ TEE_Result crypto_mac_alloc_ctx(void **ctx, uint32_t algo)
 	return res;
 }
 
+TEE_Result crypto_mac_alloc_ctx(void **ctx, uint32_t algo)
+{
+#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
+	TEE_Result res = TEE_SUCCESS;
+	void *ss_ctx = NULL;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+	TEE_Result sw_res = TEE_ERROR_NOT_SUPPORTED;
+	void *sw_ctx = NULL;
+#endif
+
+	if (crypto_hw_mac_check_support(algo) == SS_HW_SUPPORT_ALG)
+	{
+		res = crypto_hw_mac_alloc_ctx(&ss_ctx, algo);
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+		if (TEE_SUCCESS == res)
+		{
+			sw_res = mac_alloc_sw_ctx(&sw_ctx, algo);
+			res = dispatch_attach(crypto_hw_mac_get_dispatch(ss_ctx),
+					      sw_res, sw_ctx);
+			if (TEE_SUCCESS != res)
+			{
+				crypto_hw_mac_free_ctx(ss_ctx);
+			}
+		}
+#endif
+		if (TEE_SUCCESS == res)
+		{
+			*ctx = ss_ctx;
+		}
+		return res;
+	}
+#endif
+
+	return mac_alloc_sw_ctx(ctx, algo);
+}
+
 static const struct crypto_mac_ops *mac_ops(void *ctx)
 {
 	struct crypto_mac_ctx *c = ctx;
@@ -542,12 +1057,23 @@ void crypto_mac_free_ctx(void *ctx)
 {
 #if defined(CFG_CRYPT_HW_CRYPTOENGINE)
     uint32_t engine = 0;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    struct crypto_hw_dispatch *d = NULL;
+#endif
 
     if (crypto_hw_mac_check_current_engine(ctx, &engine) == TEE_SUCCESS)
     {
         if (engine == SS_HW_ENGINE)
         {
-            free(ctx);
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            d = crypto_hw_mac_get_dispatch(ctx);
+            dispatch_close(d);
+            if (d->sw_ctx != NULL)
+            {
+                mac_ops(d->sw_ctx)->free_ctx(d->sw_ctx);
+            }
+#endif
+            crypto_hw_mac_free_ctx(ctx);
             return;
         }
     }
@@ -567,6 +1093,10 @@ void crypto_mac_copy_state(void *dst_ctx, void *src_ctx)
     uint32_t algo = 0;
     uint32_t engine = 0;
     TEE_Result res = TEE_SUCCESS;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    struct crypto_hw_dispatch *src = NULL;
+    void *sw_ctx = NULL;
+#endif
 
     if (crypto_hw_mac_check_current_engine(src_ctx, &engine) == TEE_SUCCESS)
     {
@@ -576,7 +1106,18 @@ void crypto_mac_copy_state(void *dst_ctx, void *src_ctx)
             res = crypto_hw_mac_get_ctx_size(algo, &ctx_size);
             if(res == TEE_SUCCESS)
             {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+                src = crypto_hw_mac_get_dispatch(src_ctx);
+                sw_ctx = dispatch_copy(dst_ctx,
+                        crypto_hw_mac_get_dispatch(dst_ctx), src_ctx, src,
+                        ctx_size);
+                if (sw_ctx != NULL)
+                {
+                    mac_ops(sw_ctx)->copy_state(sw_ctx, src->sw_ctx);
+                }
+#else
             	(void)memcpy(dst_ctx, src_ctx, ctx_size);
+#endif
             }
             return;
         }
@@ -595,12 +1136,23 @@ TEE_Result crypto_mac_init(void *ctx, const uint8_t *key, size_t len)
     uint32_t algo = 0;
     uint32_t engine = 0;
     TEE_Result ret = TEE_SUCCESS;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    void *sw_ctx = NULL;
+#endif
 
     ret = crypto_hw_mac_check_current_engine(ctx, &engine);
     if (ret == TEE_SUCCESS)
     {
         if (engine == SS_HW_ENGINE)
         {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            sw_ctx = dispatch_select(crypto_hw_mac_get_dispatch(ctx),
+                    CRYPTO_HW_DISPATCH_MAC);
+            if (sw_ctx != NULL)
+            {
+                return mac_ops(sw_ctx)->init(sw_ctx, key, len);
+            }
+#endif
             crypto_hw_mac_get_current_algo(ctx, &algo);
             return crypto_hw_mac_init(ctx, algo, key, len);
         }
@@ -619,12 +1171,26 @@ TEE_Result crypto_mac_update(void *ctx, const uint8_t *data, size_t len)
     uint32_t algo = 0;
     uint32_t engine = 0;
     TEE_Result ret = TEE_SUCCESS;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    void *sw_ctx = NULL;
+#endif
 
     ret = crypto_hw_mac_check_current_engine(ctx, &engine);
     if (ret == TEE_SUCCESS)
     {
         if (engine == SS_HW_ENGINE)
         {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            sw_ctx = dispatch_update(crypto_hw_mac_get_dispatch(ctx), len);
+            if (sw_ctx != NULL)
+            {
+                if (len == 0U)
+                {
+                    return TEE_SUCCESS;
+                }
+                return mac_ops(sw_ctx)->update(sw_ctx, data, len);
+            }
+#endif
             crypto_hw_mac_get_current_algo(ctx, &algo);
             return crypto_hw_mac_update(ctx, algo, data, len);
         }
@@ -640,18 +1206,83 @@ TEE_Result crypto_mac_update(void *ctx, const uint8_t *data, size_t len)
 	return mac_ops(ctx)->update(ctx, data, len);
 }
 
+static TEE_Result mac_update_sg_sw(void *ctx, const struct crypto_sg *sg,
+				   size_t num)
+{
+	TEE_Result res = TEE_SUCCESS;
+	size_t n = 0;
+
+	for (n = 0; n < num && !res; n++)
+		if (sg[n].len)
+			res = mac_ops(ctx)->update(ctx, sg[n].data, sg[n].len);
+
+	return res;
+}
+
+TEE_Result crypto_mac_update_sg(void *ctx, const struct crypto_sg *sg,
+				size_t num)
+{
+#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
+    uint32_t algo = 0;
+    uint32_t engine = 0;
+    TEE_Result ret = TEE_SUCCESS;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    void *sw_ctx = NULL;
+    size_t len = 0;
+#endif
+
+    ret = crypto_hw_mac_check_current_engine(ctx, &engine);
+    if (ret == TEE_SUCCESS)
+    {
+        if (engine == SS_HW_ENGINE)
+        {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            ret = sg_total_len(sg, num, &len);
+            if (ret != TEE_SUCCESS)
+            {
+                return ret;
+            }
+            sw_ctx = dispatch_update(crypto_hw_mac_get_dispatch(ctx), len);
+            if (sw_ctx != NULL)
+            {
+                return mac_update_sg_sw(sw_ctx, sg, num);
+            }
+#endif
+            crypto_hw_mac_get_current_algo(ctx, &algo);
+            return crypto_hw_mac_update_sg(ctx, algo, sg, num);
+        }
+    }
+    else
+    {
+        return ret;
+    }
+#endif
+	return mac_update_sg_sw(ctx, sg, num);
+}
+
 TEE_Result crypto_mac_final(void *ctx, uint8_t *digest, size_t digest_len)
 {
 #if defined(CFG_CRYPT_HW_CRYPTOENGINE)
     uint32_t algo = 0;
     uint32_t engine = 0;
     TEE_Result ret = TEE_SUCCESS;
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+    void *sw_ctx = NULL;
+#endif
 
     ret = crypto_hw_mac_check_current_engine(ctx, &engine);
     if (ret == TEE_SUCCESS)
     {
         if (engine == SS_HW_ENGINE)
         {
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+            sw_ctx = dispatch_final(crypto_hw_mac_get_dispatch(ctx),
+                    CRYPTO_HW_DISPATCH_MAC);
+            if (sw_ctx != NULL)
+            {
+                return mac_ops(sw_ctx)->final(sw_ctx, digest, digest_len);
+            }
+#endif
             crypto_hw_mac_get_current_algo(ctx, &algo);
             return crypto_hw_mac_final(ctx, algo, digest, digest_len);
         }
@@ -892,7 +1523,7 @@ void crypto_authenc_free_ctx(void *ctx)
     {
         if(engine == SS_HW_ENGINE)
         {
-            free(ctx);
+            crypto_hw_aes_ccm_free_ctx(ctx);
             return;
         }
     }
@@ -1230,6 +1861,35 @@ TEE_Result crypto_acipher_ecc_verify(uint32_t algo, struct ecc_public_key *key,
 	return key->ops->verify(algo, key, msg, msg_len, sig, sig_len);
 }
 
+TEE_Result crypto_acipher_ecc_verify_batch(struct crypto_ecc_verify_item *items,
+					   size_t num)
+{
+	TEE_Result res = TEE_SUCCESS;
+	size_t n = 0;
+
+#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
+	/* The engine verifies the items it supports in one go */
+	crypto_hw_acipher_ecc_verify_batch(items, num);
+#else
+	for (n = 0; n < num; n++)
+		items[n].res = TEE_ERROR_NOT_SUPPORTED;
+#endif
+
+	for (n = 0; n < num; n++) {
+		if (items[n].res == TEE_ERROR_NOT_SUPPORTED)
+			items[n].res = crypto_acipher_ecc_verify(items[n].algo,
+								 items[n].key,
+								 items[n].msg,
+								 items[n].msg_len,
+								 items[n].sig,
+								 items[n].sig_len);
+		if (items[n].res && !res)
+			res = items[n].res;
+	}
+
+	return res;
+}
+
 TEE_Result crypto_acipher_ecc_shared_secret(struct ecc_keypair *private_key,
 					    struct ecc_public_key *public_key,
 					    void *secret,
@@ -1285,3 +1945,199 @@ TEE_Result crypto_acipher_sm2_kep_derive(struct ecc_keypair *my_key __unused,
 __weak void crypto_storage_obj_del(uint8_t *data __unused, size_t len __unused)
 {
 }
+
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+static TEE_Result dispatch_alloc(uint32_t class, void **ctx,
+				 struct crypto_hw_dispatch **d)
+{
+	TEE_Result res = TEE_ERROR_NOT_SUPPORTED;
+
+	switch (class) {
+	case CRYPTO_HW_DISPATCH_HASH:
+		if (crypto_hw_hash_check_support(TEE_ALG_SHA256) ==
+		    SS_HW_SUPPORT_ALG) {
+			res = crypto_hash_alloc_ctx(ctx, TEE_ALG_SHA256);
+			if (!res)
+				*d = crypto_hw_hash_get_dispatch(*ctx);
+		}
+		break;
+	case CRYPTO_HW_DISPATCH_MAC:
+		if (crypto_hw_mac_check_support(TEE_ALG_HMAC_SHA256) ==
+		    SS_HW_SUPPORT_ALG) {
+			res = crypto_mac_alloc_ctx(ctx, TEE_ALG_HMAC_SHA256);
+			if (!res)
+				*d = crypto_hw_mac_get_dispatch(*ctx);
+		}
+		break;
+	default:
+		if (crypto_hw_cipher_check_support(TEE_ALG_AES_CBC_NOPAD) ==
+		    SS_HW_SUPPORT_ALG) {
+			res = crypto_cipher_alloc_ctx(ctx,
+						      TEE_ALG_AES_CBC_NOPAD);
+			if (!res)
+				*d = crypto_hw_cipher_get_dispatch(*ctx);
+		}
+		break;
+	}
+
+	return res;
+}
+
+static void dispatch_free(uint32_t class, void *ctx)
+{
+	switch (class) {
+	case CRYPTO_HW_DISPATCH_HASH:
+		crypto_hash_free_ctx(ctx);
+		break;
+	case CRYPTO_HW_DISPATCH_MAC:
+		crypto_mac_free_ctx(ctx);
+		break;
+	default:
+		crypto_cipher_free_ctx(ctx);
+		break;
+	}
+}
+
+/* Runs one complete operation of @len bytes, @buf holds input and output */
+static TEE_Result dispatch_run(uint32_t class, void *ctx, uint8_t *buf,
+			       size_t len)
+{
+	uint8_t *out = buf + DISPATCH_CALIB_MAX_LEN;
+	TEE_Result res = TEE_SUCCESS;
+
+	switch (class) {
+	case CRYPTO_HW_DISPATCH_HASH:
+		res = crypto_hash_init(ctx);
+		if (!res)
+			res = crypto_hash_update(ctx, buf, len);
+		if (!res)
+			res = crypto_hash_final(ctx, out, TEE_SHA256_HASH_SIZE);
+		break;
+	case CRYPTO_HW_DISPATCH_MAC:
+		res = crypto_mac_init(ctx, buf, TEE_SHA256_HASH_SIZE);
+		if (!res)
+			res = crypto_mac_update(ctx, buf, len);
+		if (!res)
+			res = crypto_mac_final(ctx, out, TEE_SHA256_HASH_SIZE);
+		break;
+	default:
+		res = crypto_cipher_init(ctx, TEE_MODE_ENCRYPT, buf,
+					 TEE_AES_BLOCK_SIZE, NULL, 0, buf,
+					 TEE_AES_BLOCK_SIZE);
+		if (!res)
+			res = crypto_cipher_update(ctx, TEE_MODE_ENCRYPT, true,
+						   buf, len, out);
+		crypto_cipher_final(ctx);
+		break;
+	}
+
+	return res;
+}
+
+static TEE_Result dispatch_measure(uint32_t class, void *ctx, uint8_t *buf,
+				   size_t len, uint64_t *ticks)
+{
+	TEE_Result res = TEE_SUCCESS;
+	uint64_t start = 0;
+	uint32_t n = 0;
+
+	/* The first run loads the code and the keys */
+	res = dispatch_run(class, ctx, buf, len);
+
+	start = barrier_read_cntpct();
+	for (n = 0; n < DISPATCH_CALIB_LOOPS && !res; n++)
+		res = dispatch_run(class, ctx, buf, len);
+	*ticks = barrier_read_cntpct() - start;
+
+	return res;
+}
+
+/*
+ * Finds the smallest operation size for which the HW engine is not slower
+ * than the SW engine.
+ */
+static TEE_Result dispatch_calibrate_class(uint32_t class, uint8_t *buf)
+{
+	struct crypto_hw_dispatch_entry *e = &dispatch_table[class];
+	struct crypto_hw_dispatch *d = NULL;
+	uint32_t threshold = DISPATCH_CALIB_MAX_LEN * 2;
+	uint64_t hw_ticks = 0;
+	uint64_t sw_ticks = 0;
+	void *ctx = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	size_t len = 0;
+
+	res = dispatch_alloc(class, &ctx, &d);
+	if (res == TEE_ERROR_NOT_SUPPORTED)
+		return TEE_SUCCESS;
+	if (res)
+		return res;
+
+	if (d->sw_ctx) {
+		d->pinned = true;
+		for (len = DISPATCH_CALIB_MIN_LEN;
+		     len <= DISPATCH_CALIB_MAX_LEN && !res; len *= 4) {
+			d->engine = SS_HW_ENGINE;
+			res = dispatch_measure(class, ctx, buf, len, &hw_ticks);
+			d->engine = SS_SW_ENGINE;
+			if (!res)
+				res = dispatch_measure(class, ctx, buf, len,
+						       &sw_ticks);
+			DMSG("class %"PRIu32" len %zu hw %"PRIu64" sw %"PRIu64,
+			     class, len, hw_ticks, sw_ticks);
+			if (!res && hw_ticks <= sw_ticks) {
+				threshold = len;
+				break;
+			}
+		}
+	}
+	dispatch_free(class, ctx);
+
+	if (!res) {
+		e->threshold = threshold;
+		e->busy_threshold = threshold * DISPATCH_BUSY_FACTOR;
+	}
+
+	return res;
+}
+
+TEE_Result crypto_hw_dispatch_calibrate(void)
+{
+	TEE_Result res = TEE_SUCCESS;
+	uint8_t *buf = NULL;
+	uint32_t class = 0;
+
+	buf = calloc(2, DISPATCH_CALIB_MAX_LEN);
+	if (!buf)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	for (class = 0; class < CRYPTO_HW_DISPATCH_NUM && !res; class++)
+		res = dispatch_calibrate_class(class, buf);
+
+	free(buf);
+
+	for (class = 0; class < CRYPTO_HW_DISPATCH_NUM; class++)
+		IMSG("HW engine dispatch class %"PRIu32": threshold %"PRIu32,
+		     class, dispatch_table[class].threshold);
+
+	return res;
+}
+
+void crypto_hw_dispatch_get_table(struct crypto_hw_dispatch_entry *table)
+{
+	(void)memcpy(table, dispatch_table, sizeof(dispatch_table));
+}
+
+#if defined(CFG_CRYPTO_HW_DISPATCH_CALIBRATE)
+static TEE_Result dispatch_boot_calibrate(void)
+{
+	TEE_Result res = crypto_hw_dispatch_calibrate();
+
+	if (res)
+		EMSG("HW engine dispatch calibration failed: %#"PRIx32, res);
+
+	return TEE_SUCCESS;
+}
+service_init_late(dispatch_boot_calibrate);
+#endif
+#endif /* CFG_CRYPTO_HW_DISPATCH */
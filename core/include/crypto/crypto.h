@@ -27,10 +27,21 @@
 
 TEE_Result crypto_init(void);
 
+/*
+ * Fragment of a scattered input buffer. The fragments of a list are
+ * processed as if they were concatenated into one buffer.
+ */
+struct crypto_sg {
+	const uint8_t *data;
+	size_t len;
+};
+
 /* Message digest functions */
 TEE_Result crypto_hash_alloc_ctx(void **ctx, uint32_t algo);
 TEE_Result crypto_hash_init(void *ctx);
 TEE_Result crypto_hash_update(void *ctx, const uint8_t *data, size_t len);
+TEE_Result crypto_hash_update_sg(void *ctx, const struct crypto_sg *sg,
+				 size_t num);
 TEE_Result crypto_hash_final(void *ctx, uint8_t *digest, size_t len);
 void crypto_hash_free_ctx(void *ctx);
 void crypto_hash_copy_state(void *dst_ctx, void *src_ctx);
@@ -44,6 +55,9 @@ TEE_Result crypto_cipher_init(void *ctx, TEE_OperationMode mode,
 TEE_Result crypto_cipher_update(void *ctx, TEE_OperationMode mode,
 				bool last_block, const uint8_t *data,
 				size_t len, uint8_t *dst);
+TEE_Result crypto_cipher_update_sg(void *ctx, TEE_OperationMode mode,
+				   bool last_block, const struct crypto_sg *sg,
+				   size_t num, uint8_t *dst);
 void crypto_cipher_final(void *ctx);
 TEE_Result crypto_cipher_get_block_size(uint32_t algo, size_t *size);
 void crypto_cipher_free_ctx(void *ctx);
@@ -53,6 +67,8 @@ void crypto_cipher_copy_state(void *dst_ctx, void *src_ctx);
 TEE_Result crypto_mac_alloc_ctx(void **ctx, uint32_t algo);
 TEE_Result crypto_mac_init(void *ctx, const uint8_t *key, size_t len);
 TEE_Result crypto_mac_update(void *ctx, const uint8_t *data, size_t len);
+TEE_Result crypto_mac_update_sg(void *ctx, const struct crypto_sg *sg,
+				size_t num);
 TEE_Result crypto_mac_final(void *ctx, uint8_t *digest, size_t digest_len);
 void crypto_mac_free_ctx(void *ctx);
 void crypto_mac_copy_state(void *dst_ctx, void *src_ctx);
@@ -121,11 +137,17 @@ struct rsa_keypair {
 	struct bignum *qp;	/* 1/q mod p */
 	struct bignum *dp;	/* d mod (p-1) */
 	struct bignum *dq;	/* d mod (q-1) */
+#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
+	uint32_t hw_gen;	/* Converted key of the HW engine, 0 if none */
+#endif
 };
 
 struct rsa_public_key {
 	struct bignum *e;	/* Public exponent */
 	struct bignum *n;	/* Modulus */
+#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
+	uint32_t hw_gen;	/* Converted key of the HW engine, 0 if none */
+#endif
 };
 
 struct dsa_keypair {
@@ -247,6 +269,29 @@ TEE_Result crypto_acipher_ecc_sign(uint32_t algo, struct ecc_keypair *key,
 TEE_Result crypto_acipher_ecc_verify(uint32_t algo, struct ecc_public_key *key,
 				     const uint8_t *msg, size_t msg_len,
 				     const uint8_t *sig, size_t sig_len);
+
+/*
+ * Signature verified by crypto_acipher_ecc_verify_batch(). Items sharing
+ * a key should point to the same struct ecc_public_key, which lets the
+ * key be loaded once for consecutive items.
+ */
+struct crypto_ecc_verify_item {
+	uint32_t algo;
+	struct ecc_public_key *key;
+	const uint8_t *msg;	/* message digest */
+	size_t msg_len;
+	const uint8_t *sig;
+	size_t sig_len;
+	TEE_Result res;		/* out: result of crypto_acipher_ecc_verify() */
+};
+
+/*
+ * Verifies @num signatures and sets the result of each item. Returns
+ * TEE_SUCCESS if all the signatures are valid, else the result of the
+ * first item that failed.
+ */
+TEE_Result crypto_acipher_ecc_verify_batch(struct crypto_ecc_verify_item *items,
+					   size_t num);
 TEE_Result crypto_acipher_ecc_shared_secret(struct ecc_keypair *private_key,
 					    struct ecc_public_key *public_key,
 					    void *secret,
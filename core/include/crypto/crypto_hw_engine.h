@@ -8,6 +8,8 @@
 
 #include <tee_api_types.h>
 
+struct crypto_sg;
+
 /* This flag notice that it is an algorithm supported by SS6.3-Secure. */
 #define SS_HW_NOT_SUPPORT_ALG 0U
 /* This flag notice that it is not an algorithm supported by SS6.3-Secure. */
@@ -18,6 +20,64 @@
 /* This flag indicates that the HW engine is running. */
 #define SS_HW_ENGINE 1U
 
+/* Classes of operations dispatched between the HW and SW engines */
+#define CRYPTO_HW_DISPATCH_HASH		0U
+#define CRYPTO_HW_DISPATCH_MAC		1U
+#define CRYPTO_HW_DISPATCH_CIPHER	2U
+#define CRYPTO_HW_DISPATCH_NUM		3U
+
+/*
+ * Engine selection state embedded in the HW engine contexts. The SW
+ * context is allocated next to the HW one so that each operation can run
+ * on either engine.
+ */
+struct crypto_hw_dispatch {
+	void *sw_ctx;		/* SW context, NULL if no SW implementation */
+	uint32_t engine;	/* SS_HW_ENGINE or SS_SW_ENGINE */
+	bool pinned;		/* engine fixed by the calibration */
+	bool hw_open;		/* operation in progress on the HW engine */
+	size_t op_len;		/* bytes of the current operation */
+	size_t last_len;	/* bytes of the previous operation, 0 if none */
+};
+
+/* Calibration and statistics of one class of operations */
+struct crypto_hw_dispatch_entry {
+	uint32_t threshold;	/* operation size from which HW is faster */
+	uint32_t busy_threshold; /* same, while the HW engine is busy */
+	uint32_t avg_len;	/* observed bytes per operation */
+	uint32_t hw_count;	/* operations run on the HW engine */
+	uint32_t sw_count;	/* operations run on the SW engine */
+};
+
+/* Context types of the Secure IP context slabs */
+#define CRYPTO_HW_CTX_HASH	0U
+#define CRYPTO_HW_CTX_CIPHER	1U
+#define CRYPTO_HW_CTX_MAC	2U
+#define CRYPTO_HW_CTX_TYPES	3U
+
+/* Usage of the slab of one context type */
+struct crypto_hw_ctx_slab_stats {
+	uint32_t ctx_size;	/* byte size of a context */
+	uint32_t num;		/* contexts in the slab */
+	uint32_t in_use;	/* contexts allocated, slab and heap */
+	uint32_t max_in_use;	/* most contexts allocated at once */
+	uint32_t allocs;	/* contexts allocated */
+	uint32_t heap_allocs;	/* contexts allocated from the heap */
+};
+
+/* Utilization of the Secure IP engine job queue */
+struct crypto_hw_queue_stats {
+	uint32_t depth;		/* jobs waiting for the engine */
+	uint32_t max_depth;	/* most jobs queued at once */
+	uint32_t jobs;		/* jobs run on the engine */
+	uint32_t reserved;
+	uint64_t depth_sum;	/* queued jobs summed over the jobs run */
+	uint64_t bytes;		/* bytes processed by the jobs */
+	uint64_t busy_us;	/* time the engine ran jobs */
+	uint64_t wait_us;	/* time jobs waited for the engine */
+	uint64_t elapsed_us;	/* time since the counters were reset */
+};
+
 /*
  * brief: This function enables derivation of 128 bit customer keys
  *        by performing AES CMAC on customer input.
@@ -260,6 +320,19 @@ TEE_Result crypto_hw_hash_init(void *ctx, uint32_t algo);
 TEE_Result crypto_hw_hash_update(void *ctx, uint32_t algo, const uint8_t *data,
 		size_t len);
 
+/*
+ * brief:	Block Data Update state of HASH algorithm from a scattered
+ *		input buffer.
+ *
+ * param[in]	*ctx		- Context to HASH algorithm.
+ * param[in]	algo		- Cryptographic algorithm.
+ * param[in]	*sg		- List of the input data fragments.
+ * param[in]	num		- Number of fragments in the list.
+ * return	TEE_Result	- TEE internal API error code.
+ */
+TEE_Result crypto_hw_hash_update_sg(void *ctx, uint32_t algo,
+		const struct crypto_sg *sg, size_t num);
+
 /*
  * brief:	Finalize state of HASH algorithm.
  *
@@ -306,6 +379,23 @@ TEE_Result crypto_hw_cipher_update(void *ctx, uint32_t algo,
 		bool last_block __maybe_unused, const uint8_t *data, size_t len,
 		uint8_t *dst);
 
+/*
+ * brief:	Block Data Update state of AES,DES algorithm from a scattered
+ *		source buffer. The destination buffer is contiguous.
+ *
+ * param[in]	*ctx		- Pointer to the AES,DES context.
+ * param[in]	algo		- Cryptographic algorithm.
+ * param[in]	last_block	- If source data is last chunk,
+ *                                the value is true.
+ * param[in]	*sg		- List of the source data fragments.
+ * param[in]	num		- Number of fragments in the list.
+ * param[in]	*dst		- Pointer to destination data buffer.
+ * return	TEE_Result	- TEE internal API error code.
+ */
+TEE_Result crypto_hw_cipher_update_sg(void *ctx, uint32_t algo,
+		TEE_OperationMode mode __unused, bool last_block,
+		const struct crypto_sg *sg, size_t num, uint8_t *dst);
+
 /*
  * brief:	Finalize state of AES,DES algorithm.
  *
@@ -339,6 +429,19 @@ TEE_Result crypto_hw_mac_init(void *ctx, uint32_t algo, const uint8_t *key,
 TEE_Result crypto_hw_mac_update(void *ctx, uint32_t algo, const uint8_t *data,
 		size_t len);
 
+/*
+ * brief:	Block Data Update state of HMAC,AES-MAC algorithm from a
+ *		scattered source buffer.
+ *
+ * param[in]	*ctx		- Pointer to the HMAC,AES-MAC context.
+ * param[in]	algo		- Cryptographic algorithm.
+ * param[in]	*sg		- List of the source data fragments.
+ * param[in]	num		- Number of fragments in the list.
+ * return	TEE_Result	- TEE internal API error code.
+ */
+TEE_Result crypto_hw_mac_update_sg(void *ctx, uint32_t algo,
+		const struct crypto_sg *sg, size_t num);
+
 /*
  * brief:	Finalize state of HMAC,AES-MAC algorithm.
  *
@@ -457,6 +560,26 @@ TEE_Result crypto_hw_acipher_rsassa_verify(uint32_t algo,
 TEE_Result crypto_hw_acipher_gen_rsa_key(struct rsa_keypair *key,
 		size_t key_size);
 
+/*
+ * brief:	Get a new generation of an RSA key object. The converted keys
+ *		of the SS6.3-Secure provider are cached for the key object
+ *		and its generation, which is set when the key object is
+ *		created and renewed when its components are cleared.
+ *
+ * return	uint32_t	- Generation of the key object, never 0.
+ */
+uint32_t crypto_hw_acipher_rsa_key_gen(void);
+
+/*
+ * brief:	Drop the converted RSA keys of a key object from the cache of
+ *		the SS6.3-Secure provider. Called when the key is freed or
+ *		cleared.
+ *
+ * param[in]	*key		- Pointer to the struct rsa_keypair or
+ *				  struct rsa_public_key.
+ */
+void crypto_hw_acipher_rsa_key_release(const void *key);
+
 /*
  * brief:	Generate ECC key pair.
  *
@@ -497,9 +620,10 @@ TEE_Result crypto_hw_acipher_dh_shared_secret(struct dh_keypair *private_key,
 TEE_Result crypto_hw_rng_init(void);
 
 /*
- * brief:	Wrap CRYS_RND_GenerateVector() to output more than 64KB of data.
+ * brief:	Output random bytes. Small requests are served from the pool
+ *		of the current CPU core when CFG_CRYPTO_HW_RNG_POOL is enabled.
  *
- * param[in]	*outPtr		- Pointer of output buffer.
+ * param[out]	*outPtr		- Pointer of output buffer.
  * param[in]	outSize		- Byte size of the output data buffer.
  * return	TEE_Result	- TEE internal API error code.
  */
@@ -542,6 +666,18 @@ TEE_Result crypto_hw_acipher_ecc_verify(struct ecc_public_key *key,
 		const uint8_t *msg, size_t msg_len, const uint8_t *sig,
 		size_t sig_len);
 
+/*
+ * brief:	Verify several signatures by the ECC (FIPS 186-4 ANSI X9.62)
+ *
+ * param[in]	*items		- Signatures to verify. The res of an item
+ *				  is set to its TEE internal API result,
+ *				  TEE_ERROR_NOT_SUPPORTED if the engine does
+ *				  not support its curve and digest size.
+ * param[in]	num		- Number of items.
+ */
+void crypto_hw_acipher_ecc_verify_batch(struct crypto_ecc_verify_item *items,
+		size_t num);
+
 /*
  * brief:	Generate secret key by the ECC.
  *
@@ -592,6 +728,27 @@ TEE_Result crypto_hw_cipher_alloc_ctx(void **ctx, uint32_t algo);
  */
 TEE_Result crypto_hw_mac_alloc_ctx(void **ctx, uint32_t algo);
 
+/*
+ * brief:   Free a context allocated by crypto_hw_hash_alloc_ctx().
+ *
+ * param[in]    *ctx      - Pointer to the HASH context.
+ */
+void crypto_hw_hash_free_ctx(void *ctx);
+
+/*
+ * brief:   Free a context allocated by crypto_hw_cipher_alloc_ctx().
+ *
+ * param[in]    *ctx      - Pointer to the AES,DES context.
+ */
+void crypto_hw_cipher_free_ctx(void *ctx);
+
+/*
+ * brief:   Free a context allocated by crypto_hw_mac_alloc_ctx().
+ *
+ * param[in]    *ctx      - Pointer to the HMAC,AES-MAC context.
+ */
+void crypto_hw_mac_free_ctx(void *ctx);
+
 /*
  * brief:	Allocate a context for AESCCM algorithm.
  *
@@ -600,6 +757,13 @@ TEE_Result crypto_hw_mac_alloc_ctx(void **ctx, uint32_t algo);
  */
 TEE_Result crypto_hw_aes_ccm_alloc_ctx(void **ctx);
 
+/*
+ * brief:	Free a context for AESCCM algorithm.
+ *
+ * param[in]	ctx		- Pointer to the AESCCM context.
+ */
+void crypto_hw_aes_ccm_free_ctx(void *ctx);
+
 /*
  * brief:	Copy a context for AESCCM algorithm.
  *
@@ -723,4 +887,61 @@ TEE_Result crypto_hw_mac_check_current_engine(void *ctx, uint32_t *engine);
  */
 TEE_Result crypto_hw_aes_ccm_check_current_engine(void *ctx, uint32_t *engine);
 
+/*
+ * brief: Get the engine selection state of a HASH context.
+ *
+ * param[in]    *ctx       - Context to HASH algorithm.
+ * return	struct crypto_hw_dispatch * - Engine selection state.
+ */
+struct crypto_hw_dispatch *crypto_hw_hash_get_dispatch(void *ctx);
+
+/*
+ * brief: Get the engine selection state of a Cipher context.
+ *
+ * param[in]    *ctx       - Context to Cipher algorithm.
+ * return	struct crypto_hw_dispatch * - Engine selection state.
+ */
+struct crypto_hw_dispatch *crypto_hw_cipher_get_dispatch(void *ctx);
+
+/*
+ * brief: Get the engine selection state of a MAC context.
+ *
+ * param[in]    *ctx       - Context to MAC algorithm.
+ * return	struct crypto_hw_dispatch * - Engine selection state.
+ */
+struct crypto_hw_dispatch *crypto_hw_mac_get_dispatch(void *ctx);
+
+/*
+ * brief: Get the calibration table of the HW/SW engine dispatch.
+ *
+ * param[out]	*table     - CRYPTO_HW_DISPATCH_NUM entries.
+ */
+void crypto_hw_dispatch_get_table(struct crypto_hw_dispatch_entry *table);
+
+/*
+ * brief: Measure the HW and SW engines and update the calibration table.
+ *
+ * return	TEE_Result     - TEE internal API error code.
+ */
+TEE_Result crypto_hw_dispatch_calibrate(void);
+
+/*
+ * brief: Get the counters of the Secure IP engine job queue.
+ *
+ * param[out]	*stats     - Counters of the job queue.
+ * param[in]	reset      - Restart the counters after reading them.
+ */
+void crypto_hw_queue_get_stats(struct crypto_hw_queue_stats *stats,
+		bool reset);
+
+/*
+ * brief: Get the usage of the context slabs.
+ *
+ * param[out]	*stats     - CRYPTO_HW_CTX_TYPES entries, indexed by
+ *                           CRYPTO_HW_CTX_xxx.
+ * param[in]	reset      - Restart the counters after reading them.
+ */
+void crypto_hw_ctx_slab_get_stats(struct crypto_hw_ctx_slab_stats *stats,
+		bool reset);
+
 #endif /* __CRYPTO_CRYPTO_HW_ENGINE_H */
@@ -57,6 +57,13 @@ bool virt_set_guest(uint16_t guest_id);
  */
 void virt_unset_guest(void);
 
+/**
+ * virt_get_current_guest_id() - get the guest VM of the current core
+ *
+ * Returns the VM id set by virt_set_guest(), or 0 if no guest is set
+ */
+uint16_t virt_get_current_guest_id(void);
+
 /**
  * virt_on_stdcall() - std call hook
  *
@@ -24,6 +24,12 @@
  *
  * [in]     value[0].a-b    UUID
  * [out]    memref[1]	    Buffer with TA
+ *
+ * The TA can be loaded in parts by adding a third parameter, the size of
+ * memref[1] is then the size of the part. tee-supplicant without support
+ * for this returns TEE_ERROR_BAD_PARAMETERS.
+ *
+ * [in]     value[2].a	    Offset of the part in the TA
  */
 #define OPTEE_RPC_CMD_LOAD_TA		0
 
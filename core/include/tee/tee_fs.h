@@ -49,6 +49,14 @@ struct tee_file_operations {
 	TEE_Result (*opendir)(const TEE_UUID *uuid, struct tee_fs_dir **d);
 	TEE_Result (*readdir)(struct tee_fs_dir *d, struct tee_fs_dirent **ent);
 	void (*closedir)(struct tee_fs_dir *d);
+
+	/*
+	 * Optional: updates issued between begin_transaction() and
+	 * commit_transaction() by the same thread may be written to the
+	 * storage at the commit only.
+	 */
+	TEE_Result (*begin_transaction)(void);
+	TEE_Result (*commit_transaction)(void);
 };
 
 #ifdef CFG_REE_FS
@@ -17,6 +17,21 @@
  */
 const struct tee_file_operations *tee_svc_storage_file_ops(uint32_t storage_id);
 
+/*
+ * Opens a transaction of @fops if it supports them, so that the updates
+ * up to tee_svc_storage_commit_transaction() may be written at once.
+ * Returns true if a transaction was opened.
+ */
+bool tee_svc_storage_begin_transaction(const struct tee_file_operations *fops);
+
+/*
+ * Commits the transaction opened by tee_svc_storage_begin_transaction() if
+ * @in_trans. Returns @res, or the commit error if @res is TEE_SUCCESS.
+ */
+TEE_Result
+tee_svc_storage_commit_transaction(const struct tee_file_operations *fops,
+				   bool in_trans, TEE_Result res);
+
 /*
  * Persistant Object Functions
  */
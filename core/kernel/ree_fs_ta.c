@@ -37,6 +37,7 @@
  */
 
 #include <assert.h>
+#include <atomic.h>
 #include <crypto/crypto.h>
 #include <initcall.h>
 #include <kernel/thread.h>
@@ -59,6 +60,9 @@
 #ifdef RCAR_DYNAMIC_TA_AUTH_BY_HWENGINE
 #include "rcar_ta_auth.h"
 #endif
+#ifdef CFG_RCAR_TA_CACHE
+#include "rcar_ta_cache.h"
+#endif
 
 struct ree_fs_ta_handle {
 	struct shdr *nw_ta; /* Non-secure (shared memory) */
@@ -70,6 +74,12 @@ struct ree_fs_ta_handle {
 	void *enc_ctx;
 	struct shdr_bootstrap_ta *bs_hdr;
 	struct shdr_encrypted_ta *ehdr;
+#ifdef RCAR_DYNAMIC_TA_AUTH_BY_HWENGINE
+	struct shdr *auth_ta; /* Verification slot held by the handle */
+#endif
+#ifdef CFG_RCAR_TA_CACHE
+	struct rcar_ta_cache_entry *cache; /* Cached image read by @nw_ta */
+#endif
 };
 
 struct ta_ver_db_hdr {
@@ -130,6 +140,168 @@ exit:
 	return res;
 }
 
+#ifdef CFG_RCAR_TA_CACHE
+/*
+ * Set when tee-supplicant turns out not to support partial loads, read and
+ * written by concurrent opens
+ */
+static unsigned int ree_fs_ta_part_unsupported;
+
+/* Query the size of the TA with UUID @uuid via RPC */
+static TEE_Result rpc_load_size(const TEE_UUID *uuid, size_t *size)
+{
+	TEE_Result res;
+	struct thread_param params[2];
+
+	memset(params, 0, sizeof(params));
+	params[0].attr = THREAD_PARAM_ATTR_VALUE_IN;
+	tee_uuid_to_octets((void *)&params[0].u.value, uuid);
+	params[1].attr = THREAD_PARAM_ATTR_MEMREF_OUT;
+
+	res = thread_rpc_cmd(OPTEE_RPC_CMD_LOAD_TA, 2, params);
+	if (res == TEE_SUCCESS)
+		*size = params[1].u.memref.size;
+
+	return res;
+}
+
+/*
+ * Load @len bytes at offset @offs of the TA with UUID @uuid via RPC into
+ * @mobj.
+ */
+static TEE_Result rpc_load_chunk(const TEE_UUID *uuid, struct mobj *mobj,
+				 size_t offs, size_t len)
+{
+	TEE_Result res;
+	struct thread_param params[3];
+
+	memset(params, 0, sizeof(params));
+	params[0].attr = THREAD_PARAM_ATTR_VALUE_IN;
+	tee_uuid_to_octets((void *)&params[0].u.value, uuid);
+	params[1] = THREAD_PARAM_MEMREF(OUT, mobj, 0, len);
+	params[2] = THREAD_PARAM_VALUE(IN, offs, 0, 0);
+
+	res = thread_rpc_cmd(OPTEE_RPC_CMD_LOAD_TA, 3, params);
+	if (res == TEE_SUCCESS && params[1].u.memref.size != len)
+		res = TEE_ERROR_SECURITY;
+
+	return res;
+}
+
+/*
+ * Digest the certificates of the TA with UUID @uuid, loading only them via
+ * RPC. Fails if tee-supplicant does not support partial loads.
+ */
+static TEE_Result rpc_cert_digest(const TEE_UUID *uuid, uint8_t *digest)
+{
+	TEE_Result res;
+	struct mobj *mobj;
+	size_t size = 0;
+	size_t len = 0;
+
+	if (atomic_load_uint(&ree_fs_ta_part_unsupported))
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	res = rpc_load_size(uuid, &size);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	len = MIN(size, (size_t)RCAR_TA_CERTS_MAX_SIZE);
+	mobj = thread_rpc_alloc_payload(len);
+	if (!mobj)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	if (mobj->size < len)
+		res = TEE_ERROR_SHORT_BUFFER;
+	else
+		res = rpc_load_chunk(uuid, mobj, 0, len);
+	if (res == TEE_ERROR_BAD_PARAMETERS) {
+		DMSG("Partial TA loads not supported by tee-supplicant");
+		atomic_store_uint(&ree_fs_ta_part_unsupported, 1);
+	}
+	if (res == TEE_SUCCESS)
+		res = rcar_auth_ta_cert_digest(mobj_get_va(mobj, 0), len,
+					       digest);
+
+	thread_rpc_free_payload(mobj);
+
+	return res;
+}
+#endif
+
+#ifdef RCAR_DYNAMIC_TA_AUTH_BY_HWENGINE
+/*
+ * Load a TA via RPC and verify its certificates with the MaskROM. The
+ * address of the verified image is received in out parameter @ta, the
+ * verification slot holding it is kept by @handle. With CFG_RCAR_TA_CACHE
+ * the image is served from the cache of verified TAs if the certificates
+ * of the TA are unchanged, and a newly verified image is added to the
+ * cache so that the payload and the slot can be released at once, @mobj
+ * is NULL in both cases.
+ */
+static TEE_Result rcar_load_ta(const TEE_UUID *uuid,
+			       struct ree_fs_ta_handle *handle,
+			       struct shdr **ta, size_t *ta_size,
+			       struct mobj **mobj)
+{
+	TEE_Result res;
+#ifdef CFG_RCAR_TA_CACHE
+	struct rcar_ta_auth_info info;
+	uint8_t digest[TEE_SHA256_HASH_SIZE];
+	bool looked_up = false;
+
+	/* Only the certificates are loaded to look up the cache */
+	if (rpc_cert_digest(uuid, digest) == TEE_SUCCESS) {
+		looked_up = true;
+		if (rcar_ta_cache_get(uuid, digest, &handle->cache, ta,
+				      ta_size) == TEE_SUCCESS)
+			return TEE_SUCCESS;
+	}
+#endif
+
+	/* Request TA from tee-supplicant */
+	res = rpc_load(uuid, ta, ta_size, mobj);
+	if (res != TEE_SUCCESS)
+		return res;
+
+#ifdef CFG_RCAR_TA_CACHE
+	/* Without partial loads the certificates of the whole TA are used */
+	if (!looked_up &&
+	    rcar_auth_ta_cert_digest(*ta, *ta_size, digest) == TEE_SUCCESS &&
+	    rcar_ta_cache_get(uuid, digest, &handle->cache, ta,
+			      ta_size) == TEE_SUCCESS) {
+		thread_rpc_free_payload(*mobj);
+		*mobj = NULL;
+		return TEE_SUCCESS;
+	}
+#endif
+
+#ifdef CFG_RCAR_TA_CACHE
+	res = rcar_auth_ta_certificate(*ta, &handle->auth_ta, &info);
+#else
+	res = rcar_auth_ta_certificate(*ta, &handle->auth_ta, NULL);
+#endif
+	if (res != TEE_SUCCESS) {
+		thread_rpc_free_payload(*mobj);
+		*mobj = NULL;
+		return res;
+	}
+	*ta = handle->auth_ta;
+
+#ifdef CFG_RCAR_TA_CACHE
+	if (rcar_ta_cache_add(uuid, &info, handle->auth_ta, &handle->cache,
+			      ta, ta_size) == TEE_SUCCESS) {
+		thread_rpc_free_payload(*mobj);
+		*mobj = NULL;
+		rcar_auth_ta_release(handle->auth_ta);
+		handle->auth_ta = NULL;
+	}
+#endif
+
+	return TEE_SUCCESS;
+}
+#endif
+
 static TEE_Result ree_fs_ta_open(const TEE_UUID *uuid,
 				 struct ts_store_handle **h)
 {
@@ -148,16 +320,15 @@ static TEE_Result ree_fs_ta_open(const TEE_UUID *uuid,
 	if (!handle)
 		return TEE_ERROR_OUT_OF_MEMORY;
 
+#ifdef RCAR_DYNAMIC_TA_AUTH_BY_HWENGINE
+	res = rcar_load_ta(uuid, handle, &ta, &ta_size, &mobj);
+	if (res != TEE_SUCCESS)
+		goto error;
+#else
 	/* Request TA from tee-supplicant */
 	res = rpc_load(uuid, &ta, &ta_size, &mobj);
 	if (res != TEE_SUCCESS)
 		goto error;
-
-#ifdef RCAR_DYNAMIC_TA_AUTH_BY_HWENGINE
-	res = rcar_auth_ta_certificate(ta, &ta);
-	if (res != TEE_SUCCESS) {
-		goto error_free_payload;
-	}
 #endif
 	/* Make secure copy of signed header */
 	shdr = shdr_alloc_and_copy(ta, ta_size);
@@ -283,8 +454,15 @@ static TEE_Result ree_fs_ta_open(const TEE_UUID *uuid,
 error_free_hash:
 	crypto_hash_free_ctx(hash_ctx);
 error_free_payload:
-	thread_rpc_free_payload(mobj);
+	if (mobj)
+		thread_rpc_free_payload(mobj);
 error:
+#ifdef RCAR_DYNAMIC_TA_AUTH_BY_HWENGINE
+	rcar_auth_ta_release(handle->auth_ta);
+#endif
+#ifdef CFG_RCAR_TA_CACHE
+	rcar_ta_cache_put(handle->cache);
+#endif
 	free(ehdr);
 	free(bs_hdr);
 	shdr_free(shdr);
@@ -526,7 +704,14 @@ static void ree_fs_ta_close(struct ts_store_handle *h)
 
 	if (!handle)
 		return;
-	thread_rpc_free_payload(handle->mobj);
+	if (handle->mobj)
+		thread_rpc_free_payload(handle->mobj);
+#ifdef RCAR_DYNAMIC_TA_AUTH_BY_HWENGINE
+	rcar_auth_ta_release(handle->auth_ta);
+#endif
+#ifdef CFG_RCAR_TA_CACHE
+	rcar_ta_cache_put(handle->cache);
+#endif
 	crypto_hash_free_ctx(handle->hash_ctx);
 	free(handle->shdr);
 	free(handle->ehdr);
@@ -14,3 +14,6 @@ cflags-tee_ss_provider.c-y += -Wno-undef -Wno-maybe-uninitialized
 
 # Common Function for Provider
 srcs-y += tee_provider_common.c
+
+# Scheduler of the asymmetric operations on the hardware units
+srcs-y += tee_asymm_sched.c
@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2021, Renesas Electronics Corporation
+ */
+
+#include <kernel/mutex.h>
+#include <kernel/panic.h>
+#include <kernel/thread.h>
+#include <kernel/virtualization.h>
+#include <optee_rpc_cmd.h>
+#include <sys/queue.h>
+#include "tee_asymm_sched.h"
+#include "rcar_mutex.h"
+
+/*
+ * Each hardware unit runs one asymmetric operation at a time. The unit is
+ * handed over by the owner to the next waiter: the guests are served round
+ * robin and the waiters of a guest in FIFO order. Without virtualization
+ * all waiters belong to guest 0, so the unit is served in FIFO order.
+ */
+struct ss_asymm_waiter {
+	TAILQ_ENTRY(ss_asymm_waiter) link;
+	uint16_t guest;		/* guest of the waiting thread */
+	bool granted;		/* unit handed over to the waiting thread */
+};
+
+TAILQ_HEAD(ss_asymm_waiter_head, ss_asymm_waiter);
+
+struct ss_asymm_unit {
+	struct mutex mutex;	/* protects the fields below */
+	struct condvar cv;	/* waiters, without virtualization only */
+	bool busy;		/* an operation runs on the unit */
+	uint16_t guest;		/* guest the unit was last handed to */
+	struct ss_asymm_waiter_head waiters;
+};
+
+#define SS_ASYMM_UNIT_INITIALIZER(unit) { \
+	.mutex = MUTEX_INITIALIZER, \
+	.cv = CONDVAR_INITIALIZER, \
+	.waiters = TAILQ_HEAD_INITIALIZER(ss_asymm_units[(unit)].waiters), \
+}
+
+/******************************************************************************/
+/* Static Function Prototypes                                                 */
+/******************************************************************************/
+static uint16_t ss_asymm_guest(void);
+static struct ss_asymm_waiter *ss_asymm_next(struct ss_asymm_unit *u);
+static void ss_asymm_wait(struct ss_asymm_unit *u, struct ss_asymm_waiter *w);
+
+static struct ss_asymm_unit ss_asymm_units[SS_ASYMM_UNIT_NUM] __nex_data = {
+	[SS_ASYMM_UNIT_CC] = SS_ASYMM_UNIT_INITIALIZER(SS_ASYMM_UNIT_CC),
+	[SS_ASYMM_UNIT_PKA] = SS_ASYMM_UNIT_INITIALIZER(SS_ASYMM_UNIT_PKA),
+};
+
+/*
+ * brief:	Get the guest of the calling thread.
+ *
+ * return	uint16_t	- Guest ID, 0 without virtualization.
+ */
+static uint16_t ss_asymm_guest(void)
+{
+#ifdef CFG_VIRTUALIZATION
+	return virt_get_current_guest_id();
+#else
+	return 0U;
+#endif
+}
+
+/*
+ * brief:	Select the waiter to hand the unit over to. The caller holds
+ *		the mutex of the unit.
+ *
+ * param[in]	*u		- Hardware unit.
+ * return	struct ss_asymm_waiter * - Next waiter, NULL if none.
+ */
+static struct ss_asymm_waiter *ss_asymm_next(struct ss_asymm_unit *u)
+{
+	struct ss_asymm_waiter *w;
+	struct ss_asymm_waiter *next = NULL;
+	uint16_t dist;
+	uint16_t best = 0U;
+
+	/*
+	 * The guest following the last served one is the closest, the last
+	 * served guest itself the farthest. The first waiter of the closest
+	 * guest is selected.
+	 */
+	TAILQ_FOREACH(w, &u->waiters, link) {
+		dist = (uint16_t)(w->guest - u->guest - 1U);
+		if ((next == NULL) || (dist < best)) {
+			next = w;
+			best = dist;
+		}
+	}
+	return next;
+}
+
+/*
+ * brief:	Wait until the unit is handed over to the waiter. The caller
+ *		holds the mutex of the unit.
+ *
+ * param[in]	*u		- Hardware unit.
+ * param[in]	*w		- Waiter queued on the unit.
+ */
+static void ss_asymm_wait(struct ss_asymm_unit *u, struct ss_asymm_waiter *w)
+{
+#ifdef CFG_VIRTUALIZATION
+	TEE_Result res;
+	struct thread_param params = THREAD_PARAM_VALUE(IN,
+					CFG_RCAR_MUTEX_DELAY, 0, 0);
+
+	/* The owner may run in another guest, so poll instead of sleeping */
+	while (!w->granted) {
+		rcar_nex_mutex_unlock(&u->mutex);
+		res = thread_rpc_cmd(OPTEE_RPC_CMD_SUSPEND, 1, &params);
+		if (res != TEE_SUCCESS) {
+			panic("ss_asymm_wait failed");
+		}
+		rcar_nex_mutex_lock(&u->mutex);
+	}
+#else
+	while (!w->granted) {
+		condvar_wait(&u->cv, &u->mutex);
+	}
+#endif
+}
+
+/*
+ * brief:	Wait for a hardware unit and take it for an operation.
+ *
+ * param[in]	unit		- Hardware unit (SS_ASYMM_UNIT_xxx).
+ */
+void ss_asymm_acquire(uint32_t unit)
+{
+	struct ss_asymm_unit *u;
+	struct ss_asymm_waiter w = { .granted = false };
+
+	if (unit >= SS_ASYMM_UNIT_NUM) {
+		panic("ss_asymm_acquire unit");
+	}
+	u = &ss_asymm_units[unit];
+	w.guest = ss_asymm_guest();
+
+	rcar_nex_mutex_lock(&u->mutex);
+	if (!u->busy) {
+		u->busy = true;
+		u->guest = w.guest;
+	} else {
+		TAILQ_INSERT_TAIL(&u->waiters, &w, link);
+		ss_asymm_wait(u, &w);
+	}
+	rcar_nex_mutex_unlock(&u->mutex);
+}
+
+/*
+ * brief:	Release a hardware unit and hand it over to the next waiter.
+ *
+ * param[in]	unit		- Hardware unit (SS_ASYMM_UNIT_xxx).
+ */
+void ss_asymm_release(uint32_t unit)
+{
+	struct ss_asymm_unit *u;
+	struct ss_asymm_waiter *w;
+
+	if (unit >= SS_ASYMM_UNIT_NUM) {
+		panic("ss_asymm_release unit");
+	}
+	u = &ss_asymm_units[unit];
+
+	rcar_nex_mutex_lock(&u->mutex);
+	w = ss_asymm_next(u);
+	if (w != NULL) {
+		TAILQ_REMOVE(&u->waiters, w, link);
+		u->guest = w->guest;
+		w->granted = true;
+#ifndef CFG_VIRTUALIZATION
+		condvar_broadcast(&u->cv);
+#endif
+	} else {
+		u->busy = false;
+	}
+	rcar_nex_mutex_unlock(&u->mutex);
+}
@@ -0,0 +1,22 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Copyright (c) 2021, Renesas Electronics Corporation
+ */
+
+#ifndef TEE_ASYMM_SCHED_H
+#define TEE_ASYMM_SCHED_H
+
+#include <stdint.h>
+
+/* Hardware units of the asymmetric operations */
+#define SS_ASYMM_UNIT_CC	0U	/* PKA of CryptoCell (CRYS API) */
+#define SS_ASYMM_UNIT_PKA	1U	/* Crypto Engine PKA (SA_PKADRV API) */
+#define SS_ASYMM_UNIT_NUM	2U
+
+/******************************************************************************/
+/* Public Function Prototypes                                                 */
+/******************************************************************************/
+void ss_asymm_acquire(uint32_t unit);
+void ss_asymm_release(uint32_t unit);
+
+#endif
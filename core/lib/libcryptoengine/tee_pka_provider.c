@@ -7,7 +7,10 @@
 #include "include_pka/sa_pkadrvlib.h"
 #include "tee_provider_common.h"
 #include "tee_pka_provider.h"
-#include "rcar_mutex.h"
+#include "tee_asymm_sched.h"
+
+/* Items of a batch verified before the PKA is handed over to waiters */
+#define PKA_VERIFY_BATCH_HOLD	(8U)
 
 /******************************************************************************/
 /* Static Function Prototypes                                                 */
@@ -20,8 +23,11 @@ static SSError_t pka_get_ecc_keysize(uint32_t curve,
 		uint32_t *key_size_bytes);
 static void userProcessCompletedFunc(CRYSError_t opStatus __unused,
 		void* pVerifContext __unused);
-
-static struct mutex pka_ecdsa_mutex __nex_data = MUTEX_INITIALIZER;
+static SSError_t pka_build_publ_key(struct ecc_public_key *key,
+		CRYS_ECPKI_UserPublKey_t *pUserPublKey);
+static SSError_t pka_verify_message(CRYS_ECPKI_UserPublKey_t *pUserPublKey,
+		const uint8_t *msg, size_t msg_len, const uint8_t *sig,
+		size_t sig_len);
 
 /*
  * brief:	Translate  CRYS API AES error into SS provider error.
@@ -169,27 +175,19 @@ static void userProcessCompletedFunc(CRYSError_t opStatus __unused,
 }
 
 /*
- * brief:	Verify by the ECC using CRYS API (FIPS 186-4 ANSI X9.62)
+ * brief:	Build the PKA public key of an ECC public key. The caller
+ *		holds the SS_ASYMM_UNIT_PKA unit.
  *
- * param[in]	*key		- Pointer to the struct of the ECC key pair.
- * param[in]	*msg		- Pointer to the message data buffer.
- * param[in]	msg_len		- Size of message data buffer.
- * param[in]	*sig		- Pointer to the signature data buffer.
- * param[in]	*sig_len	- Size of signature data buffer.
+ * param[in]	*key		- Pointer to the struct of the ECC public key.
+ * param[out]	*pUserPublKey	- Pointer to the PKA public key.
  * return	SSError_t	- SS provider error code.
  */
-SSError_t ss_ecc_verify_pka(struct ecc_public_key *key, const uint8_t *msg,
-		size_t msg_len, const uint8_t *sig, size_t sig_len)
+static SSError_t pka_build_publ_key(struct ecc_public_key *key,
+		CRYS_ECPKI_UserPublKey_t *pUserPublKey)
 {
 	CRYSError_t crys_res = CRYS_OK;
 	SSError_t res = SS_SUCCESS;
 	SA_PkadrvlibRetCode_t pka_res = SA_PKADRVLIB_RET_OK;
-	CRYS_ECPKI_UserPublKey_t *pUserPublKey = NULL;
-	CRYS_ECPKI_HASH_OpMode_t eccHash;
-	uint8_t *pSignatureIn;
-	uint32_t signatureSizeBytes;
-	uint8_t *pMessageDataIn;
-	uint32_t messageSizeInBytes;
 	CRYS_ECPKI_DomainID_t domain_id;
 	CRYS_ECPKI_Domain_t *ecc_domain;
 	uint8_t *publKeyIn_ptr = NULL;
@@ -200,25 +198,11 @@ SSError_t ss_ecc_verify_pka(struct ecc_public_key *key, const uint8_t *msg,
 	uint8_t *publKeyX_ptr = NULL;
 	uint8_t *publKeyY_ptr = NULL;
 
-	PROV_INMSG("*key=%p, *msg=%p, msg_len=%ld\n", (void * )key, msg,
-			msg_len);
-	PROV_INMSG("*sig=%p, sig_len=%ld\n", sig, sig_len);
-
-	pSignatureIn = (uint8_t *)sig;
-	signatureSizeBytes = (uint32_t)sig_len;
-	pMessageDataIn = (uint8_t *)msg;
-	messageSizeInBytes = (uint32_t)msg_len;
-
 	if (key == NULL) {
 		res = SS_ERROR_BAD_PARAMETERS;
 		PROV_DMSG("BAD_PARAMETERS(key)\n");
 	}
 
-	if (res == SS_SUCCESS) {
-		pUserPublKey = (CRYS_ECPKI_UserPublKey_t *)ss_malloc(
-				sizeof(CRYS_ECPKI_UserPublKey_t), &res);
-	}
-
 	if (res == SS_SUCCESS) {
 		res = pka_get_ecc_keysize(key->curve, &domain_id, &modulusbytes);
 	}
@@ -241,11 +225,6 @@ SSError_t ss_ecc_verify_pka(struct ecc_public_key *key, const uint8_t *msg,
 		publKeyIn_ptr = (uint8_t *)ss_calloc(1U, publKeySizeInBytes, &res);
 	}
 
-	if (res == SS_SUCCESS) {
-		res = pka_get_ecc_digest(messageSizeInBytes, &eccHash);
-	}
-
-	rcar_nex_mutex_lock(&pka_ecdsa_mutex);
 	if (res == SS_SUCCESS) {
 		/* build public key */
 		*publKeyIn_ptr = (uint8_t)CRYS_EC_PointUncompressed;
@@ -266,6 +245,38 @@ SSError_t ss_ecc_verify_pka(struct ecc_public_key *key, const uint8_t *msg,
 		PROV_DMSG("Result: res=0x%08x\n", res);
 	}
 
+	ss_free((void *)publKeyX_ptr);
+	ss_free((void *)publKeyY_ptr);
+	ss_free((void *)publKeyIn_ptr);
+
+	return res;
+}
+
+/*
+ * brief:	Verify a signature with a built PKA public key. The caller
+ *		holds the SS_ASYMM_UNIT_PKA unit.
+ *
+ * param[in]	*pUserPublKey	- Pointer to the PKA public key.
+ * param[in]	*msg		- Pointer to the message data buffer.
+ * param[in]	msg_len		- Size of message data buffer.
+ * param[in]	*sig		- Pointer to the signature data buffer.
+ * param[in]	sig_len		- Size of signature data buffer.
+ * return	SSError_t	- SS provider error code.
+ */
+static SSError_t pka_verify_message(CRYS_ECPKI_UserPublKey_t *pUserPublKey,
+		const uint8_t *msg, size_t msg_len, const uint8_t *sig,
+		size_t sig_len)
+{
+	SSError_t res;
+	SA_PkadrvlibRetCode_t pka_res;
+	CRYS_ECPKI_HASH_OpMode_t eccHash;
+	uint8_t *pSignatureIn = (uint8_t *)sig;
+	uint32_t signatureSizeBytes = (uint32_t)sig_len;
+	uint8_t *pMessageDataIn = (uint8_t *)msg;
+	uint32_t messageSizeInBytes = (uint32_t)msg_len;
+
+	res = pka_get_ecc_digest(messageSizeInBytes, &eccHash);
+
 	if (res == SS_SUCCESS) {
 		PROV_DMSG("CALL:  SA_PKADRV_EcdsaVerifyMessage()\n");
 		PROV_DMSG("pUserPublKey=%p eccHash=%d\n",
@@ -281,11 +292,43 @@ SSError_t ss_ecc_verify_pka(struct ecc_public_key *key, const uint8_t *msg,
 		res = pka_translate_error_pka2ss_ecc(pka_res);
 		PROV_DMSG("Result: res=0x%08x\n", res);
 	}
-	rcar_nex_mutex_unlock(&pka_ecdsa_mutex);
 
-	ss_free((void *)publKeyX_ptr);
-	ss_free((void *)publKeyY_ptr);
-	ss_free((void *)publKeyIn_ptr);
+	return res;
+}
+
+/*
+ * brief:	Verify by the ECC using CRYS API (FIPS 186-4 ANSI X9.62)
+ *
+ * param[in]	*key		- Pointer to the struct of the ECC key pair.
+ * param[in]	*msg		- Pointer to the message data buffer.
+ * param[in]	msg_len		- Size of message data buffer.
+ * param[in]	*sig		- Pointer to the signature data buffer.
+ * param[in]	*sig_len	- Size of signature data buffer.
+ * return	SSError_t	- SS provider error code.
+ */
+SSError_t ss_ecc_verify_pka(struct ecc_public_key *key, const uint8_t *msg,
+		size_t msg_len, const uint8_t *sig, size_t sig_len)
+{
+	SSError_t res = SS_SUCCESS;
+	CRYS_ECPKI_UserPublKey_t *pUserPublKey = NULL;
+
+	PROV_INMSG("*key=%p, *msg=%p, msg_len=%ld\n", (void * )key, msg,
+			msg_len);
+	PROV_INMSG("*sig=%p, sig_len=%ld\n", sig, sig_len);
+
+	pUserPublKey = (CRYS_ECPKI_UserPublKey_t *)ss_malloc(
+			sizeof(CRYS_ECPKI_UserPublKey_t), &res);
+
+	ss_asymm_acquire(SS_ASYMM_UNIT_PKA);
+	if (res == SS_SUCCESS) {
+		res = pka_build_publ_key(key, pUserPublKey);
+	}
+	if (res == SS_SUCCESS) {
+		res = pka_verify_message(pUserPublKey, msg, msg_len, sig,
+				sig_len);
+	}
+	ss_asymm_release(SS_ASYMM_UNIT_PKA);
+
 	ss_free((void *)pUserPublKey);
 
 	OUTMSG("END do_ecc_verify_pka res=0x%08x\n", res);
@@ -293,6 +336,77 @@ SSError_t ss_ecc_verify_pka(struct ecc_public_key *key, const uint8_t *msg,
 	return res;
 }
 
+/*
+ * brief:	Verify several signatures by the ECC using the PKA, holding
+ *		the PKA for up to PKA_VERIFY_BATCH_HOLD items at a time. The
+ *		public key is built again only when the key of an item
+ *		differs from the key of the previous item.
+ *
+ * param[in]	*items		- Signatures to verify. The res of an item
+ *				  is set to its TEE internal API result,
+ *				  TEE_ERROR_NOT_SUPPORTED if the PKA does not
+ *				  support its curve and digest size.
+ * param[in]	num		- Number of items.
+ */
+void ss_ecc_verify_pka_batch(struct crypto_ecc_verify_item *items,
+		size_t num)
+{
+	SSError_t res = SS_SUCCESS;
+	SSError_t keyRes = SS_SUCCESS;
+	CRYS_ECPKI_UserPublKey_t *pUserPublKey = NULL;
+	struct ecc_public_key *builtKey = NULL;
+	uint32_t held = 0U;
+	size_t i;
+
+	PROV_INMSG("*items=%p, num=%ld\n", (void *)items, num);
+
+	pUserPublKey = (CRYS_ECPKI_UserPublKey_t *)ss_malloc(
+			sizeof(CRYS_ECPKI_UserPublKey_t), &res);
+
+	for (i = 0U; i < num; i++) {
+		if ((items[i].key == NULL) ||
+				(crypto_hw_acipher_ecc_check_support(
+				items[i].key->curve, items[i].msg_len) !=
+				SS_HW_SUPPORT_ALG)) {
+			/* Left to the software provider */
+			items[i].res = TEE_ERROR_NOT_SUPPORTED;
+		} else if (res != SS_SUCCESS) {
+			items[i].res = ss_translate_error_ss2tee(res);
+		} else {
+			if (held == PKA_VERIFY_BATCH_HOLD) {
+				/* Let the other waiters of the PKA in */
+				ss_asymm_release(SS_ASYMM_UNIT_PKA);
+				held = 0U;
+			}
+			if (held == 0U) {
+				ss_asymm_acquire(SS_ASYMM_UNIT_PKA);
+			}
+			held++;
+			if ((builtKey == NULL) || (builtKey != items[i].key)) {
+				keyRes = pka_build_publ_key(items[i].key,
+						pUserPublKey);
+				builtKey = items[i].key;
+			}
+			if (keyRes == SS_SUCCESS) {
+				items[i].res = ss_translate_error_ss2tee(
+						pka_verify_message(pUserPublKey,
+						items[i].msg, items[i].msg_len,
+						items[i].sig, items[i].sig_len));
+			} else {
+				items[i].res = ss_translate_error_ss2tee(
+						keyRes);
+			}
+		}
+	}
+	if (held != 0U) {
+		ss_asymm_release(SS_ASYMM_UNIT_PKA);
+	}
+
+	ss_free((void *)pUserPublKey);
+
+	PROV_OUTMSG("END ss_ecc_verify_pka_batch\n");
+}
+
 /*
  * brief:	Initialize the Crypto Engine PKA.
  *
@@ -14,6 +14,8 @@
 SSError_t ss_ecc_verify_pka(struct ecc_public_key *key,
 		const uint8_t *msg, size_t msg_len, const uint8_t *sig,
 		size_t sig_len);
+void ss_ecc_verify_pka_batch(struct crypto_ecc_verify_item *items,
+		size_t num);
 
 TEE_Result pka_verify_init(void);
 
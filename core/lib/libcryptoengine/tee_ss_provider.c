@@ -3,9 +3,16 @@
  * Copyright (c) 2015-2021, Renesas Electronics Corporation
  */
 
+#include <arm.h>
+#include <atomic.h>
 #include <initcall.h>
 #include <platform_config.h>
+#include <kernel/misc.h>
+#include <kernel/mutex.h>
 #include <kernel/panic.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+#include <optee_rpc_cmd.h>
 #include <rcar_suspend_to_ram.h>
 #include <crypto/crypto.h>
 #include <crypto/crypto_impl.h>
@@ -28,6 +35,7 @@
 #include "include_secure/crys_aes_unwrap_rcar.h"
 #include "include_secure/crys_suspend_to_ram.h"
 #include "include_secure/secure_key_gen.h"
+#include "tee_asymm_sched.h"
 #include "rcar_mutex.h"
 #include "rcar_common.h"
 
@@ -37,6 +45,9 @@
 #include "tee_pka_provider.h"
 #endif
 
+/* AES-CTR keystream produced ahead by one engine call (8 blocks) */
+#define SS_CTR_STREAM_SIZE	(8U*16U)
+
 typedef struct {
     struct crypto_authenc_ctx sw_ctx;
 	CRYS_AESCCM_UserContext_t crys_ctx;
@@ -55,6 +66,9 @@ typedef struct {
 	uint32_t restBufSize;
 	uint32_t blockSize;
 	TEE_OperationMode mode;
+	uint8_t ctrStream[SS_CTR_STREAM_SIZE];
+	uint32_t ctrStreamPos;
+	uint32_t ctrStreamSize;
 } SS_AES_Context_t;
 
 typedef struct {
@@ -84,6 +98,7 @@ typedef struct {
 	uint32_t restBufSize;
 	uint32_t blockSize;
 	uint32_t algo;
+	struct crypto_hw_dispatch dispatch;
 } SS_HASH_Context_t;
 
 typedef struct {
@@ -101,6 +116,7 @@ typedef struct {
         SS_AES_Context_t aes_ctx;
         SS_DES_Context_t des_ctx;
     } u;
+    struct crypto_hw_dispatch dispatch;
 } SS_Cipher_Context_t;
 
 typedef struct {
@@ -109,6 +125,7 @@ typedef struct {
         SS_HMAC_Context_t hmac_ctx;
         SS_AES_Context2_t aes_ctx;
     } u;
+    struct crypto_hw_dispatch dispatch;
 } SS_MAC_Context_t;
 
 typedef enum {
@@ -123,6 +140,103 @@ typedef enum {
 #define MAX_DATAIN_CCM_SIZE (512U*1024U)
 #define MAX_RSA_KEY_SIZE (512U)
 
+/* Scattered fragments from this size are updated without staging copy */
+#define SS_SG_DIRECT_SIZE	(512U)
+/* Staging buffer of the small scattered fragments */
+#define SS_SG_STAGE_SIZE	(4U*1024U)
+/* Bytes of a last scattered block finished by ss_aes_update (AES CTS) */
+#define SS_SG_TAIL_SIZE		(2U*16U)
+
+/* Kinds of built RSA keys in the converted key cache */
+#define SS_RSA_KEY_PUB		0U
+#define SS_RSA_KEY_PRIV		1U
+#define SS_RSA_KEY_PRIV_CRT	2U
+/* Number of built RSA keys kept in the converted key cache */
+#define SS_RSA_KEY_CACHE_NUM	8U
+/* Maximum number of key components passed to a build */
+#define SS_RSA_KEY_COMP_NUM	5U
+
+typedef struct {
+	const void *owner;	/* key object the entry was built from */
+	uint32_t gen;		/* generation of the key object, 0 if none */
+	uint32_t type;		/* SS_RSA_KEY_PUB, _PRIV or _PRIV_CRT */
+	uint32_t stamp;		/* last use, to select the entry to replace */
+	void *crysKey;		/* CRYS_RSAUserPubKey_t/CRYS_RSAUserPrivKey_t */
+	size_t crysKeySize;
+} SS_RSA_KeyCache_t;
+
+/*
+ * Job queue of the symmetric operations of the Secure IP engine. A job
+ * takes a ticket when it is submitted and runs on the engine when the head
+ * of the queue reaches its ticket. The waiting jobs sleep on the condition
+ * variable, or poll the queue with CFG_VIRTUALIZATION as the job at the
+ * head may run in another guest.
+ */
+typedef struct {
+	struct mutex mutex;	/* protects the fields below */
+	struct condvar cv;	/* waiting jobs, without virtualization only */
+	uint32_t tail;		/* ticket of the next submitted job */
+	uint32_t head;		/* ticket of the job owning the engine */
+	uint32_t maxDepth;	/* most jobs queued at once */
+	uint32_t jobs;		/* jobs run on the engine */
+	uint64_t depthSum;	/* queued jobs summed over the jobs run */
+	uint64_t bytes;		/* bytes processed by the jobs */
+	uint64_t busyTicks;	/* counter ticks the engine ran jobs */
+	uint64_t waitTicks;	/* counter ticks jobs waited for the engine */
+	uint64_t resetTicks;	/* counter value at the last reset */
+} SS_JobQueue_t;
+
+#if defined(CFG_CRYPTO_HW_RNG_POOL)
+/* Random bytes kept per CPU core to serve the small requests */
+#define SS_RNG_POOL_SIZE	(256U)
+/* Largest request served from the pool */
+#define SS_RNG_POOL_REQ_MAX	(64U)
+/* Level below which the pool is refilled */
+#define SS_RNG_POOL_LOW		(64U)
+
+/*
+ * Random bytes of a CPU core. The bytes are taken from the end of the pool
+ * and wiped once taken. A request taking the pool below SS_RNG_POOL_LOW
+ * refills it after its own bytes are served.
+ */
+typedef struct {
+	unsigned int lock;	/* protects the fields below */
+	uint32_t avail;		/* random bytes in buf */
+	uint32_t flushes;	/* times the pool was flushed by a reseed */
+	bool refilling;		/* a refill of the pool is in progress */
+	uint8_t buf[SS_RNG_POOL_SIZE];
+} SS_RNG_Pool_t;
+
+typedef struct {
+	uint32_t core;		/* pool to refill */
+	uint32_t flushes;	/* flushes of the pool when the refill started */
+	uint32_t size;		/* bytes to refill, 0 for none */
+} SS_RNG_Refill_t;
+#endif
+
+#if defined(CFG_CRYPTO_HW_CTX_SLAB)
+/* Index bits of the free stack head of a context slab */
+#define SS_CTX_SLAB_INDEX	(0xFFFFU)
+
+/*
+ * Slab of contexts of one type. The free contexts form a stack linked by
+ * index. The head holds the index of the top context plus one (0 if the
+ * slab is empty) in its low 16 bits, and a tag changed by every update in
+ * its high 16 bits, so that a pop racing with a pop and push of the same
+ * context fails its compare-and-swap. Contexts are zeroed when freed.
+ */
+typedef struct {
+	uint8_t *mem;		/* contexts of the slab */
+	uint32_t size;		/* byte size of a context */
+	uint32_t head;		/* free stack top and update tag */
+	uint16_t next[CFG_CRYPTO_HW_CTX_SLAB_NUM];	/* free stack links */
+	uint32_t inUse;		/* contexts allocated, slab and heap */
+	uint32_t maxInUse;	/* most contexts allocated at once */
+	uint32_t allocs;	/* contexts allocated */
+	uint32_t heapAllocs;	/* contexts allocated from the heap */
+} SS_CtxSlab_t;
+#endif
+
 #define CONV_HASHMODE_TO_OAEP(hashMode) \
 do { \
 	switch (hashMode) { \
@@ -259,6 +373,11 @@ static SSError_t ss_build_pub_key(CRYS_RSAUserPubKey_t **userPubKey,
 		struct rsa_public_key *key);
 static SSError_t ss_build_priv_key(CRYS_RSAUserPrivKey_t **userPrivKey,
 		struct rsa_keypair *key);
+static void *ss_rsa_key_cache_lookup(const void *owner, uint32_t gen,
+		uint32_t type);
+static void ss_rsa_key_cache_insert(const void *owner, uint32_t gen,
+		uint32_t type, void *crysKey, size_t crysKeySize);
+static void ss_rsa_key_cache_evict(SS_RSA_KeyCache_t *entry);
 static SSError_t ss_aes_init(void *ctx, uint32_t algo, TEE_OperationMode mode,
 		const uint8_t *key1, size_t key1_len, const uint8_t *iv,
 		size_t iv_len);
@@ -303,6 +422,27 @@ static SSError_t ss_ecc_verify_secure(struct ecc_public_key *key,
 
 static SSError_t ss_buffer_update(void *ctx, uint32_t algo,
 		const uint8_t *srcData, uint32_t srcLen, uint8_t **dstData);
+static void ss_ctr_xor(uint8_t *dst, const uint8_t *src, const uint8_t *key,
+		uint32_t len);
+static SSError_t ss_ctr_update(SS_AES_Context_t *aesCtx,
+		const uint8_t *srcData, uint32_t srcLen, uint8_t **dstData);
+static SSError_t ss_sg_total(const struct crypto_sg *sg, size_t num,
+		size_t *total);
+static void ss_sg_copy(const struct crypto_sg *sg, size_t num, size_t offset,
+		size_t len, uint8_t *dst);
+static SSError_t ss_sg_update(void *ctx, uint32_t algo,
+		const struct crypto_sg *sg, size_t num, size_t len,
+		uint8_t **dstData);
+#if defined(CFG_CRYPTO_HW_QUEUE)
+static uint32_t ss_job_enter(uint32_t *depth);
+static void ss_job_leave(uint32_t ticket, uint64_t submitted,
+		uint64_t start, uint32_t depth, uint32_t dataInSize);
+static uint64_t ss_job_ticks_to_us(uint64_t ticks);
+#endif
+static SSError_t ss_job_run(CRYSError_t (*update)(void *ctx,
+		uint8_t *dataIn_ptr, uint32_t dataInSize, uint8_t *dataOut_ptr,
+		CRYSError_t *crysRes), void *ctx, uint8_t *dataIn_ptr,
+		uint32_t dataInSize, uint8_t *dataOut_ptr, CRYSError_t *crysRes);
 
 static SSError_t ss_crys_aes_update(void *ctx, uint8_t *dataIn_ptr,
 		uint32_t dataInSize, uint8_t *dataOut_ptr, CRYSError_t *crysRes);
@@ -314,10 +454,56 @@ static SSError_t ss_crys_hmac_update(void *ctx, uint8_t *dataIn_ptr,
 		uint32_t dataInSize, uint8_t *dataOut_ptr, CRYSError_t *crysRes);
 static SSError_t ss_crys_aesccm_update(void *ctx, uint8_t *dataIn_ptr,
 		uint32_t dataInSize, uint8_t *dataOut_ptr, CRYSError_t *crysRes);
+static void *ss_ctx_alloc(uint32_t type, SSError_t *err);
+static void ss_ctx_free(uint32_t type, void *ctx);
+#if defined(CFG_CRYPTO_HW_CTX_SLAB)
+static void ss_ctx_slab_init(void);
+#endif
+static SSError_t ss_rng_generate(uint8_t *outPtr, size_t outSize);
+#if defined(CFG_CRYPTO_HW_RNG_POOL)
+static bool ss_rng_pool_take(uint8_t *outPtr, size_t outSize,
+		SS_RNG_Refill_t *refill);
+static void ss_rng_pool_refill(const SS_RNG_Refill_t *refill);
+static void ss_rng_pool_flush(void);
+#endif
 static void ss_backup_cb(enum suspend_to_ram_state state, uint32_t cpu_id);
 static TEE_Result crypto_hw_init_crypto_engine(void);
 
-static struct mutex secure_asymm_mutex __nex_data = MUTEX_INITIALIZER;
+#if defined(CFG_CRYPTO_RSA)
+/* Converted key cache, protected by the SS_ASYMM_UNIT_CC unit */
+static SS_RSA_KeyCache_t ss_rsa_key_cache[SS_RSA_KEY_CACHE_NUM] __nex_bss;
+static uint32_t ss_rsa_key_cache_stamp __nex_bss;
+static uint32_t ss_rsa_key_cache_gen __nex_bss;
+#endif
+#if defined(CFG_CRYPTO_HW_QUEUE)
+static SS_JobQueue_t ss_job_queue __nex_data = {
+	.mutex = MUTEX_INITIALIZER,
+	.cv = CONDVAR_INITIALIZER,
+};
+#endif
+#if defined(CFG_CRYPTO_HW_RNG_POOL)
+static SS_RNG_Pool_t ss_rng_pools[CFG_TEE_CORE_NB_CORE] __nex_bss;
+#endif
+#if defined(CFG_CRYPTO_HW_CTX_SLAB)
+static SS_HASH_Context_t ss_hash_slab[CFG_CRYPTO_HW_CTX_SLAB_NUM] __nex_bss;
+static SS_Cipher_Context_t ss_cipher_slab[CFG_CRYPTO_HW_CTX_SLAB_NUM]
+		__nex_bss;
+static SS_MAC_Context_t ss_mac_slab[CFG_CRYPTO_HW_CTX_SLAB_NUM] __nex_bss;
+static SS_CtxSlab_t ss_ctx_slabs[CRYPTO_HW_CTX_TYPES] __nex_data = {
+	[CRYPTO_HW_CTX_HASH] = {
+		.mem = (uint8_t *)ss_hash_slab,
+		.size = (uint32_t)sizeof(SS_HASH_Context_t),
+	},
+	[CRYPTO_HW_CTX_CIPHER] = {
+		.mem = (uint8_t *)ss_cipher_slab,
+		.size = (uint32_t)sizeof(SS_Cipher_Context_t),
+	},
+	[CRYPTO_HW_CTX_MAC] = {
+		.mem = (uint8_t *)ss_mac_slab,
+		.size = (uint32_t)sizeof(SS_MAC_Context_t),
+	},
+};
+#endif
 
 static SSError_t ss_crys_aes_update(void *ctx, uint8_t *dataIn_ptr,
 		uint32_t dataInSize, uint8_t *dataOut_ptr, CRYSError_t *crysRes)
@@ -854,13 +1040,417 @@ static SSError_t ss_translate_error_crys2ss_util(DxUTILError_t err)
 	return res;
 }
 
+#if defined(CFG_CRYPTO_HW_QUEUE)
+/*
+ * brief:	Submit a job to the queue of the Secure IP engine and wait
+ *		until the engine is free for it. Jobs get the engine in
+ *		submission order.
+ *
+ * param[out]	*depth		- Jobs queued when the job got the engine.
+ * return	uint32_t	- Ticket of the job.
+ */
+static uint32_t ss_job_enter(uint32_t *depth)
+{
+	uint32_t ticket;
+#ifdef CFG_VIRTUALIZATION
+	TEE_Result res;
+	struct thread_param params = THREAD_PARAM_VALUE(IN,
+					CFG_RCAR_MUTEX_DELAY, 0, 0);
+#endif
+
+	rcar_nex_mutex_lock(&ss_job_queue.mutex);
+	ticket = ss_job_queue.tail;
+	ss_job_queue.tail++;
+	while (ss_job_queue.head != ticket) {
+#ifdef CFG_VIRTUALIZATION
+		rcar_nex_mutex_unlock(&ss_job_queue.mutex);
+		res = thread_rpc_cmd(OPTEE_RPC_CMD_SUSPEND, 1, &params);
+		if (res != TEE_SUCCESS) {
+			panic("ss_job_enter failed");
+		}
+		rcar_nex_mutex_lock(&ss_job_queue.mutex);
+#else
+		condvar_wait(&ss_job_queue.cv, &ss_job_queue.mutex);
+#endif
+	}
+	*depth = ss_job_queue.tail - ticket;
+	rcar_nex_mutex_unlock(&ss_job_queue.mutex);
+	return ticket;
+}
+
+/*
+ * brief:	Complete the job at the head of the queue, account it and
+ *		wake the waiting jobs.
+ *
+ * param[in]	ticket		- Ticket of the completed job.
+ * param[in]	submitted	- Counter value when the job was submitted.
+ * param[in]	start		- Counter value when the job got the engine.
+ * param[in]	depth		- Jobs queued when the job got the engine.
+ * param[in]	dataInSize	- Bytes processed by the job.
+ */
+static void ss_job_leave(uint32_t ticket, uint64_t submitted,
+		uint64_t start, uint32_t depth, uint32_t dataInSize)
+{
+	uint64_t end = barrier_read_cntpct();
+
+	rcar_nex_mutex_lock(&ss_job_queue.mutex);
+	ss_job_queue.head = ticket + 1U;
+	ss_job_queue.busyTicks += end - start;
+	ss_job_queue.waitTicks += start - submitted;
+	ss_job_queue.bytes += (uint64_t)dataInSize;
+	ss_job_queue.depthSum += (uint64_t)depth;
+	ss_job_queue.jobs++;
+	if (depth > ss_job_queue.maxDepth) {
+		ss_job_queue.maxDepth = depth;
+	}
+#ifndef CFG_VIRTUALIZATION
+	condvar_broadcast(&ss_job_queue.cv);
+#endif
+	rcar_nex_mutex_unlock(&ss_job_queue.mutex);
+}
+
+/*
+ * brief:	Convert counter ticks to microseconds.
+ *
+ * param[in]	ticks		- Counter ticks.
+ * return	uint64_t	- Microseconds.
+ */
+static uint64_t ss_job_ticks_to_us(uint64_t ticks)
+{
+	uint64_t freq = (uint64_t)read_cntfrq();
+
+	return ((ticks / freq) * 1000000U) +
+		(((ticks % freq) * 1000000U) / freq);
+}
+
+/*
+ * brief:	Run an update of the CRYS API as a job of the Secure IP engine
+ *		queue. The caller waits for its own job only and the engine
+ *		is handed to the next job as soon as the update returns.
+ *
+ * param[in]	update		- Update function of the CRYS algorithm.
+ * param[in]	*ctx		- Context of the CRYS algorithm.
+ * param[in]	*dataIn_ptr	- Pointer to input data buffer.
+ * param[in]	dataInSize	- Size of input data buffer.
+ * param[out]	*dataOut_ptr	- Pointer to output data buffer.
+ * param[out]	*crysRes	- CRYS error code.
+ * return	SSError_t	- SS provider error code.
+ */
+static SSError_t ss_job_run(CRYSError_t (*update)(void *ctx,
+		uint8_t *dataIn_ptr, uint32_t dataInSize, uint8_t *dataOut_ptr,
+		CRYSError_t *crysRes), void *ctx, uint8_t *dataIn_ptr,
+		uint32_t dataInSize, uint8_t *dataOut_ptr, CRYSError_t *crysRes)
+{
+	SSError_t res;
+	uint64_t submitted;
+	uint64_t start;
+	uint32_t ticket;
+	uint32_t depth;
+
+	submitted = barrier_read_cntpct();
+	ticket = ss_job_enter(&depth);
+	start = barrier_read_cntpct();
+
+	res = update(ctx, dataIn_ptr, dataInSize, dataOut_ptr, crysRes);
+
+	ss_job_leave(ticket, submitted, start, depth, dataInSize);
+	return res;
+}
+
+/*
+ * brief:	Get the counters of the Secure IP engine job queue.
+ *
+ * param[out]	*stats		- Counters of the job queue.
+ * param[in]	reset		- Restart the counters after reading them.
+ */
+void crypto_hw_queue_get_stats(struct crypto_hw_queue_stats *stats,
+		bool reset)
+{
+	uint64_t now;
+
+	/* The counters are read without waiting for the running job */
+	rcar_nex_mutex_lock(&ss_job_queue.mutex);
+	now = barrier_read_cntpct();
+
+	stats->depth = ss_job_queue.tail - ss_job_queue.head;
+	if (stats->depth != 0U) {
+		/* Not counting the job running on the engine */
+		stats->depth--;
+	}
+	stats->max_depth = ss_job_queue.maxDepth;
+	stats->jobs = ss_job_queue.jobs;
+	stats->depth_sum = ss_job_queue.depthSum;
+	stats->bytes = ss_job_queue.bytes;
+	stats->busy_us = ss_job_ticks_to_us(ss_job_queue.busyTicks);
+	stats->wait_us = ss_job_ticks_to_us(ss_job_queue.waitTicks);
+	stats->elapsed_us = ss_job_ticks_to_us(now - ss_job_queue.resetTicks);
+	if (reset) {
+		ss_job_queue.maxDepth = 0U;
+		ss_job_queue.jobs = 0U;
+		ss_job_queue.depthSum = 0U;
+		ss_job_queue.bytes = 0U;
+		ss_job_queue.busyTicks = 0U;
+		ss_job_queue.waitTicks = 0U;
+		ss_job_queue.resetTicks = now;
+	}
+	rcar_nex_mutex_unlock(&ss_job_queue.mutex);
+}
+#else
+static SSError_t ss_job_run(CRYSError_t (*update)(void *ctx,
+		uint8_t *dataIn_ptr, uint32_t dataInSize, uint8_t *dataOut_ptr,
+		CRYSError_t *crysRes), void *ctx, uint8_t *dataIn_ptr,
+		uint32_t dataInSize, uint8_t *dataOut_ptr, CRYSError_t *crysRes)
+{
+	return update(ctx, dataIn_ptr, dataInSize, dataOut_ptr, crysRes);
+}
+#endif
+
+#if defined(CFG_CRYPTO_HW_CTX_SLAB)
+/*
+ * brief:	Push all the contexts of the slabs on their free stacks. The
+ *		contexts allocated before are heap contexts, so the slabs can
+ *		be initialized while they are in use.
+ */
+static void ss_ctx_slab_init(void)
+{
+	SS_CtxSlab_t *slab;
+	uint32_t type;
+	uint32_t i;
+
+	for (type = 0U; type < CRYPTO_HW_CTX_TYPES; type++) {
+		slab = &ss_ctx_slabs[type];
+		for (i = 0U; i < (uint32_t)CFG_CRYPTO_HW_CTX_SLAB_NUM; i++) {
+			slab->next[i] = (uint16_t)i;
+		}
+		dsb_ish();
+		atomic_store_u32(&slab->head,
+				(uint32_t)CFG_CRYPTO_HW_CTX_SLAB_NUM);
+	}
+}
+
+/*
+ * brief:	Allocate a zeroed context, from the slab of its type if the
+ *		slab has a free context, from the heap otherwise.
+ *
+ * param[in]	type		- Context type (CRYPTO_HW_CTX_xxx).
+ * param[out]	*err		- SS provider error code.
+ * return	void *		- Pointer to the context, NULL on error.
+ */
+static void *ss_ctx_alloc(uint32_t type, SSError_t *err)
+{
+	SS_CtxSlab_t *slab = &ss_ctx_slabs[type];
+	void *ctx = NULL;
+	uint32_t head;
+	uint32_t top;
+	uint32_t newHead;
+	uint32_t inUse;
+	uint32_t maxInUse;
+
+	head = atomic_load_u32(&slab->head);
+	do {
+		top = head & SS_CTX_SLAB_INDEX;
+		if (top == 0U) {
+			break;
+		}
+		newHead = ((head + SS_CTX_SLAB_INDEX + 1U) &
+				~SS_CTX_SLAB_INDEX) |
+				(uint32_t)slab->next[top - 1U];
+	} while (!atomic_cas_u32(&slab->head, &head, newHead));
+
+	if (top != 0U) {
+		ctx = &slab->mem[(top - 1U) * slab->size];
+		*err = SS_SUCCESS;
+	} else {
+		ctx = ss_calloc(1U, (size_t)slab->size, err);
+		if (*err == SS_SUCCESS) {
+			(void)atomic_inc32(&slab->heapAllocs);
+		}
+	}
+
+	if (*err == SS_SUCCESS) {
+		(void)atomic_inc32(&slab->allocs);
+		inUse = atomic_inc32(&slab->inUse);
+		maxInUse = atomic_load_u32(&slab->maxInUse);
+		while ((maxInUse < inUse) &&
+			(!atomic_cas_u32(&slab->maxInUse, &maxInUse, inUse))) {
+		}
+	}
+	return ctx;
+}
+
+/*
+ * brief:	Wipe a context and return it to the slab of its type, or to
+ *		the heap if it was allocated from the heap.
+ *
+ * param[in]	type		- Context type (CRYPTO_HW_CTX_xxx).
+ * param[in]	*ctx		- Pointer to the context.
+ */
+static void ss_ctx_free(uint32_t type, void *ctx)
+{
+	SS_CtxSlab_t *slab = &ss_ctx_slabs[type];
+	uintptr_t offset;
+	uint32_t index;
+	uint32_t head;
+	uint32_t newHead;
+
+	if (ctx != NULL) {
+		memzero_explicit(ctx, (size_t)slab->size);
+		offset = (uintptr_t)ctx - (uintptr_t)slab->mem;
+		if (offset < ((uintptr_t)slab->size *
+				(uintptr_t)CFG_CRYPTO_HW_CTX_SLAB_NUM)) {
+			index = (uint32_t)(offset / slab->size);
+			head = atomic_load_u32(&slab->head);
+			do {
+				slab->next[index] =
+					(uint16_t)(head & SS_CTX_SLAB_INDEX);
+				/* Publish the wiped context and its link */
+				dsb_ish();
+				newHead = ((head + SS_CTX_SLAB_INDEX + 1U) &
+						~SS_CTX_SLAB_INDEX) |
+						(index + 1U);
+			} while (!atomic_cas_u32(&slab->head, &head,
+					newHead));
+		} else {
+			ss_free(ctx);
+		}
+		(void)atomic_dec32(&slab->inUse);
+	}
+}
+
+/*
+ * brief:	Get the usage of the context slabs.
+ *
+ * param[out]	*stats		- CRYPTO_HW_CTX_TYPES entries, indexed by
+ *				  CRYPTO_HW_CTX_xxx.
+ * param[in]	reset		- Restart the counters after reading them.
+ */
+void crypto_hw_ctx_slab_get_stats(struct crypto_hw_ctx_slab_stats *stats,
+		bool reset)
+{
+	SS_CtxSlab_t *slab;
+	uint32_t type;
+
+	for (type = 0U; type < CRYPTO_HW_CTX_TYPES; type++) {
+		slab = &ss_ctx_slabs[type];
+		stats[type].ctx_size = slab->size;
+		stats[type].num = (uint32_t)CFG_CRYPTO_HW_CTX_SLAB_NUM;
+		stats[type].in_use = atomic_load_u32(&slab->inUse);
+		stats[type].max_in_use = atomic_load_u32(&slab->maxInUse);
+		stats[type].allocs = atomic_load_u32(&slab->allocs);
+		stats[type].heap_allocs = atomic_load_u32(&slab->heapAllocs);
+		if (reset) {
+			atomic_store_u32(&slab->maxInUse, stats[type].in_use);
+			atomic_store_u32(&slab->allocs, 0U);
+			atomic_store_u32(&slab->heapAllocs, 0U);
+		}
+	}
+}
+#else
+static void *ss_ctx_alloc(uint32_t type, SSError_t *err)
+{
+	static const size_t ctxSize[CRYPTO_HW_CTX_TYPES] = {
+		[CRYPTO_HW_CTX_HASH] = sizeof(SS_HASH_Context_t),
+		[CRYPTO_HW_CTX_CIPHER] = sizeof(SS_Cipher_Context_t),
+		[CRYPTO_HW_CTX_MAC] = sizeof(SS_MAC_Context_t),
+	};
+
+	return ss_calloc(1U, ctxSize[type], err);
+}
+
+static void ss_ctx_free(uint32_t type __unused, void *ctx)
+{
+	ss_free(ctx);
+}
+#endif /* CFG_CRYPTO_HW_CTX_SLAB */
+
+/*
+ * brief:	XOR data with AES-CTR keystream a word at a time.
+ *
+ * param[out]	*dst		- Pointer to destination data buffer.
+ * param[in]	*src		- Pointer to source data buffer.
+ * param[in]	*key		- Pointer to the keystream.
+ * param[in]	len		- Data size.
+ */
+static void ss_ctr_xor(uint8_t *dst, const uint8_t *src, const uint8_t *key,
+		uint32_t len)
+{
+	uint64_t srcWord;
+	uint64_t keyWord;
+	uint32_t i = 0U;
+
+	/* memcpy() accesses are unaligned-safe, compiled as word loads */
+	for (; (i + sizeof(uint64_t)) <= len; i += sizeof(uint64_t)) {
+		(void)memcpy(&srcWord, src + i, sizeof(srcWord));
+		(void)memcpy(&keyWord, key + i, sizeof(keyWord));
+		srcWord ^= keyWord;
+		(void)memcpy(dst + i, &srcWord, sizeof(srcWord));
+	}
+	for (; i < len; i++) {
+		dst[i] = src[i] ^ key[i];
+	}
+}
+
+/*
+ * brief:	Block Data Update of AES-CTR. Short updates and the tails of
+ *		long ones are XORed with keystream produced ahead in the
+ *		context, SS_CTR_STREAM_SIZE bytes per engine call. The
+ *		engine processes the data directly only once the stored
+ *		keystream is used up, so the counter stays in sequence.
+ *
+ * param[in]	*aesCtx		- Pointer to the AES context.
+ * param[in]	*srcData	- Pointer to source data buffer.
+ * param[in]	srcLen		- Source data size.
+ * param[in/out] **dstData	- Pointer to destination data buffer, advanced
+ *				  by the output size.
+ * return	SSError_t	- Internal error code of this provider.
+ */
+static SSError_t ss_ctr_update(SS_AES_Context_t *aesCtx,
+		const uint8_t *srcData, uint32_t srcLen, uint8_t **dstData)
+{
+	SSError_t res = SS_SUCCESS;
+	uint32_t copySize;
+
+	while ((SS_SUCCESS == res) && (0U < srcLen)) {
+		if (aesCtx->ctrStreamPos < aesCtx->ctrStreamSize) {
+			copySize = MIN(srcLen, aesCtx->ctrStreamSize -
+					aesCtx->ctrStreamPos);
+			ss_ctr_xor(*dstData, srcData,
+					aesCtx->ctrStream + aesCtx->ctrStreamPos,
+					copySize);
+			aesCtx->ctrStreamPos += copySize;
+		} else if (SS_CTR_STREAM_SIZE <= srcLen) {
+			copySize = MIN(ROUNDDOWN(srcLen, aesCtx->blockSize),
+					MAX_DATAIN_SIZE);
+			res = ss_job_run(&ss_crys_aes_update, &aesCtx->crys_ctx,
+					(uint8_t *)srcData, copySize, *dstData,
+					&aesCtx->crys_error);
+		} else {
+			/* The keystream is the encryption of zero blocks */
+			copySize = 0U;
+			(void)memset(aesCtx->ctrStream, 0, SS_CTR_STREAM_SIZE);
+			res = ss_job_run(&ss_crys_aes_update, &aesCtx->crys_ctx,
+					aesCtx->ctrStream, SS_CTR_STREAM_SIZE,
+					aesCtx->ctrStream, &aesCtx->crys_error);
+			aesCtx->ctrStreamPos = 0U;
+			aesCtx->ctrStreamSize = SS_CTR_STREAM_SIZE;
+		}
+		if (SS_SUCCESS == res) {
+			srcData += copySize;
+			srcLen -= copySize;
+			*dstData += copySize;
+		}
+	}
+
+	return res;
+}
+
 static SSError_t ss_buffer_update(void *ctx, uint32_t algo,
 		const uint8_t *srcData, uint32_t srcLen, uint8_t **dstData)
 {
 	SSError_t res = SS_SUCCESS;
 	CRYSError_t *crysRes;
 	ss_crys_algo crysAlgo;
-	SS_AES_Context_t *aesCtx;
+	SS_AES_Context_t *aesCtx = NULL;
 	SS_AES_Context2_t *aesCtx2;
 	SS_DES_Context_t *desCtx;
 	SS_HASH_Context_t *hashCtx;
@@ -1028,47 +1618,12 @@ static SSError_t ss_buffer_update(void *ctx, uint32_t algo,
 		break;
 	}
 
+	if ((res == SS_SUCCESS) && (algo == TEE_ALG_AES_CTR)) {
+		res = ss_ctr_update(aesCtx, srcUpdateData, srcLen, dstData);
+		srcLen = 0U;
+	}
+
 	if (res == SS_SUCCESS) {
-		if ((algo == TEE_ALG_AES_CTR) && (*restBufferSize != 0U)) {
-			if (srcLen >= *restBufferSize) {
-				/* Encrypt/decrypt data from restBuffer first */
-				copySize = *restBufferSize;
-				for (; *restBufferSize > 0; (*restBufferSize)--) {
-					if (NULL != *dstData) {
-						**dstData = *srcUpdateData ^ *restBuffer;
-						restBuffer++;
-						(*dstData)++;
-						srcUpdateData++;
-					}
-				}
-				srcLen -= copySize;
-				restBuffer -= copySize;
-			} else {
-				/* When srcLen < *restBufferSize we use only
-				 * gamma from restBuffer */
-				copySize = srcLen;
-				for (; srcLen > 0; srcLen--) {
-					if (NULL != *dstData) {
-						**dstData = *srcUpdateData ^ *restBuffer;
-						restBuffer++;
-						(*dstData)++;
-						srcUpdateData++;
-					}
-				}
-				/* Then copy rest of restBuffer to start of
-				 * restBuffer (can't use memcpy because of
-				 * crossing risk) */
-				restBuffer -= copySize;
-				for (; srcLen < *restBufferSize - copySize; srcLen++) {
-					*restBuffer = *(restBuffer + copySize);
-					restBuffer++;
-				}
-				*restBufferSize -= copySize;
-				srcLen = 0;
-				PROV_DMSG("restBufferSize%d.\n", *restBufferSize);
-			}
-		}
-		/* Never will be true for TEE_ALG_AES_CTR after previous if */
 		if (((*restBufferSize + srcLen) >= updateBlockSize)
 				&& (*restBufferSize != 0U)) {
 			/* There is not yet input data in context. */
@@ -1080,8 +1635,9 @@ static SSError_t ss_buffer_update(void *ctx, uint32_t algo,
 					restBuffer);
 			PROV_DMSG("updateBlockSize=%d dstData=%p\n",
 					updateBlockSize, *dstData);
-			res = ss_update[crysAlgo](context, restBuffer,
-					updateBlockSize, *dstData, crysRes);
+			res = ss_job_run(ss_update[crysAlgo], context,
+					restBuffer, updateBlockSize, *dstData,
+					crysRes);
 			PROV_DMSG("Result : 0x%08x\n", res);
 			*restBufferSize = 0U;
 			srcUpdateData += copySize;
@@ -1102,8 +1658,9 @@ static SSError_t ss_buffer_update(void *ctx, uint32_t algo,
 					restBuffer);
 			PROV_DMSG("updateBlockSize=%d dstData=%p\n",
 					updateBlockSize, *dstData);
-			res = ss_update[crysAlgo](context, srcUpdateData,
-					copySize, *dstData, crysRes);
+			res = ss_job_run(ss_update[crysAlgo], context,
+					srcUpdateData, copySize, *dstData,
+					crysRes);
 			PROV_DMSG("Result : 0x%08x\n", res);
 			if (res != SS_SUCCESS) {
 				break;
@@ -1116,48 +1673,148 @@ static SSError_t ss_buffer_update(void *ctx, uint32_t algo,
 		}
 		/* Rest data exists ? */
 		if ((res == SS_SUCCESS) && (srcLen > 0U)) {
-			if (algo != TEE_ALG_AES_CTR) {
-				PROV_DMSG("%d byte data can't input to CRYS API.\n",
-						srcLen);
-				(void)memcpy((restBuffer + *restBufferSize),
-						srcUpdateData, srcLen);
-				*restBufferSize += srcLen;
-				PROV_DMSG("restBufferSize%d.\n", *restBufferSize);
+			PROV_DMSG("%d byte data can't input to CRYS API.\n",
+					srcLen);
+			(void)memcpy((restBuffer + *restBufferSize),
+					srcUpdateData, srcLen);
+			*restBufferSize += srcLen;
+			PROV_DMSG("restBufferSize%d.\n", *restBufferSize);
+		}
+	}
+
+	PROV_OUTMSG("Return : 0x%08x\n", res);
+	return res;
+}
+
+/*
+ * brief:	Get the total size of a scattered buffer.
+ *
+ * param[in]	*sg		- List of the data fragments.
+ * param[in]	num		- Number of fragments in the list.
+ * param[out]	*total		- Total size of the fragments.
+ * return	SSError_t	- Internal error code of this provider.
+ */
+static SSError_t ss_sg_total(const struct crypto_sg *sg, size_t num,
+		size_t *total)
+{
+	SSError_t res = SS_SUCCESS;
+	size_t i;
+
+	*total = 0U;
+	if ((NULL == sg) && (0U != num)) {
+		res = SS_ERROR_BAD_PARAMETERS;
+		PROV_EMSG("BAD_PARAMETERS(sg)\n");
+	}
+	for (i = 0U; (i < num) && (SS_SUCCESS == res); i++) {
+		if ((NULL == sg[i].data) && (0U != sg[i].len)) {
+			res = SS_ERROR_BAD_PARAMETERS;
+			PROV_EMSG("BAD_PARAMETERS(sg[%zu])\n", i);
+		} else if (ADD_OVERFLOW(*total, sg[i].len, total) ||
+				(*total > UINT32_MAX)) {
+			res = SS_ERROR_OVERFLOW;
+			PROV_EMSG("OVERFLOW(sg[%zu])\n", i);
+		} else {
+			/* Nothing */
+		}
+	}
+
+	return res;
+}
+
+/*
+ * brief:	Copy a range of a scattered buffer to a contiguous buffer.
+ *
+ * param[in]	*sg		- List of the data fragments.
+ * param[in]	num		- Number of fragments in the list.
+ * param[in]	offset		- Offset of the range in the scattered buffer.
+ * param[in]	len		- Size of the range.
+ * param[out]	*dst		- Pointer to destination data buffer.
+ */
+static void ss_sg_copy(const struct crypto_sg *sg, size_t num, size_t offset,
+		size_t len, uint8_t *dst)
+{
+	size_t i;
+	size_t copySize;
+
+	for (i = 0U; (i < num) && (0U < len); i++) {
+		if (offset >= sg[i].len) {
+			offset -= sg[i].len;
+		} else {
+			copySize = MIN(sg[i].len - offset, len);
+			(void)memcpy(dst, sg[i].data + offset, copySize);
+			dst += copySize;
+			len -= copySize;
+			offset = 0U;
+		}
+	}
+}
+
+/*
+ * brief:	Block Data Update from the start of a scattered buffer.
+ *		The fragments smaller than SS_SG_DIRECT_SIZE are gathered in
+ *		a staging buffer, so the engine is fed with large updates and
+ *		only one partial block is carried in the context for the
+ *		whole list.
+ *
+ * param[in]	*ctx		- Pointer to the algorithm context.
+ * param[in]	algo		- Cryptographic algorithm.
+ * param[in]	*sg		- List of the data fragments.
+ * param[in]	num		- Number of fragments in the list.
+ * param[in]	len		- Size of the data to update.
+ * param[in/out] **dstData	- Pointer to destination data buffer, advanced
+ *				  by the output size.
+ * return	SSError_t	- Internal error code of this provider.
+ */
+static SSError_t ss_sg_update(void *ctx, uint32_t algo,
+		const struct crypto_sg *sg, size_t num, size_t len,
+		uint8_t **dstData)
+{
+	SSError_t res = SS_SUCCESS;
+	uint8_t *stage = NULL;
+	uint32_t stageLen = 0U;
+	uint32_t copySize;
+	size_t i;
+
+	/* The caller checked that the list holds at most UINT32_MAX bytes */
+	for (i = 0U; (i < num) && (0U < len) && (SS_SUCCESS == res); i++) {
+		copySize = (uint32_t)MIN(sg[i].len, len);
+		if (SS_SG_DIRECT_SIZE <= copySize) {
+			if (0U < stageLen) {
+				res = ss_buffer_update(ctx, algo, stage,
+						stageLen, dstData);
+				stageLen = 0U;
+			}
+			if (SS_SUCCESS == res) {
+				res = ss_buffer_update(ctx, algo, sg[i].data,
+						copySize, dstData);
+			}
+		} else {
+			if (NULL == stage) {
+				stage = (uint8_t *)ss_malloc(SS_SG_STAGE_SIZE,
+						&res);
+			} else if (SS_SG_STAGE_SIZE < (stageLen + copySize)) {
+				res = ss_buffer_update(ctx, algo, stage,
+						stageLen, dstData);
+				stageLen = 0U;
 			} else {
-				/* Encrypt/decrypt rest data for CTR mode ? */
-				PROV_DMSG("%d src data byte data \n", srcLen);
-				(void)memset(restBuffer, 0, updateBlockSize);
-				(void)memcpy(restBuffer, srcUpdateData, srcLen);
-				PROV_DMSG("CALL CRYS Update [algo=%d]\n", crysAlgo);
-				PROV_DMSG("context=%p restBuffer=%p\n", context,
-						restBuffer);
-				PROV_DMSG("updateBlockSize=%d dstData=%p\n",
-						updateBlockSize, *dstData);
-				res = ss_update[crysAlgo](context, restBuffer,
-						updateBlockSize,
-						restBuffer + updateBlockSize,
-						crysRes);
-				PROV_DMSG("Result : 0x%08x\n", res);
-				/* Copy answer */
-				copySize = srcLen;
-				for (; copySize > 0; copySize--) {
-					**dstData = *(restBuffer + updateBlockSize);
-					restBuffer++;
-					(*dstData)++;
-				}
-				/* Copy rest gamma blocks */
-				restBuffer -= srcLen;
-				for (; *restBufferSize < (updateBlockSize - srcLen); (*restBufferSize)++) {
-					*restBuffer = *(restBuffer + updateBlockSize + srcLen);
-					restBuffer++;
-				}
-				memset(restBuffer, 0, srcLen + updateBlockSize);
-				PROV_DMSG("restBufferSize%d.\n", *restBufferSize);
+				/* Nothing */
+			}
+			if (SS_SUCCESS == res) {
+				(void)memcpy(stage + stageLen, sg[i].data,
+						(size_t)copySize);
+				stageLen += copySize;
 			}
 		}
+		len -= copySize;
+	}
+	if ((SS_SUCCESS == res) && (0U < stageLen)) {
+		res = ss_buffer_update(ctx, algo, stage, stageLen, dstData);
+	}
+	if (NULL != stage) {
+		memzero_explicit(stage, SS_SG_STAGE_SIZE);
+		ss_free(stage);
 	}
 
-	PROV_OUTMSG("Return : 0x%08x\n", res);
 	return res;
 }
 
@@ -1502,6 +2159,21 @@ void crypto_hw_hash_get_current_algo(void *ctx, uint32_t *algo)
     return;
 }
 
+/*
+ * brief:	Get the engine selection state of HASH algorithm.
+ *
+ * param[in]	*ctx	- Context to HASH algorithm.
+ * return	struct crypto_hw_dispatch * - Engine selection state.
+ */
+struct crypto_hw_dispatch *crypto_hw_hash_get_dispatch(void *ctx)
+{
+    SS_HASH_Context_t *hash_ctx = NULL;
+
+    hash_ctx = (SS_HASH_Context_t *)ctx;
+
+    return &hash_ctx->dispatch;
+}
+
 /*
  * brief:	Allocate a context for HASH algorithm.
  *
@@ -1515,8 +2187,7 @@ TEE_Result crypto_hw_hash_alloc_ctx(void **ctx, uint32_t algo)
     SSError_t ret = SS_SUCCESS;
     SS_HASH_Context_t *ss_ctx = NULL;
 
-    ss_ctx = (SS_HASH_Context_t *)ss_calloc(1U,
-            sizeof(SS_HASH_Context_t), &ret);
+    ss_ctx = (SS_HASH_Context_t *)ss_ctx_alloc(CRYPTO_HW_CTX_HASH, &ret);
     if (ret == SS_SUCCESS)
     {
         PROV_DMSG("algo = 0x%08x\n", algo);
@@ -1533,6 +2204,16 @@ TEE_Result crypto_hw_hash_alloc_ctx(void **ctx, uint32_t algo)
     return tee_ret;
 }
 
+/*
+ * brief:	Free a context for HASH algorithm.
+ *
+ * param[in]	ctx	    	- Pointer to the HASH context.
+ */
+void crypto_hw_hash_free_ctx(void *ctx)
+{
+    ss_ctx_free(CRYPTO_HW_CTX_HASH, ctx);
+}
+
 /*
  * brief:	Get context size to HASH algorithm.
  *
@@ -1700,6 +2381,42 @@ TEE_Result crypto_hw_hash_update(void *ctx, uint32_t algo, const uint8_t *data,
 	return tee_res;
 }
 
+/*
+ * brief:	Block Data Update state of HASH algorithm from a scattered
+ *		input buffer.
+ *
+ * param[in]	*ctx		- Context to HASH algorithm.
+ * param[in]	algo		- Cryptographic algorithm.
+ * param[in]	*sg		- List of the input data fragments.
+ * param[in]	num		- Number of fragments in the list.
+ * return	TEE_Result	- TEE internal API error code.
+ */
+TEE_Result crypto_hw_hash_update_sg(void *ctx, uint32_t algo,
+		const struct crypto_sg *sg, size_t num)
+{
+	TEE_Result tee_res;
+	SSError_t res = SS_SUCCESS;
+	SS_HASH_Context_t *ss_ctx;
+	uint8_t *nullBuf = NULL;
+	size_t total = 0U;
+
+	PROV_INMSG("*ctx=%p, algo=%d, *sg=%p, num=%zu\n", ctx, algo, sg, num);
+
+	CHECK_CONTEXT(res, ss_ctx, SS_HASH_Context_t, ctx);
+
+	if (SS_SUCCESS == res) {
+		res = ss_sg_total(sg, num, &total);
+	}
+
+	if (SS_SUCCESS == res) {
+		res = ss_sg_update(ctx, algo, sg, num, total, &nullBuf);
+	}
+
+	tee_res = ss_translate_error_ss2tee(res);
+	PROV_OUTMSG("return res=0x%08x -> tee_res=0x%08x\n",res,tee_res);
+	return tee_res;
+}
+
 /*
  * brief:	Finalize state of HASH algorithm.
  *
@@ -1971,7 +2688,149 @@ TEE_Result crypto_hw_acipher_gen_rsa_key(struct rsa_keypair *key,
 }
 
 /*
- * brief:	Build RSA private key.
+ * brief:	Look up a built RSA key in the converted key cache. A key
+ *		object without a generation is never found.
+ *		The caller holds the SS_ASYMM_UNIT_CC unit.
+ *
+ * param[in]	*owner		- Key object the key is built from.
+ * param[in]	gen		- Generation of the key object.
+ * param[in]	type		- Kind of key (SS_RSA_KEY_xxx).
+ * return	void *		- Built key, NULL if not cached.
+ */
+static void *ss_rsa_key_cache_lookup(const void *owner, uint32_t gen,
+		uint32_t type)
+{
+	void *crysKey = NULL;
+	uint32_t i;
+
+	for (i = 0U; (i < SS_RSA_KEY_CACHE_NUM) && (gen != 0U); i++) {
+		if ((ss_rsa_key_cache[i].crysKey != NULL) &&
+				(ss_rsa_key_cache[i].owner == owner) &&
+				(ss_rsa_key_cache[i].gen == gen) &&
+				(ss_rsa_key_cache[i].type == type)) {
+			ss_rsa_key_cache_stamp++;
+			ss_rsa_key_cache[i].stamp = ss_rsa_key_cache_stamp;
+			crysKey = ss_rsa_key_cache[i].crysKey;
+			break;
+		}
+	}
+	PROV_DMSG("owner=%p gen=%u type=%d crysKey=%p\n", owner, gen, type,
+			crysKey);
+	return crysKey;
+}
+
+/*
+ * brief:	Store a built RSA key in the converted key cache. The entry
+ *		of an older generation of the same key object, else a free
+ *		entry, else the least recently used entry is replaced.
+ *		The caller holds the SS_ASYMM_UNIT_CC unit.
+ *
+ * param[in]	*owner		- Key object the key is built from.
+ * param[in]	gen		- Generation of the key object, 0 if none.
+ * param[in]	type		- Kind of key (SS_RSA_KEY_xxx).
+ * param[in]	*crysKey	- Built key, owned by the cache on return.
+ * param[in]	crysKeySize	- Size of the built key.
+ */
+static void ss_rsa_key_cache_insert(const void *owner, uint32_t gen,
+		uint32_t type, void *crysKey, size_t crysKeySize)
+{
+	SS_RSA_KeyCache_t *entry = NULL;
+	uint32_t i;
+
+	for (i = 0U; i < SS_RSA_KEY_CACHE_NUM; i++) {
+		if ((ss_rsa_key_cache[i].crysKey != NULL) &&
+				(ss_rsa_key_cache[i].owner == owner) &&
+				(ss_rsa_key_cache[i].type == type)) {
+			entry = &ss_rsa_key_cache[i];
+			break;
+		}
+	}
+	if (entry == NULL) {
+		entry = &ss_rsa_key_cache[0];
+		for (i = 0U; i < SS_RSA_KEY_CACHE_NUM; i++) {
+			if (ss_rsa_key_cache[i].crysKey == NULL) {
+				entry = &ss_rsa_key_cache[i];
+				break;
+			}
+			if (ss_rsa_key_cache[i].stamp < entry->stamp) {
+				entry = &ss_rsa_key_cache[i];
+			}
+		}
+	}
+	ss_rsa_key_cache_evict(entry);
+
+	ss_rsa_key_cache_stamp++;
+	entry->owner = owner;
+	entry->gen = gen;
+	entry->type = type;
+	entry->stamp = ss_rsa_key_cache_stamp;
+	entry->crysKey = crysKey;
+	entry->crysKeySize = crysKeySize;
+	PROV_DMSG("owner=%p gen=%u type=%d crysKey=%p\n", owner, gen, type,
+			crysKey);
+}
+
+/*
+ * brief:	Wipe and free an entry of the converted key cache.
+ *		The caller holds the SS_ASYMM_UNIT_CC unit.
+ *
+ * param[in]	*entry		- Entry of the converted key cache.
+ */
+static void ss_rsa_key_cache_evict(SS_RSA_KeyCache_t *entry)
+{
+	if (entry->crysKey != NULL) {
+		memzero_explicit(entry->crysKey, entry->crysKeySize);
+		ss_free(entry->crysKey);
+	}
+	(void)memset(entry, 0, sizeof(SS_RSA_KeyCache_t));
+}
+
+/*
+ * brief:	Get a new generation of an RSA key object for the converted
+ *		key cache.
+ *
+ * return	uint32_t	- Generation of the key object, never 0.
+ */
+uint32_t crypto_hw_acipher_rsa_key_gen(void)
+{
+	uint32_t gen;
+
+	do {
+		gen = atomic_inc32(&ss_rsa_key_cache_gen);
+	} while (gen == 0U);
+
+	return gen;
+}
+
+/*
+ * brief:	Drop the built RSA keys of a key object from the converted
+ *		key cache.
+ *
+ * param[in]	*key		- Key object (struct rsa_keypair or
+ *				  struct rsa_public_key) being freed.
+ */
+void crypto_hw_acipher_rsa_key_release(const void *key)
+{
+	uint32_t i;
+
+	PROV_INMSG("*key=%p\n", key);
+	ss_asymm_acquire(SS_ASYMM_UNIT_CC);
+	for (i = 0U; i < SS_RSA_KEY_CACHE_NUM; i++) {
+		if ((ss_rsa_key_cache[i].crysKey != NULL) &&
+				(ss_rsa_key_cache[i].owner == key)) {
+			ss_rsa_key_cache_evict(&ss_rsa_key_cache[i]);
+		}
+	}
+	ss_asymm_release(SS_ASYMM_UNIT_CC);
+	PROV_OUTMSG("return\n");
+}
+
+/*
+ * brief:	Build RSA private key. The built key is taken from the
+ *		converted key cache when it was built from the same
+ *		generation of the key object.
+ *		The caller holds the SS_ASYMM_UNIT_CC unit while the key is
+ *		in use and does not free it.
  *
  * param[out]	**userPrivKey	- RSA private key of Sansa format.
  * param[in]	*key		- RSA private key of TEE internal API format.
@@ -1983,124 +2842,126 @@ static SSError_t ss_build_priv_key(CRYS_RSAUserPrivKey_t **userPrivKey,
 	SSError_t res = SS_SUCCESS;
 	CRYSError_t crys_res;
 	CRYS_RSAUserPrivKey_t *privKey_ptr = NULL;
-	uint8_t *e_ptr = NULL;
-	uint16_t eSize = 0U;
-	uint8_t *d_ptr = NULL;
-	uint16_t dSize = 0U;
-	uint8_t *n_ptr = NULL;
-	uint16_t nSize = 0U;
-	uint8_t *dp_ptr = NULL;
-	uint16_t dpSize = 0U;
-	uint8_t *p_ptr = NULL;
-	uint16_t pSize = 0U;
-	uint8_t *q_ptr = NULL;
-	uint16_t qSize = 0U;
-	uint8_t *dq_ptr = NULL;
-	uint16_t dqSize = 0U;
-	uint8_t *qInv_ptr = NULL;
-	uint16_t qInvSize = 0U;
+	uint8_t *bin[SS_RSA_KEY_COMP_NUM] = { NULL };
+	uint16_t binSize[SS_RSA_KEY_COMP_NUM] = { 0U };
+	uint32_t num = 0U;
+	uint32_t type = SS_RSA_KEY_PRIV;
+	uint32_t i;
 
 	PROV_INMSG("**userPrivKey=%p, key=%p\n",*userPrivKey,key);
 	NULL_CHECK_RSA_KEYPAIR(key,res);
-	if (res == SS_SUCCESS) {
-		PROV_DMSG("CALL: ss_malloc(CRYS_RSAUserPrivKey_t)\n");
-		privKey_ptr = (CRYS_RSAUserPrivKey_t *)ss_malloc(
-				sizeof(CRYS_RSAUserPrivKey_t), &res);
-	}
 	if (res == SS_SUCCESS) {
 		if ((bn_num_bytes(key->p) == 0U)
 				|| ((bn_num_bytes(key->n) >= MAX_RSA_KEY_SIZE))) {
-			PROV_DMSG("key->e=%p\n", key->e);
-			res = ss_copy_bn2bin_uint16(key->e, &e_ptr, &eSize);
+			type = SS_RSA_KEY_PRIV;
+		} else {
+			type = SS_RSA_KEY_PRIV_CRT;
+		}
+		/* The components are only converted to build the key */
+		privKey_ptr = (CRYS_RSAUserPrivKey_t *)ss_rsa_key_cache_lookup(
+				key, key->hw_gen, type);
+	}
+	if ((res == SS_SUCCESS) && (privKey_ptr == NULL)) {
+		if (type == SS_RSA_KEY_PRIV) {
+			/* bin[] = { d, e, n } */
+			num = 3U;
+			PROV_DMSG("key->d=%p\n", key->d);
+			res = ss_copy_bn2bin_uint16(key->d, &bin[0],
+					&binSize[0]);
 			if (res == SS_SUCCESS) {
-				PROV_DMSG("key->d=%p\n", key->d);
-				res = ss_copy_bn2bin_uint16(key->d, &d_ptr,
-						&dSize);
+				PROV_DMSG("key->e=%p\n", key->e);
+				res = ss_copy_bn2bin_uint16(key->e, &bin[1],
+						&binSize[1]);
 			}
 			if (res == SS_SUCCESS) {
 				PROV_DMSG("key->n=%p\n", key->n);
-				res = ss_copy_bn2bin_uint16(key->n, &n_ptr,
-						&nSize);
-			}
-			if (res == SS_SUCCESS) {
-				PROV_DMSG("CALL: CRYS_RSA_Build_PrivKey()\n");
-				PROV_DMSG("privKey_ptr=%p\n", privKey_ptr);
-				PROV_DMSG("d_ptr=%p dSize=%d\n", d_ptr, dSize);
-				PROV_DMSG("e_ptr=%p eSize=%d\n", e_ptr, eSize);
-				PROV_DMSG("n_ptr=%p nSize=%d\n", n_ptr, nSize);
-				crys_res = CRYS_RSA_Build_PrivKey(privKey_ptr,
-						d_ptr, dSize, e_ptr, eSize,
-						n_ptr, nSize);
-				res = ss_translate_error_crys2ss_rsa(crys_res);
-				PROV_DMSG("crys_res=0x%08x -> res=0x%08x\n",
-						crys_res, res);
+				res = ss_copy_bn2bin_uint16(key->n, &bin[2],
+						&binSize[2]);
 			}
 		} else {
+			/* bin[] = { p, q, dp, dq, qp } */
+			num = 5U;
 			PROV_DMSG("key->p=%p\n", key->p);
-			res = ss_copy_bn2bin_uint16(key->p, &p_ptr, &pSize);
+			res = ss_copy_bn2bin_uint16(key->p, &bin[0],
+					&binSize[0]);
 			if (res == SS_SUCCESS) {
 				PROV_DMSG("key->q=%p\n", key->q);
-				res = ss_copy_bn2bin_uint16(key->q, &q_ptr,
-						&qSize);
+				res = ss_copy_bn2bin_uint16(key->q, &bin[1],
+						&binSize[1]);
 			}
 			if (res == SS_SUCCESS) {
 				PROV_DMSG("key->dp=%p\n", key->dp);
-				res = ss_copy_bn2bin_uint16(key->dp, &dp_ptr,
-						&dpSize);
+				res = ss_copy_bn2bin_uint16(key->dp, &bin[2],
+						&binSize[2]);
 			}
 			if (res == SS_SUCCESS) {
 				PROV_DMSG("key->dq=%p\n", key->dq);
-				res = ss_copy_bn2bin_uint16(key->dq, &dq_ptr,
-						&dqSize);
+				res = ss_copy_bn2bin_uint16(key->dq, &bin[3],
+						&binSize[3]);
 			}
 			if (res == SS_SUCCESS) {
 				PROV_DMSG("key->qp=%p\n", key->qp);
-				res = ss_copy_bn2bin_uint16(key->qp, &qInv_ptr,
-						&qInvSize);
-			}
-			if (res == SS_SUCCESS) {
-				PROV_DMSG("CRYS_RSA_Build_PrivKeyCRT()\n");
-				PROV_DMSG("privKey_ptr=%p\n", privKey_ptr);
-				PROV_DMSG("p_ptr=%p pSize=%d\n", p_ptr, pSize);
-				PROV_DMSG("q_ptr=%p qSize=%d\n", q_ptr, qSize);
-				PROV_DMSG("dp_ptr=%p nSize=%d\n", dp_ptr,
-						dqSize);
-				PROV_DMSG("dq_ptr=%p dSize=%d\n", dp_ptr,
-						dqSize);
-				PROV_DMSG("qInv_ptr=%p qInvSize=%d\n", e_ptr,
-						eSize);
-				crys_res = CRYS_RSA_Build_PrivKeyCRT(
-						privKey_ptr, p_ptr, pSize,
-						q_ptr, qSize, dp_ptr, dpSize,
-						dq_ptr, dqSize, qInv_ptr,
-						qInvSize);
-				res = ss_translate_error_crys2ss_rsa(crys_res);
-				PROV_DMSG("crys_res=0x%08x -> res=0x%08x\n",
-						crys_res, res);
+				res = ss_copy_bn2bin_uint16(key->qp, &bin[4],
+						&binSize[4]);
 			}
 		}
 	}
+	if ((res == SS_SUCCESS) && (privKey_ptr == NULL)) {
+		PROV_DMSG("CALL: ss_malloc(CRYS_RSAUserPrivKey_t)\n");
+		privKey_ptr = (CRYS_RSAUserPrivKey_t *)ss_malloc(
+				sizeof(CRYS_RSAUserPrivKey_t), &res);
+		if ((res == SS_SUCCESS) && (type == SS_RSA_KEY_PRIV)) {
+			PROV_DMSG("CALL: CRYS_RSA_Build_PrivKey()\n");
+			PROV_DMSG("privKey_ptr=%p\n", privKey_ptr);
+			crys_res = CRYS_RSA_Build_PrivKey(privKey_ptr,
+					bin[0], binSize[0], bin[1], binSize[1],
+					bin[2], binSize[2]);
+			res = ss_translate_error_crys2ss_rsa(crys_res);
+			PROV_DMSG("crys_res=0x%08x -> res=0x%08x\n",
+					crys_res, res);
+		} else if (res == SS_SUCCESS) {
+			PROV_DMSG("CRYS_RSA_Build_PrivKeyCRT()\n");
+			PROV_DMSG("privKey_ptr=%p\n", privKey_ptr);
+			crys_res = CRYS_RSA_Build_PrivKeyCRT(privKey_ptr,
+					bin[0], binSize[0], bin[1], binSize[1],
+					bin[2], binSize[2], bin[3], binSize[3],
+					bin[4], binSize[4]);
+			res = ss_translate_error_crys2ss_rsa(crys_res);
+			PROV_DMSG("crys_res=0x%08x -> res=0x%08x\n",
+					crys_res, res);
+		} else {
+			/* no operation */
+		}
+		if (res == SS_SUCCESS) {
+			ss_rsa_key_cache_insert(key, key->hw_gen, type,
+					privKey_ptr,
+					sizeof(CRYS_RSAUserPrivKey_t));
+		} else {
+			ss_free((void *)privKey_ptr);
+		}
+	}
 	if (res == SS_SUCCESS) {
 		*userPrivKey = privKey_ptr;
 	} else {
-		ss_free((void*)privKey_ptr);
 		PROV_EMSG("ss_build_priv_key\n");
 	}
 
-	ss_free((void*)e_ptr);
-	ss_free((void*)d_ptr);
-	ss_free((void*)n_ptr);
-	ss_free((void*)p_ptr);
-	ss_free((void*)q_ptr);
-	ss_free((void*)dp_ptr);
-	ss_free((void*)dq_ptr);
-	ss_free((void*)qInv_ptr);
+	for (i = 0U; i < num; i++) {
+		if (bin[i] != NULL) {
+			memzero_explicit(bin[i], (size_t)binSize[i]);
+		}
+		ss_free((void *)bin[i]);
+	}
 	PROV_OUTMSG("return res=0x%08x\n", res);
 	return res;
 }
 
 /*
- * brief:	Build RSA public key.
+ * brief:	Build RSA public key. The built key is taken from the
+ *		converted key cache when it was built from the same
+ *		generation of the key object.
+ *		The caller holds the SS_ASYMM_UNIT_CC unit while the key is
+ *		in use and does not free it.
  *
  * param[out]	**userPubKey	- Double pointer to RSA public key of Sansa format.
  * param[in]	*key		- Pointer to RSA private key of TEE internal API format.
@@ -2112,44 +2973,56 @@ static SSError_t ss_build_pub_key(CRYS_RSAUserPubKey_t **userPubKey,
 	SSError_t res = SS_SUCCESS;
 	CRYSError_t crys_res;
 	CRYS_RSAUserPubKey_t *pubKey_ptr = NULL;
-	uint8_t *modulus_ptr = NULL;
-	uint8_t *exponent_ptr = NULL;
-	uint16_t modulusSize = 0U;
-	uint16_t exponentSize = 0U;
+	/* bin[] = { e, n } */
+	uint8_t *bin[2] = { NULL };
+	uint16_t binSize[2] = { 0U };
 
 	PROV_INMSG("**userPubKey=%p, *key=%p\n",*userPubKey,key);
 	NULL_CHECK_RSA_PUBLIC_KEY(key,res);
 	if (res == SS_SUCCESS) {
+		/* The components are only converted to build the key */
+		pubKey_ptr = (CRYS_RSAUserPubKey_t *)ss_rsa_key_cache_lookup(
+				key, key->hw_gen, SS_RSA_KEY_PUB);
+	}
+	if ((res == SS_SUCCESS) && (pubKey_ptr == NULL)) {
+		res = ss_copy_bn2bin_uint16(key->e,&bin[0],&binSize[0]);
+		if (res == SS_SUCCESS) {
+			res = ss_copy_bn2bin_uint16(key->n,&bin[1],
+					&binSize[1]);
+		}
+	}
+	if ((res == SS_SUCCESS) && (pubKey_ptr == NULL)) {
 		PROV_DMSG("CALL: ss_malloc(CRYS_RSAUserPubKey_t)\n");
 		pubKey_ptr = (CRYS_RSAUserPubKey_t *)ss_malloc(
 				sizeof(CRYS_RSAUserPubKey_t), &res);
-	}
-	if (res == SS_SUCCESS) {
-		res = ss_copy_bn2bin_uint16(key->e,&exponent_ptr,&exponentSize);
-	}
-	if (res == SS_SUCCESS) {
-		res = ss_copy_bn2bin_uint16(key->n,&modulus_ptr,&modulusSize);
-	}
-
-	if (res == SS_SUCCESS) {
-		PROV_DMSG("CALL: CRYS_RSA_Build_PubKey()\n");
-		crys_res = CRYS_RSA_Build_PubKey(pubKey_ptr,
-				exponent_ptr,
-				exponentSize,
-				modulus_ptr,
-				modulusSize);
-		res = ss_translate_error_crys2ss_rsa(crys_res);
-		PROV_DMSG("Result: crys_res=0x%08x -> res=0x%08x\n",crys_res,res);
+		if (res == SS_SUCCESS) {
+			PROV_DMSG("CALL: CRYS_RSA_Build_PubKey()\n");
+			crys_res = CRYS_RSA_Build_PubKey(pubKey_ptr,
+					bin[0], binSize[0],
+					bin[1], binSize[1]);
+			res = ss_translate_error_crys2ss_rsa(crys_res);
+			PROV_DMSG("Result: crys_res=0x%08x -> res=0x%08x\n",crys_res,res);
+		}
+		if (res == SS_SUCCESS) {
+			ss_rsa_key_cache_insert(key, key->hw_gen,
+					SS_RSA_KEY_PUB, pubKey_ptr,
+					sizeof(CRYS_RSAUserPubKey_t));
+		} else {
+			ss_free((void *)pubKey_ptr);
+		}
 	}
 	if (res == SS_SUCCESS) {
 		*userPubKey = pubKey_ptr;
 	} else {
-		ss_free((void*)pubKey_ptr);
 		PROV_EMSG("ss_build_publ_key\n");
 	}
 
-	ss_free(exponent_ptr);
-	ss_free(modulus_ptr);
+	if (bin[0] != NULL) {
+		ss_free((void *)bin[0]);
+	}
+	if (bin[1] != NULL) {
+		ss_free((void *)bin[1]);
+	}
 	PROV_OUTMSG("return res=0x%08x\n", res);
 	return res;
 }
@@ -2218,7 +3091,7 @@ TEE_Result crypto_hw_acipher_rsanopad_encrypt(struct rsa_public_key *key,
 		}
 	}
 
-	rcar_nex_mutex_lock(&secure_asymm_mutex);
+	ss_asymm_acquire(SS_ASYMM_UNIT_CC);
 	if (res == SS_SUCCESS) {
 		PROV_DMSG("CALL: ss_build_pub_key()\n");
 		res = ss_build_pub_key(&userPubKey_ptr, key);
@@ -2239,7 +3112,7 @@ TEE_Result crypto_hw_acipher_rsanopad_encrypt(struct rsa_public_key *key,
 		}
 		PROV_DMSG("Result: crys_res=0x%08x -> res=0x%08x\n",crys_res,res);
 	}
-	rcar_nex_mutex_unlock(&secure_asymm_mutex);
+	ss_asymm_release(SS_ASYMM_UNIT_CC);
 
 	/* Remove the zero-padding (leave one zero if buff is all zeroes) */
 	if (res == SS_SUCCESS) {
@@ -2260,7 +3133,6 @@ TEE_Result crypto_hw_acipher_rsanopad_encrypt(struct rsa_public_key *key,
 
 	ss_free((void *)in_ptr);
 	ss_free((void *)out_ptr);
-	ss_free((void *)userPubKey_ptr);
 	ss_free((void *)primeData_ptr);
 
 	tee_res = ss_translate_error_ss2tee(res);
@@ -2312,7 +3184,7 @@ TEE_Result crypto_hw_acipher_rsanopad_decrypt(struct rsa_keypair *key,
 		}
 	}
 
-	rcar_nex_mutex_lock(&secure_asymm_mutex);
+	ss_asymm_acquire(SS_ASYMM_UNIT_CC);
 	if (res == SS_SUCCESS) {
 		PROV_DMSG("CALL: ss_build_priv_key()\n");
 		res = ss_build_priv_key(&userPrivKey_ptr, key);
@@ -2334,7 +3206,7 @@ TEE_Result crypto_hw_acipher_rsanopad_decrypt(struct rsa_keypair *key,
 		}
 		PROV_DMSG("Result: crys_res=0x%08x -> res=0x%08x\n",crys_res,res);
 	}
-	rcar_nex_mutex_unlock(&secure_asymm_mutex);
+	ss_asymm_release(SS_ASYMM_UNIT_CC);
 
 	/* Remove the zero-padding (leave one zero if buff is all zeroes) */
 	if (res == SS_SUCCESS) {
@@ -2352,7 +3224,6 @@ TEE_Result crypto_hw_acipher_rsanopad_decrypt(struct rsa_keypair *key,
 		(void)memcpy(dst, (uint8_t *)outBuf + offset, *dst_len);
 	}
 
-	ss_free((void *)userPrivKey_ptr);
 	ss_free((void *)primeData_ptr);
 	ss_free((void *)outBuf);
 	tee_res = ss_translate_error_ss2tee(res);
@@ -2568,7 +3439,7 @@ TEE_Result crypto_hw_acipher_rsaes_encrypt(uint32_t algo,
 		}
 	}
 
-	rcar_nex_mutex_lock(&secure_asymm_mutex);
+	ss_asymm_acquire(SS_ASYMM_UNIT_CC);
 	if (res == SS_SUCCESS) {
 		res = ss_build_pub_key(&userPubKey_ptr, key);
 		if (res != SS_SUCCESS) {
@@ -2602,9 +3473,8 @@ TEE_Result crypto_hw_acipher_rsaes_encrypt(uint32_t algo,
 		}
 		PROV_DMSG("Result: crys_res=0x%08x -> res=0x%08x\n",crys_res,res);
 	}
-	rcar_nex_mutex_unlock(&secure_asymm_mutex);
+	ss_asymm_release(SS_ASYMM_UNIT_CC);
 
-	ss_free((void *)userPubKey_ptr);
 	ss_free((void *)primeData_ptr);
 out:
 	PROV_DHEXDUMP(dst,*dst_len);
@@ -2728,7 +3598,7 @@ TEE_Result crypto_hw_acipher_rsaes_decrypt(uint32_t algo, struct rsa_keypair *ke
 		}
 	}
 
-	rcar_nex_mutex_lock(&secure_asymm_mutex);
+	ss_asymm_acquire(SS_ASYMM_UNIT_CC);
 	if (res == SS_SUCCESS) {
 		res = ss_build_priv_key(&userPrivKey_ptr, key);
 		if (res != SS_SUCCESS) {
@@ -2786,14 +3656,13 @@ TEE_Result crypto_hw_acipher_rsaes_decrypt(uint32_t algo, struct rsa_keypair *ke
 			PROV_DMSG("Result: crys_res=0x%08x -> res=0x%08x\n",crys_res,res);
 		}
 	}
-	rcar_nex_mutex_unlock(&secure_asymm_mutex);
+	ss_asymm_release(SS_ASYMM_UNIT_CC);
 
 	if (res == SS_SUCCESS) {
 		*dst_len = (size_t)outputSize;
 		PROV_DMSG("Output dst   dst_len=%ld\n",*dst_len);
 	}
 
-	ss_free((void *)userPrivKey_ptr);
 	ss_free((void *)primeData_ptr);
 	tee_res = ss_translate_error_ss2tee(res);
 	PROV_DHEXDUMP(dst,*dst_len);
@@ -2877,7 +3746,7 @@ TEE_Result crypto_hw_acipher_rsassa_sign(uint32_t algo, struct rsa_keypair *key,
 		}
 	}
 
-	rcar_nex_mutex_lock(&secure_asymm_mutex);
+	ss_asymm_acquire(SS_ASYMM_UNIT_CC);
 	if (res == SS_SUCCESS) {
 		res = ss_build_priv_key(&userPrivKey_ptr, key);
 	}
@@ -2906,7 +3775,7 @@ TEE_Result crypto_hw_acipher_rsassa_sign(uint32_t algo, struct rsa_keypair *key,
 		res = ss_translate_error_crys2ss_rsa(crys_res);
 		PROV_DMSG("Result: crys_res=0x%08x -> res=0x%08x\n",crys_res,res);
 	}
-	rcar_nex_mutex_unlock(&secure_asymm_mutex);
+	ss_asymm_release(SS_ASYMM_UNIT_CC);
 
 	if (res == SS_SUCCESS) {
 		*sig_len = (size_t)outputSize;
@@ -2914,7 +3783,6 @@ TEE_Result crypto_hw_acipher_rsassa_sign(uint32_t algo, struct rsa_keypair *key,
 	}
 
 	ss_free((void *)userContext_ptr);
-	ss_free((void *)userPrivKey_ptr);
 	tee_res = ss_translate_error_ss2tee(res);
 	PROV_OUTMSG("return res=0x%08x -> tee_res=0x%08x\n",res,tee_res);
 	return tee_res;
@@ -2990,7 +3858,7 @@ TEE_Result crypto_hw_acipher_rsassa_verify(uint32_t algo,
 		}
 	}
 
-	rcar_nex_mutex_lock(&secure_asymm_mutex);
+	ss_asymm_acquire(SS_ASYMM_UNIT_CC);
 	if (res == SS_SUCCESS) {
 		res = ss_build_pub_key(&userPubKey_ptr, key);
 		if (res != SS_SUCCESS) {
@@ -3022,10 +3890,9 @@ TEE_Result crypto_hw_acipher_rsassa_verify(uint32_t algo,
 		}
 		PROV_DMSG("Result: crys_res=0x%08x -> res=0x%08x\n",crys_res,res);
 	}
-	rcar_nex_mutex_unlock(&secure_asymm_mutex);
+	ss_asymm_release(SS_ASYMM_UNIT_CC);
 
 	ss_free((void *)userContext_ptr);
-	ss_free((void *)userPubKey_ptr);
 
 	tee_res = ss_translate_error_ss2tee(res);
 	PROV_OUTMSG("return res=0x%08x -> tee_res=0x%08x\n",res,tee_res);
@@ -3226,7 +4093,7 @@ TEE_Result crypto_hw_acipher_dh_shared_secret(struct dh_keypair *private_key,
 		secretKey_ptr = (uint8_t *)ss_malloc((size_t)secretKeySize, &res);
 	}
 
-	rcar_nex_mutex_lock(&secure_asymm_mutex);
+	ss_asymm_acquire(SS_ASYMM_UNIT_CC);
 	if (res == SS_SUCCESS) {
 		secretKeySize = primeSize;
 		PROV_DMSG("CALL: CRYS_DH_GetSecretKey()\n");
@@ -3238,7 +4105,7 @@ TEE_Result crypto_hw_acipher_dh_shared_secret(struct dh_keypair *private_key,
 		res = ss_translate_error_crys2ss_dh(crys_res);
 		PROV_DMSG("Result: crys_res=0x%08x -> res=0x%08x\n",crys_res,res);
 	}
-	rcar_nex_mutex_unlock(&secure_asymm_mutex);
+	ss_asymm_release(SS_ASYMM_UNIT_CC);
 
 	if (res == SS_SUCCESS) {
 		res = crypto_bignum_bin2bn(secretKey_ptr,(size_t)secretKeySize, secret);
@@ -3494,7 +4361,7 @@ TEE_Result crypto_hw_acipher_ecc_sign(struct ecc_keypair *key,
 		res = ss_get_ecc_digest(messageSizeInBytes, &eccHashMode);
 	}
 
-	rcar_nex_mutex_lock(&secure_asymm_mutex);
+	ss_asymm_acquire(SS_ASYMM_UNIT_CC);
 	if (res == SS_SUCCESS) {
 		PROV_DMSG("CALL:  CRYS_ECPKI_BuildPrivKey()\n");
 		crys_res = CRYS_ECPKI_BuildPrivKey(domain_id, privKeySizeIn_ptr,
@@ -3512,7 +4379,7 @@ TEE_Result crypto_hw_acipher_ecc_sign(struct ecc_keypair *key,
 		res = ss_translate_error_crys2ss_ecc(crys_res);
 		PROV_DMSG("Result: crys_res=0x%08x -> res=0x%08x\n",crys_res,res);
 	}
-	rcar_nex_mutex_unlock(&secure_asymm_mutex);
+	ss_asymm_release(SS_ASYMM_UNIT_CC);
 
 	ss_free((void *)signUserContext_ptr);
 	ss_free((void *)privKeySizeIn_ptr);
@@ -3599,7 +4466,7 @@ static SSError_t ss_ecc_verify_secure(struct ecc_public_key *key,
 		res = ss_get_ecc_digest(messageSizeInBytes, &eccHashMode);
 	}
 
-	rcar_nex_mutex_lock(&secure_asymm_mutex);
+	ss_asymm_acquire(SS_ASYMM_UNIT_CC);
 	if (res == SS_SUCCESS) {
 		/* build public key */
 		*publKeyIn_ptr = (uint8_t)CRYS_EC_PointUncompressed;
@@ -3624,7 +4491,7 @@ static SSError_t ss_ecc_verify_secure(struct ecc_public_key *key,
 		PROV_DMSG("Result: crys_res=0x%08x -> res=0x%08x\n", crys_res,
 				res);
 	}
-	rcar_nex_mutex_unlock(&secure_asymm_mutex);
+	ss_asymm_release(SS_ASYMM_UNIT_CC);
 
 	ss_free((void *)publKeyX_ptr);
 	ss_free((void *)publKeyY_ptr);
@@ -3669,6 +4536,41 @@ TEE_Result crypto_hw_acipher_ecc_verify(struct ecc_public_key *key,
 	return tee_res;
 }
 
+/*
+ * brief:	Verify several signatures by the ECC (FIPS 186-4 ANSI X9.62)
+ *
+ * param[in]	*items		- Signatures to verify. The res of an item
+ *				  is set to its TEE internal API result,
+ *				  TEE_ERROR_NOT_SUPPORTED if the engine does
+ *				  not support its curve and digest size.
+ * param[in]	num		- Number of items.
+ */
+void crypto_hw_acipher_ecc_verify_batch(struct crypto_ecc_verify_item *items,
+		size_t num)
+{
+#ifdef CFG_CRYPT_ENABLE_CEPKA
+	PROV_DMSG("USE Crypto Engine PKA\n");
+	ss_ecc_verify_pka_batch(items, num);
+#else
+	size_t i;
+
+	PROV_DMSG("USE Crypto Engine Secure\n");
+	for (i = 0U; i < num; i++) {
+		if ((items[i].key != NULL) &&
+				(crypto_hw_acipher_ecc_check_support(
+				items[i].key->curve, items[i].msg_len) ==
+				SS_HW_SUPPORT_ALG)) {
+			items[i].res = ss_translate_error_ss2tee(
+					ss_ecc_verify_secure(items[i].key,
+					items[i].msg, items[i].msg_len,
+					items[i].sig, items[i].sig_len));
+		} else {
+			items[i].res = TEE_ERROR_NOT_SUPPORTED;
+		}
+	}
+#endif
+}
+
 /*
  * brief:	Generate secret key by the ECC.
  *
@@ -3746,7 +4648,7 @@ TEE_Result crypto_hw_acipher_ecc_shared_secret(struct ecc_keypair *private_key,
 		publKeyIn_ptr = (uint8_t *)ss_calloc(1,publkeysize_bytes, &res);
 	}
 
-	rcar_nex_mutex_lock(&secure_asymm_mutex);
+	ss_asymm_acquire(SS_ASYMM_UNIT_CC);
 	if (res == SS_SUCCESS) {
 		*publKeyIn_ptr = (uint8_t)CRYS_EC_PointUncompressed;
 		(void)memcpy((((publKeyIn_ptr + 1U) + modulusbytes) - publKeySizeXBytes),
@@ -3778,7 +4680,7 @@ TEE_Result crypto_hw_acipher_ecc_shared_secret(struct ecc_keypair *private_key,
 		res = ss_translate_error_crys2ss_ecc(crys_res);
 		PROV_DMSG("Result: crys_res=0x%08x -> res=0x%08x\n",crys_res,res);
 	}
-	rcar_nex_mutex_unlock(&secure_asymm_mutex);
+	ss_asymm_release(SS_ASYMM_UNIT_CC);
 
 	ss_free((void *)tempBuff_ptr);
 	ss_free((void *)userpriv_key);
@@ -3887,6 +4789,21 @@ void crypto_hw_cipher_get_current_algo(void *ctx, uint32_t *algo)
     return;
 }
 
+/*
+ * brief:	Get the engine selection state of AES,DES algorithm.
+ *
+ * param[in]	*ctx	- Context to AES,DES algorithm.
+ * return	struct crypto_hw_dispatch * - Engine selection state.
+ */
+struct crypto_hw_dispatch *crypto_hw_cipher_get_dispatch(void *ctx)
+{
+    SS_Cipher_Context_t *cipher_ctx = NULL;
+
+    cipher_ctx = (SS_Cipher_Context_t *)ctx;
+
+    return &cipher_ctx->dispatch;
+}
+
 /*
  * brief:	Allocate a context for AES,DES algorithm.
  *
@@ -3920,8 +4837,8 @@ TEE_Result crypto_hw_cipher_alloc_ctx(void **ctx, uint32_t algo)
 #if defined(CFG_CRYPTO_CTS)
         case TEE_ALG_AES_CTS:
 #endif
-            ss_cipher_ctx = (SS_Cipher_Context_t *)ss_calloc(1U,
-                sizeof(SS_Cipher_Context_t), &ret);
+            ss_cipher_ctx = (SS_Cipher_Context_t *)ss_ctx_alloc(
+                CRYPTO_HW_CTX_CIPHER, &ret);
             if (ret == SS_SUCCESS)
             {
                 ss_cipher_ctx->algo = algo;
@@ -3944,8 +4861,8 @@ TEE_Result crypto_hw_cipher_alloc_ctx(void **ctx, uint32_t algo)
         case TEE_ALG_DES_CBC_NOPAD:
         case TEE_ALG_DES3_CBC_NOPAD:
 #endif
-            ss_cipher_ctx = (SS_Cipher_Context_t *)ss_calloc(1U,
-                sizeof(SS_Cipher_Context_t), &ret);
+            ss_cipher_ctx = (SS_Cipher_Context_t *)ss_ctx_alloc(
+                CRYPTO_HW_CTX_CIPHER, &ret);
             if (ret == SS_SUCCESS)
             {
                 ss_cipher_ctx->algo = algo;
@@ -3970,6 +4887,16 @@ TEE_Result crypto_hw_cipher_alloc_ctx(void **ctx, uint32_t algo)
     return tee_ret;
 }
 
+/*
+ * brief:	Free a context for AES,DES algorithm.
+ *
+ * param[in]	ctx	    	- Pointer to the AES,DES context.
+ */
+void crypto_hw_cipher_free_ctx(void *ctx)
+{
+    ss_ctx_free(CRYPTO_HW_CTX_CIPHER, ctx);
+}
+
 /*
  * brief:	Get context size to AES,DES algorithm.
  *
@@ -4062,6 +4989,8 @@ static SSError_t ss_aes_init(void *ctx, uint32_t algo, TEE_OperationMode mode,
 		ss_ctx->blockSize = 16U;
 		ss_ctx->restBufSize = 0U;
 		ss_ctx->mode = mode;
+		ss_ctx->ctrStreamPos = 0U;
+		ss_ctx->ctrStreamSize = 0U;
 		contextID_ptr = &ss_ctx->crys_ctx;
 		(void)memset(contextID_ptr, 0, sizeof(CRYS_AESUserContext_t));
 	} else {
@@ -4695,6 +5624,113 @@ TEE_Result crypto_hw_cipher_update(void *ctx, uint32_t algo,
 	return tee_res;
 }
 
+/*
+ * brief:	Block Data Update state of AES,DES algorithm from a scattered
+ *		source buffer. The destination buffer is contiguous.
+ *
+ * param[in]	*ctx		- Pointer to the AES,DES context.
+ * param[in]	algo		- Cryptographic algorithm.
+ * param[in]	last_block	- If source data is last chunk, the value is true.
+ * param[in]	*sg		- List of the source data fragments.
+ * param[in]	num		- Number of fragments in the list.
+ * param[in]	*dst		- Pointer to destination data buffer.
+ * return	TEE_Result	- TEE internal API error code.
+ */
+TEE_Result crypto_hw_cipher_update_sg(void *ctx, uint32_t algo,
+		TEE_OperationMode mode __unused, bool last_block,
+		const struct crypto_sg *sg, size_t num, uint8_t *dst)
+{
+	TEE_Result tee_res;
+	SSError_t res = SS_SUCCESS;
+	SS_Cipher_Context_t *ss_cipher_ctx = NULL;
+	SS_AES_Context_t *aesCtx = NULL;
+	SS_DES_Context_t *desCtx = NULL;
+	uint8_t *dataOut_ptr = dst;
+	uint8_t tail[SS_SG_TAIL_SIZE];
+	size_t tailLen = 0U;
+	size_t total = 0U;
+
+	PROV_INMSG("*ctx=%p, algo=%d, mode=%d, last_block=%d\n", ctx, algo,
+			mode, last_block);
+	PROV_INMSG("*sg=%p, num=%zu, *dst=%p\n", sg, num, dst);
+
+	if ((NULL == ctx) || (NULL == dst)) {
+		res = SS_ERROR_BAD_PARAMETERS;
+		PROV_EMSG("BAD_PARAMETERS(ctx=%p dst=%p)\n", ctx, dst);
+	} else {
+		ss_cipher_ctx = (SS_Cipher_Context_t *)ctx;
+		res = ss_sg_total(sg, num, &total);
+	}
+
+	if (SS_SUCCESS == res) {
+		switch ((int32_t)algo) {
+#if defined(CFG_CRYPTO_AES)
+#if defined(CFG_CRYPTO_ECB)
+		case TEE_ALG_AES_ECB_NOPAD:
+#endif
+#if defined(CFG_CRYPTO_CBC)
+		case TEE_ALG_AES_CBC_NOPAD:
+#endif
+#if defined(CFG_CRYPTO_CTR)
+		case TEE_ALG_AES_CTR:
+#endif
+#if defined(CFG_CRYPTO_OFB)
+		case TEE_ALG_AES_OFB:
+#endif
+#if defined(CFG_CRYPTO_CTS)
+		case TEE_ALG_AES_CTS:
+#endif
+			CHECK_CONTEXT(res, aesCtx, SS_AES_Context_t,
+					&(ss_cipher_ctx->u.aes_ctx));
+			/*
+			 * The last block is finished by ss_aes_update, which
+			 * takes the CTS blocks from one contiguous buffer.
+			 */
+			if (true == last_block) {
+				tailLen = MIN(total, (size_t)SS_SG_TAIL_SIZE);
+			}
+			if (SS_SUCCESS == res) {
+				res = ss_sg_update(aesCtx, algo, sg, num,
+						total - tailLen, &dataOut_ptr);
+			}
+			if ((SS_SUCCESS == res) && (true == last_block)) {
+				ss_sg_copy(sg, num, total - tailLen, tailLen,
+						tail);
+				res = ss_aes_update(aesCtx, algo, true, tail,
+						tailLen, dataOut_ptr);
+				memzero_explicit(tail, sizeof(tail));
+			}
+			break;
+#endif
+#if defined(CFG_CRYPTO_DES)
+#if defined(CFG_CRYPTO_ECB)
+		case TEE_ALG_DES_ECB_NOPAD:
+		case TEE_ALG_DES3_ECB_NOPAD:
+#endif
+#if defined(CFG_CRYPTO_CBC)
+		case TEE_ALG_DES_CBC_NOPAD:
+		case TEE_ALG_DES3_CBC_NOPAD:
+#endif
+			CHECK_CONTEXT(res, desCtx, SS_DES_Context_t,
+					&(ss_cipher_ctx->u.des_ctx));
+			if (SS_SUCCESS == res) {
+				res = ss_sg_update(desCtx, algo, sg, num,
+						total, &dataOut_ptr);
+			}
+			break;
+#endif
+		default:
+			PROV_DMSG("ERROR:SS_ERROR_NOT_SUPPORTED\n");
+			res = SS_ERROR_NOT_SUPPORTED;
+			break;
+		}
+	}
+
+	tee_res = ss_translate_error_ss2tee(res);
+	PROV_OUTMSG("return res=0x%08x -> tee_res=0x%08x\n",res,tee_res);
+	return tee_res;
+}
+
 /*
  * brief:	Finalize state of AES algorithm.
  *
@@ -4968,6 +6004,21 @@ void crypto_hw_mac_get_current_algo(void *ctx, uint32_t *algo)
     return;
 }
 
+/*
+ * brief:	Get the engine selection state of HMAC,AES-MAC algorithm.
+ *
+ * param[in]	*ctx	- Context to HMAC,AES-MAC algorithm.
+ * return	struct crypto_hw_dispatch * - Engine selection state.
+ */
+struct crypto_hw_dispatch *crypto_hw_mac_get_dispatch(void *ctx)
+{
+    SS_MAC_Context_t *mac_ctx = NULL;
+
+    mac_ctx = (SS_MAC_Context_t *)ctx;
+
+    return &mac_ctx->dispatch;
+}
+
 /*
  * brief:	Allocate a context for HMAC,AES-MAC algorithm.
  *
@@ -4992,8 +6043,8 @@ TEE_Result crypto_hw_mac_alloc_ctx(void **ctx, uint32_t algo)
         case TEE_ALG_HMAC_SHA256:
         case TEE_ALG_HMAC_SHA384:
         case TEE_ALG_HMAC_SHA512:
-            ss_mac_ctx = (SS_MAC_Context_t *)ss_calloc(1U,
-                sizeof(SS_MAC_Context_t), &ret);
+            ss_mac_ctx = (SS_MAC_Context_t *)ss_ctx_alloc(
+                CRYPTO_HW_CTX_MAC, &ret);
             if (ret == SS_SUCCESS)
             {
                 ss_mac_ctx->algo = algo;
@@ -5010,8 +6061,8 @@ TEE_Result crypto_hw_mac_alloc_ctx(void **ctx, uint32_t algo)
 #if defined(CFG_CRYPTO_CBC_MAC)
         case TEE_ALG_AES_CBC_MAC_NOPAD:
         case TEE_ALG_AES_CBC_MAC_PKCS5:
-            ss_mac_ctx = (SS_MAC_Context_t *)ss_calloc(1U,
-                sizeof(SS_MAC_Context_t), &ret);
+            ss_mac_ctx = (SS_MAC_Context_t *)ss_ctx_alloc(
+                CRYPTO_HW_CTX_MAC, &ret);
             if (ret == SS_SUCCESS)
             {
                 ss_mac_ctx->algo = algo;
@@ -5027,8 +6078,8 @@ TEE_Result crypto_hw_mac_alloc_ctx(void **ctx, uint32_t algo)
 #endif
 #if defined(CFG_CRYPTO_CMAC)
         case TEE_ALG_AES_CMAC:
-            ss_mac_ctx = (SS_MAC_Context_t *)ss_calloc(1U,
-                sizeof(SS_MAC_Context_t), &ret);
+            ss_mac_ctx = (SS_MAC_Context_t *)ss_ctx_alloc(
+                CRYPTO_HW_CTX_MAC, &ret);
             if (ret == SS_SUCCESS)
             {
                 ss_mac_ctx->algo = algo;
@@ -5044,8 +6095,8 @@ TEE_Result crypto_hw_mac_alloc_ctx(void **ctx, uint32_t algo)
 #endif
 #if defined(CFG_CRYPTO_XCBC_MAC)
         case TEE_ALG_AES_XCBC_MAC:
-            ss_mac_ctx = (SS_MAC_Context_t *)ss_calloc(1U,
-                sizeof(SS_MAC_Context_t), &ret);
+            ss_mac_ctx = (SS_MAC_Context_t *)ss_ctx_alloc(
+                CRYPTO_HW_CTX_MAC, &ret);
             if (ret == SS_SUCCESS)
             {
                 ss_mac_ctx->algo = algo;
@@ -5070,6 +6121,16 @@ TEE_Result crypto_hw_mac_alloc_ctx(void **ctx, uint32_t algo)
     return tee_ret;
 }
 
+/*
+ * brief:	Free a context for HMAC,AES-MAC algorithm.
+ *
+ * param[in]	ctx	    	- Pointer to the HMAC,AES-MAC context.
+ */
+void crypto_hw_mac_free_ctx(void *ctx)
+{
+    ss_ctx_free(CRYPTO_HW_CTX_MAC, ctx);
+}
+
 /*
  * brief:	Get context size to HMAC,AES-MAC algorithm.
  *
@@ -5525,6 +6586,84 @@ TEE_Result crypto_hw_mac_update(void *ctx, uint32_t algo, const uint8_t *data,
 	return tee_res;
 }
 
+/*
+ * brief:	Block Data Update state of HMAC,AES-MAC algorithm from a
+ *		scattered source buffer.
+ *
+ * param[in]	*ctx		- Pointer to the HMAC,AES-MAC context.
+ * param[in]	algo		- Cryptographic algorithm.
+ * param[in]	*sg		- List of the source data fragments.
+ * param[in]	num		- Number of fragments in the list.
+ * return	TEE_Result	- TEE internal API error code.
+ */
+TEE_Result crypto_hw_mac_update_sg(void *ctx, uint32_t algo,
+		const struct crypto_sg *sg, size_t num)
+{
+	TEE_Result tee_res;
+	SSError_t res = SS_SUCCESS;
+	SS_MAC_Context_t *ss_mac_ctx = NULL;
+	SS_HMAC_Context_t *hmacCtx = NULL;
+	SS_AES_Context2_t *aesCtx = NULL;
+	void *macCtx = NULL;
+	uint8_t *nullBuf = NULL;
+	size_t total = 0U;
+
+	PROV_INMSG("*ctx=%p, algo=%d, *sg=%p, num=%zu\n", ctx, algo, sg, num);
+
+	if (NULL == ctx) {
+		res = SS_ERROR_BAD_PARAMETERS;
+		PROV_EMSG("BAD_PARAMETERS(ctx=NULL)\n");
+	} else {
+		ss_mac_ctx = (SS_MAC_Context_t *)ctx;
+		res = ss_sg_total(sg, num, &total);
+	}
+
+	if (SS_SUCCESS == res) {
+		switch ((int32_t)algo) {
+#if defined(CFG_CRYPTO_HMAC)
+		case TEE_ALG_HMAC_MD5:
+		case TEE_ALG_HMAC_SHA224:
+		case TEE_ALG_HMAC_SHA1:
+		case TEE_ALG_HMAC_SHA256:
+		case TEE_ALG_HMAC_SHA384:
+		case TEE_ALG_HMAC_SHA512:
+			CHECK_CONTEXT(res, hmacCtx, SS_HMAC_Context_t,
+					&(ss_mac_ctx->u.hmac_ctx));
+			macCtx = hmacCtx;
+			break;
+#endif
+#if defined(CFG_CRYPTO_AES)
+#if defined(CFG_CRYPTO_CBC_MAC)
+		case TEE_ALG_AES_CBC_MAC_PKCS5:
+		case TEE_ALG_AES_CBC_MAC_NOPAD:
+#endif
+#if defined(CFG_CRYPTO_CMAC)
+		case TEE_ALG_AES_CMAC:
+#endif
+#if defined(CFG_CRYPTO_XCBC_MAC)
+		case TEE_ALG_AES_XCBC_MAC:
+#endif
+			CHECK_CONTEXT(res, aesCtx, SS_AES_Context2_t,
+					&(ss_mac_ctx->u.aes_ctx));
+			macCtx = aesCtx;
+			break;
+#endif
+		default:
+			PROV_EMSG("NOT_SUPPORTED\n");
+			res = SS_ERROR_NOT_SUPPORTED;
+			break;
+		}
+	}
+
+	if (SS_SUCCESS == res) {
+		res = ss_sg_update(macCtx, algo, sg, num, total, &nullBuf);
+	}
+
+	tee_res = ss_translate_error_ss2tee(res);
+	PROV_OUTMSG("return res=0x%08x -> tee_res=0x%08x\n",res,tee_res);
+	return tee_res;
+}
+
 /*
  * brief:	Finalize state of HMAC algorithm.
  *
@@ -5837,6 +6976,17 @@ TEE_Result crypto_hw_aes_ccm_alloc_ctx(void **ctx)
     return tee_ret;
 }
 
+/*
+ * brief:	Free a context for AESCCM algorithm.
+ *
+ * param[in]	ctx		- Pointer to the AESCCM context.
+ */
+void crypto_hw_aes_ccm_free_ctx(void *ctx)
+{
+    /* Not a slab context, allocated by crypto_hw_aes_ccm_alloc_ctx() */
+    ss_free(ctx);
+}
+
 /*
  * brief:	Copy a context for AESCCM algorithm.
  *
@@ -6252,17 +7402,17 @@ void crypto_hw_aes_ccm_final(void)
 /*
  * brief:	Wrap CRYS_RND_GenerateVector() to output more than 64KB of data.
  *
- * param[in]	*outPtr		- Pointer of output buffer.
+ * param[out]	*outPtr		- Pointer of output buffer.
  * param[in]	outSize		- Byte size of the output data buffer.
- * return	TEE_Result	- TEE internal API error code.
+ * return	SSError_t	- SS provider error code.
  */
-TEE_Result crypto_hw_rng_read(void *outPtr, size_t outSize)
+static SSError_t ss_rng_generate(uint8_t *outPtr, size_t outSize)
 {
 	SSError_t res;
 	CRYSError_t crys_res = (CRYSError_t)CRYS_OK;
 	size_t remain = outSize;
 	uint16_t crysOutSize;
-	uint8_t *compOutPtr = (uint8_t *)outPtr;
+	uint8_t *compOutPtr = outPtr;
 
 	PROV_DMSG("crysOutSize=%ld  outPtr=%p\n", outSize, outPtr);
 
@@ -6284,6 +7434,130 @@ TEE_Result crypto_hw_rng_read(void *outPtr, size_t outSize)
 	return res;
 }
 
+#if defined(CFG_CRYPTO_HW_RNG_POOL)
+/*
+ * brief:	Take random bytes from the pool of the current CPU core, and
+ *		start a refill of the pool when it runs low.
+ *
+ * param[out]	*outPtr		- Pointer of output buffer.
+ * param[in]	outSize		- Byte size of the output data buffer.
+ * param[out]	*refill		- Refill to run by the caller.
+ * return	bool		- true if the bytes were taken from the pool.
+ */
+static bool ss_rng_pool_take(uint8_t *outPtr, size_t outSize,
+		SS_RNG_Refill_t *refill)
+{
+	uint32_t exceptions;
+	SS_RNG_Pool_t *pool;
+	bool taken = false;
+
+	exceptions = thread_mask_exceptions(THREAD_EXCP_ALL);
+	refill->core = (uint32_t)get_core_pos();
+	refill->size = 0U;
+	pool = &ss_rng_pools[refill->core];
+	cpu_spin_lock(&pool->lock);
+
+	if (pool->avail >= outSize) {
+		pool->avail -= (uint32_t)outSize;
+		(void)memcpy(outPtr, &pool->buf[pool->avail], outSize);
+		memzero_explicit(&pool->buf[pool->avail], outSize);
+		taken = true;
+	}
+	if ((!pool->refilling) && (pool->avail < SS_RNG_POOL_LOW)) {
+		pool->refilling = true;
+		refill->flushes = pool->flushes;
+		refill->size = SS_RNG_POOL_SIZE - pool->avail;
+	}
+
+	cpu_spin_unlock(&pool->lock);
+	thread_unmask_exceptions(exceptions);
+	return taken;
+}
+
+/*
+ * brief:	Refill a pool with random bytes generated in one engine call.
+ *		The bytes are dropped if the pool was flushed meanwhile, and
+ *		the pool stays low if the generation fails.
+ *
+ * param[in]	*refill		- Refill started by ss_rng_pool_take().
+ */
+static void ss_rng_pool_refill(const SS_RNG_Refill_t *refill)
+{
+	SSError_t res;
+	uint32_t exceptions;
+	SS_RNG_Pool_t *pool = &ss_rng_pools[refill->core];
+	uint8_t buf[SS_RNG_POOL_SIZE];
+	uint32_t size;
+
+	res = ss_rng_generate(buf, refill->size);
+
+	exceptions = cpu_spin_lock_xsave(&pool->lock);
+	if ((res == SS_SUCCESS) && (pool->flushes == refill->flushes)) {
+		size = MIN(refill->size, SS_RNG_POOL_SIZE - pool->avail);
+		(void)memcpy(&pool->buf[pool->avail], buf, size);
+		pool->avail += size;
+	}
+	pool->refilling = false;
+	cpu_spin_unlock_xrestore(&pool->lock, exceptions);
+
+	memzero_explicit(buf, sizeof(buf));
+	if (res != SS_SUCCESS) {
+		PROV_EMSG("res=0x%08x\n", res);
+	}
+}
+
+/*
+ * brief:	Drop the pooled random bytes of all CPU cores, so the bytes
+ *		served after a reseed are generated after it.
+ */
+static void ss_rng_pool_flush(void)
+{
+	uint32_t exceptions;
+	SS_RNG_Pool_t *pool;
+	uint32_t i;
+
+	for (i = 0U; i < (uint32_t)CFG_TEE_CORE_NB_CORE; i++) {
+		pool = &ss_rng_pools[i];
+		exceptions = cpu_spin_lock_xsave(&pool->lock);
+		memzero_explicit(pool->buf, pool->avail);
+		pool->avail = 0U;
+		pool->flushes++;
+		cpu_spin_unlock_xrestore(&pool->lock, exceptions);
+	}
+}
+#endif /* CFG_CRYPTO_HW_RNG_POOL */
+
+/*
+ * brief:	Output random bytes. Small requests are served from the pool
+ *		of the current CPU core when CFG_CRYPTO_HW_RNG_POOL is enabled.
+ *
+ * param[out]	*outPtr		- Pointer of output buffer.
+ * param[in]	outSize		- Byte size of the output data buffer.
+ * return	TEE_Result	- TEE internal API error code.
+ */
+TEE_Result crypto_hw_rng_read(void *outPtr, size_t outSize)
+{
+	TEE_Result tee_res;
+	SSError_t res;
+#if defined(CFG_CRYPTO_HW_RNG_POOL)
+	SS_RNG_Refill_t refill = { .size = 0U };
+
+	if ((outSize <= SS_RNG_POOL_REQ_MAX) &&
+			ss_rng_pool_take((uint8_t *)outPtr, outSize, &refill)) {
+		res = SS_SUCCESS;
+	} else {
+		res = ss_rng_generate((uint8_t *)outPtr, outSize);
+	}
+	if (refill.size != 0U) {
+		ss_rng_pool_refill(&refill);
+	}
+#else
+	res = ss_rng_generate((uint8_t *)outPtr, outSize);
+#endif
+	tee_res = ss_translate_error_ss2tee(res);
+	return tee_res;
+}
+
 /*
  * brief:	Add entropy for PRNG.
  *
@@ -6323,6 +7597,9 @@ TEE_Result crypto_hw_rng_add_entropy(const uint8_t *inbuf, size_t len)
 		if (SS_SUCCESS != res) {
 			PROV_EMSG("res=0x%08x\n", res);
 		}
+#if defined(CFG_CRYPTO_HW_RNG_POOL)
+		ss_rng_pool_flush();
+#endif
 	}
 	tee_res = ss_translate_error_ss2tee(res);
 	PROV_OUTMSG("return res=0x%08x -> tee_res=0x%08x\n", res, tee_res);
@@ -6808,7 +8085,7 @@ static TEE_Result crypto_hw_init_crypto_engine(void)
 	DxUTILError_t util_res;
 	static uint32_t hwengine_init_flag __nex_bss = INIT_FLAG_UNINITIALIZED;
 
-	rcar_nex_mutex_lock(&secure_asymm_mutex);
+	ss_asymm_acquire(SS_ASYMM_UNIT_CC);
 	if (hwengine_init_flag == INIT_FLAG_UNINITIALIZED) {
 		PROV_INMSG("START %s\n", __func__);
 		crys_res = DX_CclibInit();
@@ -6820,15 +8097,20 @@ static TEE_Result crypto_hw_init_crypto_engine(void)
 		}
 #if defined(CFG_CRYPT_ENABLE_CEPKA)
 		if (res == SS_SUCCESS) {
+			ss_asymm_acquire(SS_ASYMM_UNIT_PKA);
 			res = pka_verify_init();
+			ss_asymm_release(SS_ASYMM_UNIT_PKA);
 		}
+#endif
+#if defined(CFG_CRYPTO_HW_CTX_SLAB)
+		ss_ctx_slab_init();
 #endif
 		/* Secure and PKA engines has been initialized */
 		hwengine_init_flag = INIT_FLAG_INITIALIZED;
 	} else {
 		res = SS_SUCCESS;
 	}
-	rcar_nex_mutex_unlock(&secure_asymm_mutex);
+	ss_asymm_release(SS_ASYMM_UNIT_CC);
 	tee_res = ss_translate_error_ss2tee(res);
 	PROV_OUTMSG("return res=0x%08x -> tee_res=0x%08x\n",res,tee_res);
 
@@ -103,6 +103,9 @@ TEE_Result crypto_acipher_alloc_rsa_keypair(struct rsa_keypair *s,
 		goto err;
 	if (!bn_alloc_max(&s->dq))
 		goto err;
+#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
+	s->hw_gen = crypto_hw_acipher_rsa_key_gen();
+#endif
 
 	return TEE_SUCCESS;
 err:
@@ -118,6 +121,9 @@ TEE_Result crypto_acipher_alloc_rsa_public_key(struct rsa_public_key *s,
 		return TEE_ERROR_OUT_OF_MEMORY;
 	if (!bn_alloc_max(&s->n))
 		goto err;
+#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
+	s->hw_gen = crypto_hw_acipher_rsa_key_gen();
+#endif
 	return TEE_SUCCESS;
 err:
 	crypto_bignum_free(s->e);
@@ -128,6 +134,10 @@ void crypto_acipher_free_rsa_public_key(struct rsa_public_key *s)
 {
 	if (!s)
 		return;
+#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
+	s->hw_gen = 0;
+	crypto_hw_acipher_rsa_key_release(s);
+#endif
 	crypto_bignum_free(s->n);
 	crypto_bignum_free(s->e);
 }
@@ -136,6 +146,10 @@ void crypto_acipher_free_rsa_keypair(struct rsa_keypair *s)
 {
 	if (!s)
 		return;
+#if defined(CFG_CRYPT_HW_CRYPTOENGINE)
+	s->hw_gen = 0;
+	crypto_hw_acipher_rsa_key_release(s);
+#endif
 	crypto_bignum_free(s->e);
 	crypto_bignum_free(s->d);
 	crypto_bignum_free(s->n);
@@ -3,6 +3,7 @@
  * Copyright (c) 2015, Linaro Limited
  */
 #include <compiler.h>
+#include <crypto/crypto.h>
 #include <stdio.h>
 #include <trace.h>
 #include <kernel/pseudo_ta.h>
@@ -11,6 +12,16 @@
 #include <string.h>
 #include <string_ext.h>
 #include <malloc.h>
+#if defined(CFG_RCAR_TA_CACHE)
+#include "rcar_ta_cache.h"
+#endif
+#if defined(CFG_RCAR_FLASH_SIM)
+#include "flash_sim_control.h"
+#endif
+#if defined(CFG_STANDALONE_FS)
+#include "tee_standalone_fs.h"
+#include "tee_standalone_fs_key_manager.h"
+#endif
 
 #define TA_NAME		"stats.ta"
 
@@ -21,6 +32,14 @@
 #define STATS_CMD_PAGER_STATS		0
 #define STATS_CMD_ALLOC_STATS		1
 #define STATS_CMD_MEMLEAK_STATS		2
+#define STATS_CMD_CRYPTO_DISPATCH	3
+#define STATS_CMD_CRYPTO_QUEUE		4
+#define STATS_CMD_CRYPTO_CTX_SLAB	5
+#define STATS_CMD_TA_CACHE		6
+#define STATS_CMD_FLASH_SIM		7
+#define STATS_CMD_SFS_CRYPTO		8
+#define STATS_CMD_SFS_LOCK		9
+#define STATS_CMD_SFS_ERASE		10
 
 #define STATS_NB_POOLS			4
 
@@ -137,6 +156,247 @@ static TEE_Result get_memleak_stats(uint32_t type,
 	return TEE_SUCCESS;
 }
 
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+static TEE_Result get_crypto_dispatch_stats(uint32_t type,
+					    TEE_Param p[TEE_NUM_PARAMS])
+{
+	size_t size = sizeof(struct crypto_hw_dispatch_entry) *
+		      CRYPTO_HW_DISPATCH_NUM;
+	TEE_Result res = TEE_SUCCESS;
+
+	/*
+	 * p[0].value.a = 0 if no calibration of the HW/SW engine dispatch
+	 * p[1].memref.buffer = output buffer to CRYPTO_HW_DISPATCH_NUM
+	 *                      struct crypto_hw_dispatch_entry
+	 */
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+			    TEE_PARAM_TYPE_MEMREF_OUTPUT,
+			    TEE_PARAM_TYPE_NONE,
+			    TEE_PARAM_TYPE_NONE) != type) {
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (p[1].memref.size < size) {
+		p[1].memref.size = size;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	if (p[0].value.a) {
+		res = crypto_hw_dispatch_calibrate();
+		if (res)
+			return res;
+	}
+
+	p[1].memref.size = size;
+	crypto_hw_dispatch_get_table(p[1].memref.buffer);
+
+	return TEE_SUCCESS;
+}
+#endif
+
+#if defined(CFG_CRYPTO_HW_QUEUE)
+static TEE_Result get_crypto_queue_stats(uint32_t type,
+					 TEE_Param p[TEE_NUM_PARAMS])
+{
+	size_t size = sizeof(struct crypto_hw_queue_stats);
+
+	/*
+	 * p[0].value.a = 0 if the counters are not reset after reading
+	 * p[1].memref.buffer = output buffer to struct crypto_hw_queue_stats
+	 */
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+			    TEE_PARAM_TYPE_MEMREF_OUTPUT,
+			    TEE_PARAM_TYPE_NONE,
+			    TEE_PARAM_TYPE_NONE) != type) {
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (p[1].memref.size < size) {
+		p[1].memref.size = size;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	p[1].memref.size = size;
+	crypto_hw_queue_get_stats(p[1].memref.buffer, p[0].value.a);
+
+	return TEE_SUCCESS;
+}
+#endif
+
+#if defined(CFG_CRYPTO_HW_CTX_SLAB)
+static TEE_Result get_crypto_ctx_slab_stats(uint32_t type,
+					    TEE_Param p[TEE_NUM_PARAMS])
+{
+	size_t size = sizeof(struct crypto_hw_ctx_slab_stats) *
+		      CRYPTO_HW_CTX_TYPES;
+
+	/*
+	 * p[0].value.a = 0 if the counters are not reset after reading
+	 * p[1].memref.buffer = output buffer to CRYPTO_HW_CTX_TYPES
+	 *                      struct crypto_hw_ctx_slab_stats
+	 */
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+			    TEE_PARAM_TYPE_MEMREF_OUTPUT,
+			    TEE_PARAM_TYPE_NONE,
+			    TEE_PARAM_TYPE_NONE) != type) {
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (p[1].memref.size < size) {
+		p[1].memref.size = size;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	p[1].memref.size = size;
+	crypto_hw_ctx_slab_get_stats(p[1].memref.buffer, p[0].value.a);
+
+	return TEE_SUCCESS;
+}
+#endif
+
+#if defined(CFG_RCAR_TA_CACHE)
+static TEE_Result get_ta_cache_stats(uint32_t type,
+				     TEE_Param p[TEE_NUM_PARAMS])
+{
+	size_t size = sizeof(struct rcar_ta_cache_stats);
+
+	/*
+	 * p[0].value.a = 0 if the counters are not reset after reading
+	 * p[1].memref.buffer = output buffer to struct rcar_ta_cache_stats
+	 */
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+			    TEE_PARAM_TYPE_MEMREF_OUTPUT,
+			    TEE_PARAM_TYPE_NONE,
+			    TEE_PARAM_TYPE_NONE) != type) {
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (p[1].memref.size < size) {
+		p[1].memref.size = size;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	p[1].memref.size = size;
+	rcar_ta_cache_get_stats(p[1].memref.buffer, p[0].value.a);
+
+	return TEE_SUCCESS;
+}
+#endif
+
+#if defined(CFG_RCAR_FLASH_SIM)
+static TEE_Result get_flash_sim_stats(uint32_t type,
+				      TEE_Param p[TEE_NUM_PARAMS])
+{
+	size_t size = sizeof(struct flash_sim_stats);
+
+	/*
+	 * p[0].value.a = 0 if the counters are not reset after reading
+	 * p[1].memref.buffer = output buffer to struct flash_sim_stats
+	 */
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+			    TEE_PARAM_TYPE_MEMREF_OUTPUT,
+			    TEE_PARAM_TYPE_NONE,
+			    TEE_PARAM_TYPE_NONE) != type) {
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (p[1].memref.size < size) {
+		p[1].memref.size = size;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	p[1].memref.size = size;
+	flash_sim_get_stats(p[1].memref.buffer);
+	if (p[0].value.a)
+		flash_sim_clear_stats();
+
+	return TEE_SUCCESS;
+}
+#endif
+
+#if defined(CFG_STANDALONE_FS)
+static TEE_Result get_sfs_crypto_stats(uint32_t type,
+				       TEE_Param p[TEE_NUM_PARAMS])
+{
+	size_t size = sizeof(struct tee_sfkm_stats);
+
+	/*
+	 * p[0].value.a = 0 if the counters are not reset after reading
+	 * p[1].memref.buffer = output buffer to struct tee_sfkm_stats
+	 */
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+			    TEE_PARAM_TYPE_MEMREF_OUTPUT,
+			    TEE_PARAM_TYPE_NONE,
+			    TEE_PARAM_TYPE_NONE) != type) {
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (p[1].memref.size < size) {
+		p[1].memref.size = size;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	p[1].memref.size = size;
+	tee_sfkm_get_stats(p[1].memref.buffer, p[0].value.a);
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result get_sfs_lock_stats(uint32_t type,
+				     TEE_Param p[TEE_NUM_PARAMS])
+{
+	size_t size = sizeof(struct spim_lock_stats);
+
+	/*
+	 * p[0].value.a = 0 if the counters are not reset after reading
+	 * p[1].memref.buffer = output buffer to struct spim_lock_stats
+	 */
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+			    TEE_PARAM_TYPE_MEMREF_OUTPUT,
+			    TEE_PARAM_TYPE_NONE,
+			    TEE_PARAM_TYPE_NONE) != type) {
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (p[1].memref.size < size) {
+		p[1].memref.size = size;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	p[1].memref.size = size;
+	tee_standalone_fs_get_lock_stats(p[1].memref.buffer, p[0].value.a);
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result get_sfs_erase_stats(uint32_t type,
+				      TEE_Param p[TEE_NUM_PARAMS])
+{
+	size_t size = sizeof(struct spim_erase_stats);
+
+	/*
+	 * p[0].value.a = 0 if the counters are not reset after reading
+	 * p[1].memref.buffer = output buffer to struct spim_erase_stats
+	 */
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+			    TEE_PARAM_TYPE_MEMREF_OUTPUT,
+			    TEE_PARAM_TYPE_NONE,
+			    TEE_PARAM_TYPE_NONE) != type) {
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (p[1].memref.size < size) {
+		p[1].memref.size = size;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	p[1].memref.size = size;
+	tee_standalone_fs_get_erase_stats(p[1].memref.buffer, p[0].value.a);
+
+	return TEE_SUCCESS;
+}
+#endif
+
 /*
  * Trusted Application Entry Points
  */
@@ -152,6 +412,34 @@ static TEE_Result invoke_command(void *psess __unused,
 		return get_alloc_stats(ptypes, params);
 	case STATS_CMD_MEMLEAK_STATS:
 		return get_memleak_stats(ptypes, params);
+#if defined(CFG_CRYPTO_HW_DISPATCH)
+	case STATS_CMD_CRYPTO_DISPATCH:
+		return get_crypto_dispatch_stats(ptypes, params);
+#endif
+#if defined(CFG_CRYPTO_HW_QUEUE)
+	case STATS_CMD_CRYPTO_QUEUE:
+		return get_crypto_queue_stats(ptypes, params);
+#endif
+#if defined(CFG_CRYPTO_HW_CTX_SLAB)
+	case STATS_CMD_CRYPTO_CTX_SLAB:
+		return get_crypto_ctx_slab_stats(ptypes, params);
+#endif
+#if defined(CFG_RCAR_TA_CACHE)
+	case STATS_CMD_TA_CACHE:
+		return get_ta_cache_stats(ptypes, params);
+#endif
+#if defined(CFG_RCAR_FLASH_SIM)
+	case STATS_CMD_FLASH_SIM:
+		return get_flash_sim_stats(ptypes, params);
+#endif
+#if defined(CFG_STANDALONE_FS)
+	case STATS_CMD_SFS_CRYPTO:
+		return get_sfs_crypto_stats(ptypes, params);
+	case STATS_CMD_SFS_LOCK:
+		return get_sfs_lock_stats(ptypes, params);
+	case STATS_CMD_SFS_ERASE:
+		return get_sfs_erase_stats(ptypes, params);
+#endif
 	default:
 		break;
 	}
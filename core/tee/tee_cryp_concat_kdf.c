@@ -21,6 +21,8 @@ TEE_Result tee_cryp_concat_kdf(uint32_t hash_id, const uint8_t *shared_secret,
 	void *ctx = NULL;
 	uint8_t tmp[TEE_MAX_HASH_SIZE];
 	uint32_t be_count;
+	struct crypto_sg sg[3] = { };
+	size_t num = 2;
 	uint8_t *out = derived_key;
 	uint32_t hash_algo = TEE_ALG_HASH_ALGO(hash_id);
 
@@ -32,6 +34,16 @@ TEE_Result tee_cryp_concat_kdf(uint32_t hash_id, const uint8_t *shared_secret,
 	if (res != TEE_SUCCESS)
 		goto out;
 
+	sg[0].data = (uint8_t *)&be_count;
+	sg[0].len = sizeof(be_count);
+	sg[1].data = shared_secret;
+	sg[1].len = shared_secret_len;
+	if (other_info && other_info_len) {
+		sg[2].data = other_info;
+		sg[2].len = other_info_len;
+		num++;
+	}
+
 	n = derived_key_len / hash_len;
 	sz = hash_len;
 	for (i = 1; i <= n + 1; i++) {
@@ -40,19 +52,9 @@ TEE_Result tee_cryp_concat_kdf(uint32_t hash_id, const uint8_t *shared_secret,
 		res = crypto_hash_init(ctx);
 		if (res != TEE_SUCCESS)
 			goto out;
-		res = crypto_hash_update(ctx, (uint8_t *)&be_count,
-					 sizeof(be_count));
-		if (res != TEE_SUCCESS)
-			goto out;
-		res = crypto_hash_update(ctx, shared_secret, shared_secret_len);
+		res = crypto_hash_update_sg(ctx, sg, num);
 		if (res != TEE_SUCCESS)
 			goto out;
-		if (other_info && other_info_len) {
-			res = crypto_hash_update(ctx, other_info,
-						 other_info_len);
-			if (res != TEE_SUCCESS)
-				goto out;
-		}
 		res = crypto_hash_final(ctx, tmp, sizeof(tmp));
 		if (res != TEE_SUCCESS)
 			goto out;
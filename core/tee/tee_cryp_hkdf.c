@@ -9,6 +9,7 @@
 #include <tee/tee_cryp_hkdf.h>
 #include <tee/tee_cryp_utl.h>
 #include <utee_defines.h>
+#include <util.h>
 
 
 static const uint8_t zero_salt[TEE_MAX_HASH_SIZE];
@@ -114,17 +115,16 @@ static TEE_Result hkdf_expand(uint32_t hash_id, const uint8_t *prk,
 	where = 0;
 	for (i = 1; i <= n; i++) {
 		uint8_t c = i;
+		struct crypto_sg sg[] = {
+			{ .data = tn, .len = tn_len },
+			{ .data = info, .len = info_len },
+			{ .data = &c, .len = 1 },
+		};
 
 		res = crypto_mac_init(ctx, prk, prk_len);
 		if (res != TEE_SUCCESS)
 			goto out;
-		res = crypto_mac_update(ctx, tn, tn_len);
-		if (res != TEE_SUCCESS)
-			goto out;
-		res = crypto_mac_update(ctx, info, info_len);
-		if (res != TEE_SUCCESS)
-			goto out;
-		res = crypto_mac_update(ctx, &c, 1);
+		res = crypto_mac_update_sg(ctx, sg, ARRAY_SIZE(sg));
 		if (res != TEE_SUCCESS)
 			goto out;
 		res = crypto_mac_final(ctx, tn, sizeof(tn));
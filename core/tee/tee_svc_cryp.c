@@ -1008,6 +1008,33 @@ TEE_Result syscall_cryp_obj_get_attr(unsigned long obj, unsigned long attr_id,
 	return ops->to_user(attr, sess, buffer, size);
 }
 
+/*
+ * Drop the key material the HW crypto engine derived from the object. The
+ * generation of a cleared key is renewed, that of a freed key is cleared.
+ */
+static void release_hw_key(struct tee_obj *o __maybe_unused,
+			   bool renew __maybe_unused)
+{
+#if defined(CFG_CRYPT_HW_CRYPTOENGINE) && defined(CFG_CRYPTO_RSA)
+	uint32_t gen = 0;
+
+	if (renew)
+		gen = crypto_hw_acipher_rsa_key_gen();
+
+	if (o->info.objectType == TEE_TYPE_RSA_PUBLIC_KEY) {
+		struct rsa_public_key *key = o->attr;
+
+		key->hw_gen = gen;
+		crypto_hw_acipher_rsa_key_release(key);
+	} else if (o->info.objectType == TEE_TYPE_RSA_KEYPAIR) {
+		struct rsa_keypair *key = o->attr;
+
+		key->hw_gen = gen;
+		crypto_hw_acipher_rsa_key_release(key);
+	}
+#endif
+}
+
 void tee_obj_attr_free(struct tee_obj *o)
 {
 	const struct tee_cryp_obj_type_props *tp;
@@ -1019,6 +1046,8 @@ void tee_obj_attr_free(struct tee_obj *o)
 	if (!tp)
 		return;
 
+	release_hw_key(o, false);
+
 	for (n = 0; n < tp->num_type_attrs; n++) {
 		const struct tee_cryp_obj_type_attrs *ta = tp->type_attrs + n;
 
@@ -1037,6 +1066,8 @@ void tee_obj_attr_clear(struct tee_obj *o)
 	if (!tp)
 		return;
 
+	release_hw_key(o, true);
+
 	for (n = 0; n < tp->num_type_attrs; n++) {
 		const struct tee_cryp_obj_type_attrs *ta = tp->type_attrs + n;
 
@@ -184,6 +184,25 @@ static TEE_Result tee_svc_storage_remove_corrupt_obj(struct ts_session *sess,
 	return TEE_SUCCESS;
 }
 
+bool tee_svc_storage_begin_transaction(const struct tee_file_operations *fops)
+{
+	return fops->begin_transaction && !fops->begin_transaction();
+}
+
+TEE_Result
+tee_svc_storage_commit_transaction(const struct tee_file_operations *fops,
+				   bool in_trans, TEE_Result res)
+{
+	TEE_Result res2 = TEE_SUCCESS;
+
+	if (in_trans)
+		res2 = fops->commit_transaction();
+
+	if (res == TEE_SUCCESS)
+		return res2;
+	return res;
+}
+
 static TEE_Result tee_svc_storage_read_head(struct tee_obj *o)
 {
 	TEE_Result res = TEE_SUCCESS;
@@ -520,12 +539,14 @@ err:
 
 TEE_Result syscall_storage_obj_del(unsigned long obj)
 {
+	const struct tee_file_operations *fops = NULL;
 	struct ts_session *sess = ts_get_current_session();
 	struct user_ta_ctx *utc = to_user_ta_ctx(sess->ctx);
 	TEE_Result res = TEE_SUCCESS;
 	struct tee_obj *o = NULL;
 	uint8_t *data = NULL;
 	size_t len = 0;
+	bool in_trans = false;
 
 	res = tee_obj_get(utc, uref_to_vaddr(obj), &o);
 	if (res != TEE_SUCCESS)
@@ -537,6 +558,7 @@ TEE_Result syscall_storage_obj_del(unsigned long obj)
 	if (o->pobj == NULL || o->pobj->obj_id == NULL)
 		return TEE_ERROR_BAD_STATE;
 
+	fops = o->pobj->fops;
 	if (IS_ENABLED(CFG_NXP_SE05X)) {
 		len = o->info.dataSize;
 		data = calloc(1, len);
@@ -550,10 +572,15 @@ TEE_Result syscall_storage_obj_del(unsigned long obj)
 		free(data);
 	}
 
-	res = o->pobj->fops->remove(o->pobj);
+	in_trans = tee_svc_storage_begin_transaction(fops);
+	res = fops->remove(o->pobj);
+	res = tee_svc_storage_commit_transaction(fops, in_trans, res);
+	if (res != TEE_SUCCESS)
+		return res;
+
 	tee_obj_close(utc, o);
 
-	return res;
+	return TEE_SUCCESS;
 }
 
 TEE_Result syscall_storage_obj_rename(unsigned long obj, void *object_id,
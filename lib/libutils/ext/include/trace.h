@@ -28,6 +28,9 @@ int trace_ext_get_thread_id(void);
 void trace_set_level(int level);
 int trace_get_level(void);
 void plat_trace_ext_puts(const char *str);
+/* Records a trace unformatted, used with CFG_RCAR_TRACE_BINARY=y */
+void trace_ext_vbinary(const char *func, int line, int level, bool level_ok,
+		       const char *fmt, va_list ap);
 
 /* Internal functions used by the macros below */
 void trace_vprintf(const char *func, int line, int level, bool level_ok,
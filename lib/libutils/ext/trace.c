@@ -111,6 +111,12 @@ void trace_vprintf(const char *function, int line, int level, bool level_ok,
 	if (level_ok && level > trace_level)
 		return;
 
+#if defined(__KERNEL__) && defined(CFG_RCAR_TRACE_BINARY)
+	/* Formatted later on the host from the format string in tee.elf */
+	trace_ext_vbinary(function, line, level, level_ok, fmt, ap);
+	return;
+#endif
+
 	/* Print the type of message */
 	res = snprintk(buf, sizeof(buf), "%c/",
 		       trace_level_to_string(level, level_ok));
@@ -0,0 +1,244 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: BSD-2-Clause
+#
+# Copyright (c) 2021, Renesas Electronics Corporation
+#
+# Renders the R-Car secure Logging RAM written with CFG_RCAR_TRACE_BINARY=y.
+# The records hold the location of the format string in tee.elf and the raw
+# arguments, see struct log_bin_rec_t in
+# core/arch/arm/plat-rcar/rcar_log_func.h.
+#
+
+import argparse
+import re
+import struct
+import sys
+try:
+    from elftools.elf.elffile import ELFFile
+    from elftools.elf.sections import SymbolTableSection
+
+except ImportError:
+    print("""
+***
+Can't find elftools module. Probably it is not installed on your system.
+You can install this module with
+
+$ apt install python3-pyelftools
+
+if you are using Ubuntu. Or try to search for "pyelftools" or "elftools" in
+your package manager if you are using some other distribution.
+***
+""")
+    raise
+
+# Logging RAM layout, see rcar_log_func.h
+LOG_RAM_MAX_SIZE = 81920
+LOG_RAM_HEADER_SIZE = 16
+LOG_RAM_RESERVE_SIZE = 64
+LOG_AREA_MAX_SIZE = LOG_RAM_MAX_SIZE - (LOG_RAM_HEADER_SIZE +
+                                        LOG_RAM_RESERVE_SIZE)
+LOG_HDR_FMT = '<4sIII'
+
+LOG_BIN_MAGIC = 0xB10F
+LOG_BIN_NONE = 0xFFFFFFFF
+LOG_BIN_LEVEL_NONE = 0xFF
+LOG_BIN_REC_FMT = '<HHBBHIIQ'
+LOG_BIN_REC_SIZE = struct.calcsize(LOG_BIN_REC_FMT)
+LOG_BIN_MAX_SIZE = LOG_BIN_REC_SIZE + 256
+
+LEVEL_CHARS = 'UEIDF'
+
+CONV_RE = re.compile(r'%([#0\- +]*)(\*|\d+)?(?:\.(\*|\d*))?'
+                     r'(hh|h|ll|l|j|q|z|t)?([%cdiouxXpsnDOU])')
+
+
+def get_args():
+    parser = argparse.ArgumentParser(description='Renders the R-Car secure '
+                                     'Logging RAM recorded in binary trace '
+                                     'mode')
+    parser.add_argument('tee_elf', help='the OP-TEE ELF file (tee.elf)')
+    parser.add_argument('log', help='dump of the Logging RAM, starting with '
+                        'the "BLOG" header')
+    parser.add_argument('--cntfrq', type=int, default=8333333,
+                        help='frequency of the system counter in Hz '
+                        '(default: %(default)s)')
+    return parser.parse_args()
+
+
+class TeeElf:
+    def __init__(self, f):
+        self.elf = ELFFile(f)
+        self.long_size = 8 if self.elf.elfclass == 64 else 4
+        self.text_start = None
+        for sect in self.elf.iter_sections():
+            if isinstance(sect, SymbolTableSection):
+                sym = sect.get_symbol_by_name('__text_start')
+                if sym:
+                    self.text_start = sym[0]['st_value']
+        if self.text_start is None:
+            sys.exit('__text_start not found in tee.elf')
+        self.strings = {}
+
+    def get_string(self, offs):
+        if offs in self.strings:
+            return self.strings[offs]
+        addr = self.text_start + offs
+        s = None
+        for sect in self.elf.iter_sections():
+            start = sect['sh_addr']
+            if (sect['sh_type'] != 'SHT_NOBITS' and
+                    start <= addr < start + sect['sh_size']):
+                data = sect.data()
+                end = data.find(b'\0', addr - start)
+                if end < 0:
+                    end = len(data)
+                s = data[addr - start:end].decode('utf-8', 'replace')
+                break
+        self.strings[offs] = s
+        return s
+
+
+class Args:
+    def __init__(self, data, long_size):
+        self.data = data
+        self.offs = 0
+        self.long_size = long_size
+
+    def take(self, size):
+        if self.offs + size > len(self.data):
+            raise IndexError
+        b = self.data[self.offs:self.offs + size]
+        self.offs += size
+        return b
+
+    def int(self, size, signed):
+        return int.from_bytes(self.take(size), 'little', signed=signed)
+
+    def str(self):
+        n = self.take(1)[0]
+        return self.take(n).decode('utf-8', 'replace')
+
+
+def uuid_str(b):
+    tl, tm, th = struct.unpack('<IHH', b[:8])
+    return '%08x-%04x-%04x-%s-%s' % (tl, tm, th, b[8:10].hex(), b[10:].hex())
+
+
+def render(fmt, args):
+    out = []
+    pos = 0
+    for m in CONV_RE.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, prec, length, conv = m.groups()
+        if conv == '%':
+            out.append('%')
+            continue
+        try:
+            if width == '*':
+                width = str(args.int(4, True))
+            if prec == '*':
+                prec = str(args.int(4, True))
+            spec = '%' + flags + (width or '')
+            if prec is not None:
+                spec += '.' + prec
+
+            size = 4
+            if conv in 'DOU' or length == 'l':
+                size = args.long_size
+            elif length in ('ll', 'j', 'q'):
+                size = 8
+            elif length in ('z', 't'):
+                size = args.long_size
+
+            if conv in 'di':
+                out.append((spec + 'd') % args.int(size, True))
+            elif conv in 'uU':
+                out.append((spec + 'd') % args.int(size, False))
+            elif conv in 'oO':
+                # Python prefixes the alternate form with 0o instead of 0
+                v = args.int(size, False)
+                o = (spec.replace('#', '') + 'o') % v
+                if '#' in flags and v:
+                    o = o.replace(oct(v)[2:], '0' + oct(v)[2:], 1)
+                out.append(o)
+            elif conv in 'xX':
+                out.append((spec + conv) % args.int(size, False))
+            elif conv == 'c':
+                out.append((spec + 'c') % chr(args.int(4, True) & 0xff))
+            elif conv == 's':
+                out.append((spec + 's') % args.str())
+            elif conv == 'p':
+                if fmt[pos:pos + 2] == 'Ul':
+                    pos += 2
+                    out.append((spec + 's') % uuid_str(args.take(16)))
+                else:
+                    out.append((spec + 's') %
+                               hex(args.int(args.long_size, False)))
+        except IndexError:
+            out.append('<truncated>')
+            pos = len(fmt)
+            break
+    out.append(fmt[pos:])
+    return ''.join(out).rstrip('\n')
+
+
+def get_records(log):
+    prefix, index, size, _ = struct.unpack_from(LOG_HDR_FMT, log)
+    if prefix != b'BLOG':
+        sys.exit('Not a binary Logging RAM, prefix %r' % prefix)
+    area = log[LOG_RAM_HEADER_SIZE:LOG_RAM_HEADER_SIZE + LOG_AREA_MAX_SIZE]
+    if size < LOG_AREA_MAX_SIZE:
+        data = area[:index]
+    else:
+        data = area[index:] + area[:index]
+
+    # The oldest record may be partly overwritten, resync on the magic
+    pos = 0
+    while pos + LOG_BIN_REC_SIZE <= len(data):
+        rec = struct.unpack_from(LOG_BIN_REC_FMT, data, pos)
+        rec_size = rec[1]
+        if (rec[0] != LOG_BIN_MAGIC or rec_size < LOG_BIN_REC_SIZE or
+                rec_size > LOG_BIN_MAX_SIZE or
+                pos + rec_size > len(data)):
+            pos += 1
+            continue
+        yield rec, data[pos + LOG_BIN_REC_SIZE:pos + rec_size]
+        pos += rec_size
+
+
+def main():
+    args = get_args()
+    with open(args.tee_elf, 'rb') as f:
+        elf = TeeElf(f)
+        with open(args.log, 'rb') as f:
+            log = f.read()
+
+        for rec, data in get_records(log):
+            _, _, core, level, line, fmt_offs, func_offs, cntpct = rec
+            if fmt_offs == LOG_BIN_NONE:
+                # Text record, rendered by the secure world
+                print(data.decode('utf-8', 'replace').rstrip('\n'))
+                continue
+
+            usec = cntpct * 1000000 // args.cntfrq
+            if level == LOG_BIN_LEVEL_NONE:
+                lvl = 'M'
+            else:
+                lvl = LEVEL_CHARS[level] if level < len(LEVEL_CHARS) else 'U'
+            prefix = '[%u.%06u][%d] %c/TEE-CORE: ' % (usec // 1000000,
+                                                       usec % 1000000,
+                                                       core, lvl)
+            if func_offs != LOG_BIN_NONE:
+                func = elf.get_string(func_offs)
+                prefix += '%s:%d ' % (func, line)
+
+            fmt = elf.get_string(fmt_offs)
+            if fmt is None:
+                print(prefix + '<format at 0x%x not found>' % fmt_offs)
+            else:
+                print(prefix + render(fmt, Args(data, elf.long_size)))
+
+
+if __name__ == "__main__":
+    main()